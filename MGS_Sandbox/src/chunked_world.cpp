@@ -0,0 +1,398 @@
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "chunked_world.hpp"
+#include "level.hpp"
+
+static uint64_t chunk_key(int32_t cx, int32_t cy) {
+    return ((uint64_t)(uint32_t)cx << 32) | (uint32_t)cy;
+}
+
+// Chunked worlds are little-endian like binary levels, so big-endian hosts swap these on the way in and out.
+static void swap_header_bytes(ChunkedWorldHeader* header) {
+    swap_bytes(&header->version, sizeof(header->version), 1);
+    swap_bytes(&header->obstacle_size, sizeof(header->obstacle_size), 1);
+    swap_bytes(&header->chunk_size, sizeof(header->chunk_size), 1);
+    swap_bytes(&header->max_half_extent, sizeof(header->max_half_extent), 1);
+    swap_bytes(&header->chunk_count, sizeof(header->chunk_count), 1);
+}
+
+static void swap_entry_bytes(ChunkEntry* entries, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        swap_bytes(&entries[i].cx, sizeof(int32_t), 4);
+        swap_bytes(&entries[i].offset, sizeof(entries[i].offset), 1);
+    }
+}
+
+bool save_chunked_world(const char* path, std::vector<Obstacle>& obstacles, float chunk_size) {
+    struct Keyed {
+        uint64_t key;
+        int32_t cx, cy;
+        Obstacle obs;
+    };
+
+    std::vector<Keyed> keyed;
+    keyed.reserve(obstacles.size());
+
+    float max_half_extent = 0;
+
+    for (Obstacle obs : obstacles) {
+        int32_t cx = (int32_t)floorf(obs.x / chunk_size);
+        int32_t cy = (int32_t)floorf(obs.y / chunk_size);
+
+        keyed.push_back({ chunk_key(cx, cy), cx, cy, obs });
+
+        max_half_extent = fmaxf(max_half_extent, fmaxf(obs.w, obs.h) / 2.0f);
+    }
+
+    std::stable_sort(keyed.begin(), keyed.end(), [](const Keyed& a, const Keyed& b) { return a.key < b.key; });
+
+    std::vector<ChunkEntry> index;
+
+    for (size_t i = 0; i < keyed.size(); i++) {
+        if (i == 0 || keyed[i].key != keyed[i - 1].key) {
+            index.push_back({ keyed[i].cx, keyed[i].cy, 0, 0, 0 });
+        }
+
+        index.back().obstacle_count++;
+    }
+
+    uint64_t offset = sizeof(ChunkedWorldHeader) + sizeof(ChunkEntry) * index.size();
+
+    for (ChunkEntry& entry : index) {
+        entry.offset = offset;
+        offset += sizeof(Obstacle) * entry.obstacle_count;
+    }
+
+    FILE* out_file = fopen(path, "wb");
+    if (!out_file) {
+        printf("[!] Couldn't open %s for writing.\n", path);
+        return false;
+    }
+
+    ChunkedWorldHeader header;
+    memcpy(header.magic, CHUNKED_WORLD_MAGIC, sizeof(CHUNKED_WORLD_MAGIC));
+    header.version = CHUNKED_WORLD_VERSION;
+    header.obstacle_size = sizeof(Obstacle);
+    header.chunk_size = chunk_size;
+    header.max_half_extent = max_half_extent;
+    header.chunk_count = index.size();
+
+    if (LEVEL_HOST_BIG_ENDIAN) {
+        swap_header_bytes(&header);
+        swap_entry_bytes(index.data(), index.size());
+    }
+
+    fwrite(&header, sizeof(header), 1, out_file);
+    fwrite(index.data(), sizeof(ChunkEntry), index.size(), out_file);
+
+    for (Keyed& k : keyed) {
+        if (LEVEL_HOST_BIG_ENDIAN) swap_bytes(&k.obs, sizeof(float), 4);
+        fwrite(&k.obs, sizeof(Obstacle), 1, out_file);
+    }
+
+    bool ok = !ferror(out_file);
+
+    if (fclose(out_file) != 0) ok = false;
+    if (!ok) printf("[!] Failed to write %s.\n", path);
+
+    return ok;
+}
+
+bool is_chunked_world(const char* path) {
+    FILE* in_file = fopen(path, "rb");
+    if (!in_file) return false;
+
+    char magic[8];
+    bool chunked = fread(magic, sizeof(magic), 1, in_file) == 1 && memcmp(magic, CHUNKED_WORLD_MAGIC, sizeof(magic)) == 0;
+
+    fclose(in_file);
+
+    return chunked;
+}
+
+enum ChunkState {
+    CHUNK_UNLOADED,
+    CHUNK_QUEUED,
+    CHUNK_LOADED
+};
+
+struct Chunk {
+    ChunkEntry entry;
+    ChunkState state;
+
+    std::vector<Obstacle> obstacles;
+};
+
+struct ChunkStreamer {
+    int fd;
+
+    ChunkedWorldHeader header;
+
+    std::vector<Chunk> chunks;
+    std::unordered_map<uint64_t, int> chunk_lookup;
+
+    // Chunks that aren't CHUNK_UNLOADED, so finding ones to evict doesn't mean looking at every chunk in the world.
+    std::vector<int> active;
+
+    // Everything below is shared with the loader thread and protected by mutex.
+    std::mutex mutex;
+    std::condition_variable work_ready;
+    std::condition_variable chunk_loaded;
+
+    std::deque<int> queue;
+    bool quit;
+
+    // Set when a chunk becomes resident or gets evicted.
+    bool resident_changed;
+
+    std::thread loader;
+};
+
+static void loader_main(ChunkStreamer* streamer) {
+    for (;;) {
+        int index;
+        ChunkEntry entry;
+
+        {
+            std::unique_lock<std::mutex> lock(streamer->mutex);
+            streamer->work_ready.wait(lock, [&] { return streamer->quit || !streamer->queue.empty(); });
+
+            if (streamer->quit) return;
+
+            index = streamer->queue.front();
+            streamer->queue.pop_front();
+
+            // The rover might have moved on before we got to it.
+            if (streamer->chunks[index].state != CHUNK_QUEUED) continue;
+
+            entry = streamer->chunks[index].entry;
+        }
+
+        // Read without holding the lock, so the main thread never waits on the disk.
+        std::vector<Obstacle> obstacles(entry.obstacle_count);
+        size_t bytes = sizeof(Obstacle) * entry.obstacle_count;
+
+        if (pread(streamer->fd, obstacles.data(), bytes, entry.offset) != (ssize_t)bytes) {
+            printf("[!] Failed to read chunk (%d, %d).\n", entry.cx, entry.cy);
+            obstacles.clear();
+        }
+
+        if (LEVEL_HOST_BIG_ENDIAN) swap_bytes(obstacles.data(), sizeof(float), obstacles.size() * 4);
+
+        {
+            std::lock_guard<std::mutex> lock(streamer->mutex);
+
+            Chunk& chunk = streamer->chunks[index];
+
+            if (chunk.state == CHUNK_QUEUED) {
+                chunk.obstacles.swap(obstacles);
+                chunk.state = CHUNK_LOADED;
+                streamer->resident_changed = true;
+            }
+        }
+
+        streamer->chunk_loaded.notify_all();
+    }
+}
+
+ChunkStreamer* open_chunk_streamer(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("[!] Couldn't open world %s.\n", path);
+        return NULL;
+    }
+
+    ChunkedWorldHeader header;
+
+    if (pread(fd, &header, sizeof(header), 0) != sizeof(header) || memcmp(header.magic, CHUNKED_WORLD_MAGIC, sizeof(CHUNKED_WORLD_MAGIC)) != 0) {
+        printf("[!] %s isn't a chunked world.\n", path);
+        close(fd);
+        return NULL;
+    }
+
+    if (LEVEL_HOST_BIG_ENDIAN) swap_header_bytes(&header);
+
+    if (header.version != CHUNKED_WORLD_VERSION || header.obstacle_size != sizeof(Obstacle)) {
+        printf("[!] %s is version %u of the chunked world format, but only version %u is supported.\n", path, header.version, CHUNKED_WORLD_VERSION);
+        close(fd);
+        return NULL;
+    }
+
+    std::vector<ChunkEntry> index(header.chunk_count);
+    size_t index_bytes = sizeof(ChunkEntry) * header.chunk_count;
+
+    if (pread(fd, index.data(), index_bytes, sizeof(header)) != (ssize_t)index_bytes) {
+        printf("[!] %s is truncated.\n", path);
+        close(fd);
+        return NULL;
+    }
+
+    if (LEVEL_HOST_BIG_ENDIAN) swap_entry_bytes(index.data(), index.size());
+
+    ChunkStreamer* streamer = new ChunkStreamer;
+
+    streamer->fd = fd;
+    streamer->header = header;
+    streamer->quit = false;
+    streamer->resident_changed = false;
+
+    streamer->chunks.resize(header.chunk_count);
+
+    for (size_t i = 0; i < index.size(); i++) {
+        streamer->chunks[i].entry = index[i];
+        streamer->chunks[i].state = CHUNK_UNLOADED;
+        streamer->chunk_lookup[chunk_key(index[i].cx, index[i].cy)] = (int)i;
+    }
+
+    streamer->loader = std::thread(loader_main, streamer);
+
+    return streamer;
+}
+
+void close_chunk_streamer(ChunkStreamer* streamer) {
+    {
+        std::lock_guard<std::mutex> lock(streamer->mutex);
+        streamer->quit = true;
+    }
+
+    streamer->work_ready.notify_all();
+    streamer->loader.join();
+
+    close(streamer->fd);
+
+    delete streamer;
+}
+
+// Distance from (x, y) to the nearest point of the chunk.
+static float chunk_distance(ChunkStreamer* streamer, const ChunkEntry& entry, float x, float y) {
+    float size = streamer->header.chunk_size;
+
+    float dx = fmaxf(fmaxf(entry.cx * size - x, x - (entry.cx + 1) * size), 0.0f);
+    float dy = fmaxf(fmaxf(entry.cy * size - y, y - (entry.cy + 1) * size), 0.0f);
+
+    return sqrtf(dx * dx + dy * dy);
+}
+
+void update_chunk_streamer(ChunkStreamer* streamer, float x, float y, float radius, bool wait) {
+    float size = streamer->header.chunk_size;
+
+    // Obstacles poking out of a chunk further out can still be in range.
+    float load_radius = radius + streamer->header.max_half_extent;
+
+    // Only evict once a chunk is a whole chunk further out than that, so driving back and forth along a chunk border
+    // doesn't keep reloading it.
+    float evict_radius = load_radius + size;
+
+    std::vector<int> wanted;
+
+    int cx0 = (int)floorf((x - load_radius) / size);
+    int cx1 = (int)floorf((x + load_radius) / size);
+    int cy0 = (int)floorf((y - load_radius) / size);
+    int cy1 = (int)floorf((y + load_radius) / size);
+
+    for (int cy = cy0; cy <= cy1; cy++) {
+        for (int cx = cx0; cx <= cx1; cx++) {
+            auto it = streamer->chunk_lookup.find(chunk_key(cx, cy));
+            if (it == streamer->chunk_lookup.end()) continue;
+
+            if (chunk_distance(streamer, streamer->chunks[it->second].entry, x, y) <= load_radius) {
+                wanted.push_back(it->second);
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(streamer->mutex);
+
+        for (int index : wanted) {
+            Chunk& chunk = streamer->chunks[index];
+
+            if (chunk.state == CHUNK_UNLOADED) {
+                chunk.state = CHUNK_QUEUED;
+                streamer->queue.push_back(index);
+                streamer->active.push_back(index);
+            }
+        }
+
+        for (size_t i = 0; i < streamer->active.size();) {
+            Chunk& chunk = streamer->chunks[streamer->active[i]];
+
+            if (chunk_distance(streamer, chunk.entry, x, y) > evict_radius) {
+                if (chunk.state == CHUNK_LOADED) streamer->resident_changed = true;
+
+                // A queued chunk gets skipped by the loader once it sees this.
+                chunk.state = CHUNK_UNLOADED;
+                std::vector<Obstacle>().swap(chunk.obstacles);
+
+                streamer->active[i] = streamer->active.back();
+                streamer->active.pop_back();
+            } else {
+                i++;
+            }
+        }
+    }
+
+    streamer->work_ready.notify_one();
+
+    if (wait) {
+        std::unique_lock<std::mutex> lock(streamer->mutex);
+
+        streamer->chunk_loaded.wait(lock, [&] {
+            for (int index : wanted) {
+                if (streamer->chunks[index].state != CHUNK_LOADED) return false;
+            }
+
+            return true;
+        });
+    }
+}
+
+bool collect_resident_obstacles(ChunkStreamer* streamer, std::vector<Obstacle>& obstacles) {
+    std::lock_guard<std::mutex> lock(streamer->mutex);
+
+    if (!streamer->resident_changed) return false;
+
+    obstacles.clear();
+
+    for (int index : streamer->active) {
+        Chunk& chunk = streamer->chunks[index];
+
+        if (chunk.state == CHUNK_LOADED) {
+            obstacles.insert(obstacles.end(), chunk.obstacles.begin(), chunk.obstacles.end());
+        }
+    }
+
+    streamer->resident_changed = false;
+
+    return true;
+}
+
+ChunkStreamerStats chunk_streamer_stats(ChunkStreamer* streamer) {
+    std::lock_guard<std::mutex> lock(streamer->mutex);
+
+    ChunkStreamerStats stats = { (int)streamer->chunks.size(), 0, 0, 0 };
+
+    for (int index : streamer->active) {
+        Chunk& chunk = streamer->chunks[index];
+
+        if (chunk.state == CHUNK_LOADED) {
+            stats.resident_chunks++;
+            stats.resident_obstacles += chunk.obstacles.size();
+        } else if (chunk.state == CHUNK_QUEUED) {
+            stats.queued_chunks++;
+        }
+    }
+
+    return stats;
+}
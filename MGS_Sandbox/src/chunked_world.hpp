@@ -0,0 +1,85 @@
+/*
+    Chunked worlds (.mgsworld) for levels too big to keep in memory, like kilometre-scale site maps.
+
+    The world is cut into square chunks, and every obstacle is stored in the chunk its center falls in. The file is a
+    ChunkedWorldHeader, then a ChunkEntry index (sorted by chunk coordinate), then the obstacles of each chunk packed
+    one after another in the same layout as binary levels. Like binary levels, every number in the file is
+    little-endian.
+
+    A ChunkStreamer only keeps the chunks near the rover resident. Chunks are read on a background thread as they come
+    into range and dropped once the rover has moved away, so memory use and scan cost follow how cluttered the area
+    around the rover is rather than how big the world is.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "obstacle.hpp"
+
+const char CHUNKED_WORLD_MAGIC[8] = { 'M', 'G', 'S', 'W', 'O', 'R', 'L', 'D' };
+
+// Bump this whenever the layout changes.
+const uint32_t CHUNKED_WORLD_VERSION = 1;
+
+struct ChunkedWorldHeader {
+    char magic[8];
+
+    uint32_t version;
+
+    // sizeof(Obstacle) when the file was written, as a sanity check.
+    uint32_t obstacle_size;
+
+    // Side length of a chunk in meters.
+    float chunk_size;
+
+    // Half the largest width or height of any obstacle. Obstacles can poke this far out of their chunk.
+    float max_half_extent;
+
+    uint64_t chunk_count;
+};
+
+struct ChunkEntry {
+    // Chunk (cx, cy) covers x in [cx * chunk_size, (cx + 1) * chunk_size), and the same for y.
+    int32_t cx, cy;
+
+    uint32_t obstacle_count;
+    uint32_t reserved;
+
+    // Where the chunk's obstacles start in the file.
+    uint64_t offset;
+};
+
+// Writes the obstacles out as a chunked world.
+bool save_chunked_world(const char* path, std::vector<Obstacle>& obstacles, float chunk_size);
+
+// Whether the file at path is a chunked world (rather than a level).
+bool is_chunked_world(const char* path);
+
+struct ChunkStreamer;
+
+// Opens a chunked world and starts its loader thread. Nothing is resident until the first update_chunk_streamer.
+// Returns NULL (after printing why) if the file can't be used.
+ChunkStreamer* open_chunk_streamer(const char* path);
+
+void close_chunk_streamer(ChunkStreamer* streamer);
+
+// Makes sure every chunk that could hold an obstacle within radius of (x, y) is resident or on its way, and drops the
+// chunks that are comfortably out of range. With wait set, this only returns once the chunks in range are loaded
+// (so results don't depend on how quick the disk is); otherwise loading happens in the background.
+void update_chunk_streamer(ChunkStreamer* streamer, float x, float y, float radius, bool wait);
+
+// If the set of resident chunks changed since the last call, replaces obstacles with the resident obstacles and
+// returns true. Otherwise leaves obstacles alone and returns false.
+bool collect_resident_obstacles(ChunkStreamer* streamer, std::vector<Obstacle>& obstacles);
+
+struct ChunkStreamerStats {
+    int total_chunks;
+    int resident_chunks;
+    int queued_chunks;
+    long resident_obstacles;
+};
+
+ChunkStreamerStats chunk_streamer_stats(ChunkStreamer* streamer);
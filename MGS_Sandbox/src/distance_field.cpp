@@ -0,0 +1,416 @@
+#include <math.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "distance_field.hpp"
+
+// Stands in for infinity in the transforms, which need (f + q^2) - (f' + q'^2) to stay finite.
+const double FAR_AWAY = 1e30;
+
+// How much room there is past the obstacles on every side: far enough that every clamped distance fits, with a cell
+// to spare.
+static float field_margin(float cell_size) {
+    return DISTANCE_FIELD_MAX_DISTANCE + 2.0f * cell_size;
+}
+
+// Cell range an axis aligned rectangle overlaps (touching doesn't count), clamped to the field. Empty if x0 > x1.
+static void rect_cells(DistanceField* field, float min_x, float min_y, float max_x, float max_y, int* x0, int* y0, int* x1, int* y1) {
+    *x0 = (int)floorf((min_x - field->min_x) / field->cell_size);
+    *y0 = (int)floorf((min_y - field->min_y) / field->cell_size);
+    *x1 = (int)ceilf((max_x - field->min_x) / field->cell_size) - 1;
+    *y1 = (int)ceilf((max_y - field->min_y) / field->cell_size) - 1;
+
+    // Zero sized obstacles still occupy the cell they're in.
+    if (*x1 < *x0) *x1 = *x0;
+    if (*y1 < *y0) *y1 = *y0;
+
+    *x0 = std::max(*x0, 0);
+    *y0 = std::max(*y0, 0);
+    *x1 = std::min(*x1, field->width - 1);
+    *y1 = std::min(*y1, field->height - 1);
+}
+
+static void obstacle_cells(DistanceField* field, const Obstacle& obs, int* x0, int* y0, int* x1, int* y1) {
+    rect_cells(field, obs.x - obs.w/2.0f, obs.y - obs.h/2.0f, obs.x + obs.w/2.0f, obs.y + obs.h/2.0f, x0, y0, x1, y1);
+}
+
+// The squared distance transform of a row of samples: d[q] = min over p of (q - p)^2 + f[p]. v and z are scratch, n and
+// n + 1 long.
+static void distance_transform_1d(const double* f, int n, double* d, int* v, double* z) {
+    int k = 0;
+    v[0] = 0;
+    z[0] = -FAR_AWAY;
+    z[1] = FAR_AWAY;
+
+    // The lower envelope of the parabolas rooted at each sample. z[0] stands in for minus infinity, so k never goes
+    // below zero.
+    for (int q = 1; q < n; q++) {
+        double s;
+
+        for (;;) {
+            int p = v[k];
+            s = ((f[q] + (double)q * q) - (f[p] + (double)p * p)) / (2.0 * (q - p));
+
+            if (s > z[k]) break;
+            k--;
+        }
+
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = FAR_AWAY;
+    }
+
+    k = 0;
+
+    for (int q = 0; q < n; q++) {
+        while (z[k + 1] < q) k++;
+
+        double dq = q - v[k];
+        d[q] = dq * dq + f[v[k]];
+    }
+}
+
+// Squared distances, in cells, from every cell of a w by h window to the nearest cell whose occupied flag equals
+// target.
+static void distance_transform_2d(const std::vector<uint8_t>& occupied, int w, int h, uint8_t target, std::vector<double>& out) {
+    int n = std::max(w, h);
+
+    std::vector<double> f(n), d(n), z(n + 1);
+    std::vector<int> v(n);
+
+    out.resize((size_t)w * h);
+
+    for (int x = 0; x < w; x++) {
+        for (int y = 0; y < h; y++) f[y] = occupied[(size_t)y * w + x] == target ? 0 : FAR_AWAY;
+
+        distance_transform_1d(f.data(), h, d.data(), v.data(), z.data());
+
+        for (int y = 0; y < h; y++) out[(size_t)y * w + x] = d[y];
+    }
+
+    for (int y = 0; y < h; y++) {
+        double* row = &out[(size_t)y * w];
+
+        std::copy(row, row + w, f.begin());
+        distance_transform_1d(f.data(), w, row, v.data(), z.data());
+    }
+}
+
+// Recomputes the distances of the cells in [x0, x1] x [y0, y1] (inclusive), from the occupancy of the cells up to
+// DISTANCE_FIELD_MAX_DISTANCE around them (the sign of their distance).
+static void recompute_cells(DistanceField* field, int x0, int y0, int x1, int y1) {
+    int reach = (int)ceilf(DISTANCE_FIELD_MAX_DISTANCE / field->cell_size) + 1;
+
+    int wx0 = std::max(x0 - reach, 0);
+    int wy0 = std::max(y0 - reach, 0);
+    int wx1 = std::min(x1 + reach, field->width - 1);
+    int wy1 = std::min(y1 + reach, field->height - 1);
+
+    int w = wx1 - wx0 + 1;
+    int h = wy1 - wy0 + 1;
+
+    std::vector<uint8_t> occupied((size_t)w * h);
+
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            occupied[(size_t)y * w + x] = field->distance[(size_t)(wy0 + y) * field->width + wx0 + x] < 0;
+        }
+    }
+
+    std::vector<double> to_occupied, to_free;
+    distance_transform_2d(occupied, w, h, 1, to_occupied);
+    distance_transform_2d(occupied, w, h, 0, to_free);
+
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            size_t i = (size_t)(y - wy0) * w + (x - wx0);
+
+            float distance;
+
+            if (occupied[i]) {
+                distance = -std::min((float)sqrt(to_free[i]) * field->cell_size, DISTANCE_FIELD_MAX_DISTANCE);
+            } else {
+                distance = std::min((float)sqrt(to_occupied[i]) * field->cell_size, DISTANCE_FIELD_MAX_DISTANCE);
+            }
+
+            field->distance[(size_t)y * field->width + x] = distance;
+        }
+    }
+}
+
+// Until the distances are recomputed, occupied cells are marked with -cell_size and free ones with +cell_size.
+static void mark_obstacle(DistanceField* field, const Obstacle& obs, int cx0, int cy0, int cx1, int cy1) {
+    int x0, y0, x1, y1;
+    obstacle_cells(field, obs, &x0, &y0, &x1, &y1);
+
+    x0 = std::max(x0, cx0);
+    y0 = std::max(y0, cy0);
+    x1 = std::min(x1, cx1);
+    y1 = std::min(y1, cy1);
+
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            field->distance[(size_t)y * field->width + x] = -field->cell_size;
+        }
+    }
+}
+
+// Side of the squares create_distance_field recomputes one at a time, in cells, so its scratch stays a few MiB
+// whatever the size of the field.
+const int REBUILD_TILE_SIZE = 512;
+
+// Sets the field's cell size, core, corner and size for the obstacles, without allocating the cells.
+static void place_field(DistanceField* field, std::vector<Obstacle>& obstacles, float cell_size) {
+    field->cell_size = cell_size;
+    field->core_min_x = field->core_min_y = field->core_max_x = field->core_max_y = 0;
+
+    if (obstacles.size() != 0) {
+        field->core_min_x = field->core_min_y = INFINITY;
+        field->core_max_x = field->core_max_y = -INFINITY;
+
+        for (Obstacle obs : obstacles) {
+            field->core_min_x = fminf(field->core_min_x, obs.x - obs.w/2.0f);
+            field->core_min_y = fminf(field->core_min_y, obs.y - obs.h/2.0f);
+            field->core_max_x = fmaxf(field->core_max_x, obs.x + obs.w/2.0f);
+            field->core_max_y = fmaxf(field->core_max_y, obs.y + obs.h/2.0f);
+        }
+    }
+
+    float margin = field_margin(cell_size);
+
+    field->min_x = field->core_min_x - margin;
+    field->min_y = field->core_min_y - margin;
+    field->width = (int)ceilf((field->core_max_x + margin - field->min_x) / cell_size);
+    field->height = (int)ceilf((field->core_max_y + margin - field->min_y) / cell_size);
+}
+
+DistanceField* create_distance_field(std::vector<Obstacle>& obstacles, float cell_size) {
+    DistanceField* field = new DistanceField;
+    place_field(field, obstacles, cell_size);
+
+    field->distance.assign((size_t)field->width * field->height, cell_size);
+
+    for (Obstacle obs : obstacles) {
+        mark_obstacle(field, obs, 0, 0, field->width - 1, field->height - 1);
+    }
+
+    // Each tile only looks at the cells up to DISTANCE_FIELD_MAX_DISTANCE around it, like a patch, so the distances
+    // come out the same as recomputing the whole field at once.
+    for (int y0 = 0; y0 < field->height; y0 += REBUILD_TILE_SIZE) {
+        for (int x0 = 0; x0 < field->width; x0 += REBUILD_TILE_SIZE) {
+            int x1 = std::min(x0 + REBUILD_TILE_SIZE, field->width) - 1;
+            int y1 = std::min(y0 + REBUILD_TILE_SIZE, field->height) - 1;
+
+            recompute_cells(field, x0, y0, x1, y1);
+        }
+    }
+
+    return field;
+}
+
+size_t distance_field_cell_count(std::vector<Obstacle>& obstacles, float cell_size) {
+    DistanceField field;
+    place_field(&field, obstacles, cell_size);
+
+    return (size_t)field.width * field.height;
+}
+
+void destroy_distance_field(DistanceField* field) {
+    delete field;
+}
+
+// Grows the field so its core takes in the rectangle from (min_x, min_y) to (max_x, max_y), adding whole cells on each
+// side so the ones it has stay put. Nothing is closer than DISTANCE_FIELD_MAX_DISTANCE to the new cells yet, since the
+// old margin was at least that wide. Returns false, changing nothing, if it would need more than
+// DISTANCE_FIELD_MAX_CELLS cells.
+static bool grow_distance_field(DistanceField* field, float min_x, float min_y, float max_x, float max_y) {
+    // Sides that move go a quarter of the core further than they have to, so edits creeping outwards don't grow the
+    // field every time.
+    float slack_x = std::max((field->core_max_x - field->core_min_x) / 4.0f, DISTANCE_FIELD_MAX_DISTANCE);
+    float slack_y = std::max((field->core_max_y - field->core_min_y) / 4.0f, DISTANCE_FIELD_MAX_DISTANCE);
+
+    float core_min_x = min_x < field->core_min_x ? min_x - slack_x : field->core_min_x;
+    float core_min_y = min_y < field->core_min_y ? min_y - slack_y : field->core_min_y;
+    float core_max_x = max_x > field->core_max_x ? max_x + slack_x : field->core_max_x;
+    float core_max_y = max_y > field->core_max_y ? max_y + slack_y : field->core_max_y;
+
+    float margin = field_margin(field->cell_size);
+    float old_max_x = field->min_x + field->width * field->cell_size;
+    float old_max_y = field->min_y + field->height * field->cell_size;
+
+    int left = std::max((int)ceilf((field->min_x - (core_min_x - margin)) / field->cell_size), 0);
+    int bottom = std::max((int)ceilf((field->min_y - (core_min_y - margin)) / field->cell_size), 0);
+    int right = std::max((int)ceilf((core_max_x + margin - old_max_x) / field->cell_size), 0);
+    int top = std::max((int)ceilf((core_max_y + margin - old_max_y) / field->cell_size), 0);
+
+    int width = field->width + left + right;
+    int height = field->height + bottom + top;
+
+    if ((size_t)width * height > DISTANCE_FIELD_MAX_CELLS) return false;
+
+    std::vector<float> distance((size_t)width * height, DISTANCE_FIELD_MAX_DISTANCE);
+
+    for (int y = 0; y < field->height; y++) {
+        const float* row = &field->distance[(size_t)y * field->width];
+        std::copy(row, row + field->width, &distance[(size_t)(y + bottom) * width + left]);
+    }
+
+    field->distance.swap(distance);
+
+    field->min_x -= left * field->cell_size;
+    field->min_y -= bottom * field->cell_size;
+    field->width = width;
+    field->height = height;
+
+    field->core_min_x = core_min_x;
+    field->core_min_y = core_min_y;
+    field->core_max_x = core_max_x;
+    field->core_max_y = core_max_y;
+
+    return true;
+}
+
+bool update_distance_field(DistanceField* field, ObstacleGrid* grid, const Obstacle* changed, int count) {
+    float min_x = field->core_min_x, min_y = field->core_min_y;
+    float max_x = field->core_max_x, max_y = field->core_max_y;
+
+    for (int i = 0; i < count; i++) {
+        const Obstacle& obs = changed[i];
+
+        min_x = fminf(min_x, obs.x - obs.w/2.0f);
+        min_y = fminf(min_y, obs.y - obs.h/2.0f);
+        max_x = fmaxf(max_x, obs.x + obs.w/2.0f);
+        max_y = fmaxf(max_y, obs.y + obs.h/2.0f);
+    }
+
+    bool inside = min_x >= field->core_min_x && max_x <= field->core_max_x && min_y >= field->core_min_y && max_y <= field->core_max_y;
+
+    if (!inside && !grow_distance_field(field, min_x, min_y, max_x, max_y)) return false;
+
+    // First get the occupancy right under every changed obstacle, from whatever overlaps it now, so the distances
+    // recomputed next all see every change.
+    std::vector<Obstacle> overlapping;
+
+    for (int i = 0; i < count; i++) {
+        int x0, y0, x1, y1;
+        obstacle_cells(field, changed[i], &x0, &y0, &x1, &y1);
+
+        for (int y = y0; y <= y1; y++) {
+            for (int x = x0; x <= x1; x++) {
+                field->distance[(size_t)y * field->width + x] = field->cell_size;
+            }
+        }
+
+        float min_x = field->min_x + x0 * field->cell_size;
+        float min_y = field->min_y + y0 * field->cell_size;
+        float max_x = field->min_x + (x1 + 1) * field->cell_size;
+        float max_y = field->min_y + (y1 + 1) * field->cell_size;
+
+        overlapping.clear();
+        query_obstacle_grid(grid, min_x, min_y, max_x, max_y, overlapping);
+
+        for (const Obstacle& other : overlapping) {
+            mark_obstacle(field, other, x0, y0, x1, y1);
+        }
+    }
+
+    int reach = (int)ceilf(DISTANCE_FIELD_MAX_DISTANCE / field->cell_size) + 1;
+
+    for (int i = 0; i < count; i++) {
+        int x0, y0, x1, y1;
+        obstacle_cells(field, changed[i], &x0, &y0, &x1, &y1);
+
+        recompute_cells(field, std::max(x0 - reach, 0), std::max(y0 - reach, 0), std::min(x1 + reach, field->width - 1), std::min(y1 + reach, field->height - 1));
+    }
+
+    return true;
+}
+
+// The field at the cell (x, y) is in. Outside the field, only how far it is from the field's edge is known.
+static float field_distance(DistanceField* field, float x, float y, bool* out_inside_field) {
+    int cx = (int)floorf((x - field->min_x) / field->cell_size);
+    int cy = (int)floorf((y - field->min_y) / field->cell_size);
+
+    *out_inside_field = cx >= 0 && cy >= 0 && cx < field->width && cy < field->height;
+    if (!*out_inside_field) return 0;
+
+    return field->distance[(size_t)cy * field->width + cx];
+}
+
+// Clearance from a point outside the field: every obstacle is at least the margin inside its edge.
+static float outside_clearance(DistanceField* field, float x, float y) {
+    float max_x = field->min_x + field->width * field->cell_size;
+    float max_y = field->min_y + field->height * field->cell_size;
+
+    float dx = fmaxf(fmaxf(field->min_x - x, x - max_x), 0.0f);
+    float dy = fmaxf(fmaxf(field->min_y - y, y - max_y), 0.0f);
+
+    return sqrtf(dx * dx + dy * dy) + field_margin(field->cell_size);
+}
+
+float distance_field_clearance(DistanceField* field, float x, float y) {
+    bool inside_field;
+    float distance = field_distance(field, x, y, &inside_field);
+
+    if (!inside_field) return outside_clearance(field, x, y);
+
+    // (x, y) is up to half a diagonal from its cell's center, and an obstacle is up to half a diagonal from the center
+    // of the occupied cell it's in.
+    return distance - field->cell_size * (float)M_SQRT2;
+}
+
+// Once the field says a ray has come this close to an obstacle, the next stretch of it is tested exactly.
+const float SDF_EXACT_CLEARANCE = 0.5f;
+
+// How much of a ray each exact test covers, in meters.
+const float SDF_EXACT_STRETCH = 1.0f;
+
+// Room left for rounding in the points along a ray, in meters: safe steps stop this much short, and the exact tests
+// look this much further around the ray.
+const float SDF_SLACK = 0.01f;
+
+static float sphere_trace(DistanceField* field, ObstacleGrid* grid, float x, float y, float dx, float dy, float max_scan_distance) {
+    // The same segment and squared distances as lidar_scan, so the ranges come out exactly the same.
+    float x1 = x + max_scan_distance * dx;
+    float y1 = y + max_scan_distance * dy;
+
+    float min_sq = max_scan_distance * max_scan_distance;
+
+    float t = 0;
+
+    while (t < max_scan_distance) {
+        float px = x + t * dx;
+        float py = y + t * dy;
+
+        float clearance = distance_field_clearance(field, px, py);
+
+        // Nothing is that close to this point, so the ray can't hit anything before it has gone that far.
+        if (clearance >= SDF_EXACT_CLEARANCE) {
+            t += clearance - SDF_SLACK;
+            continue;
+        }
+
+        // Close to something: test the obstacles around the next stretch of the ray. Nothing was hit before it, so once
+        // the nearest hit so far is within the stretch, nothing further on can beat it.
+        float end = fminf(t + SDF_EXACT_STRETCH, max_scan_distance);
+        float ex = x + end * dx;
+        float ey = y + end * dy;
+
+        ray_obstacle_grid_rect_collision(grid, fminf(px, ex) - SDF_SLACK, fminf(py, ey) - SDF_SLACK, fmaxf(px, ex) + SDF_SLACK, fmaxf(py, ey) + SDF_SLACK, x, y, x1, y1, &min_sq);
+
+        if (min_sq <= end * end) break;
+
+        t = end;
+    }
+
+    return sqrtf(min_sq);
+}
+
+void lidar_scan_sdf(float x, float y, const float* dir_x, const float* dir_y, int count, DistanceField* field, ObstacleGrid* grid, float* out_ranges, float max_scan_distance) {
+    for (int i = 0; i < count; i++) {
+        out_ranges[i] = sphere_trace(field, grid, x, y, dir_x[i], dir_y[i], max_scan_distance);
+    }
+}
@@ -0,0 +1,70 @@
+/*
+    A signed distance field baked from the obstacles: a raster over the level where every cell holds how far its center
+    is from the nearest obstacle, so "how much room is there around this point" is one lookup.
+
+    Cells any obstacle overlaps are occupied, and the distances between cell centers are exact Euclidean ones, worked
+    out with the linear time transform of Felzenszwalb and Huttenlocher ("Distance Transforms of Sampled Functions"):
+    one pass down every column and one along every row. Distances are clamped to DISTANCE_FIELD_MAX_DISTANCE, which
+    is what lets an edit only recompute the cells around it.
+
+    LIDAR rays are sphere traced through it: each step goes as far as the clearance at the current point says is
+    safe, so rays cross open space in a few big steps. Once a ray gets close to something, the stretch of it just ahead
+    is tested exactly against the obstacles in the obstacle grid cells around it, and tracing carries on past it if
+    nothing there was hit. The field only decides how far rays can skip, so the ranges are exactly lidar_scan's.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#include <vector>
+
+#include "obstacle.hpp"
+#include "obstacle_grid.hpp"
+
+// In meters. Clearances further than this aren't told apart.
+const float DISTANCE_FIELD_MAX_DISTANCE = 4.0f;
+
+// Worlds that need a field with more cells than this don't get one. With 0.1 m cells that's 400 m by 400 m, in 64 MiB.
+const size_t DISTANCE_FIELD_MAX_CELLS = (size_t)1 << 24;
+
+struct DistanceField {
+    // World position of the corner of cell (0, 0).
+    float min_x, min_y;
+
+    float cell_size;
+
+    int width, height;
+
+    // The area edits can be patched into without growing the field: at first, the area the obstacles were in when
+    // it was built. The field reaches well past it.
+    float core_min_x, core_min_y, core_max_x, core_max_y;
+
+    // Row by row, the distance in meters from each cell's center to the nearest occupied cell's center, or for an
+    // occupied cell, minus the distance to the nearest free one's. Clamped to DISTANCE_FIELD_MAX_DISTANCE either way.
+    std::vector<float> distance;
+};
+
+// Bakes the obstacles into a field with cells of cell_size meters, covering them and a margin around them. Scratch
+// memory doesn't grow with the size of the field.
+DistanceField* create_distance_field(std::vector<Obstacle>& obstacles, float cell_size);
+
+// How many cells create_distance_field would make for the obstacles, without making them.
+size_t distance_field_cell_count(std::vector<Obstacle>& obstacles, float cell_size);
+
+void destroy_distance_field(DistanceField* field);
+
+// Patches in obstacles that were added or removed since the field was built, looking up what's around them in grid
+// (which has to be up to date). Only the cells within DISTANCE_FIELD_MAX_DISTANCE of them are recomputed, and they
+// come out exactly as a rebuild would make them. If any of them is outside the core, the field first grows (with
+// room to spare) to take them in, keeping the distances it has. Returns false, changing nothing, if that would take
+// more than DISTANCE_FIELD_MAX_CELLS cells.
+bool update_distance_field(DistanceField* field, ObstacleGrid* grid, const Obstacle* changed, int count);
+
+// A lower bound on the distance from (x, y) to the nearest obstacle, in one lookup: if it's positive, a circle of that
+// radius around (x, y) is clear. Zero or less means (x, y) may be touching or inside an obstacle.
+float distance_field_clearance(DistanceField* field, float x, float y);
+
+// Same as lidar_scan, and bit-identical to it, but sphere traces the rays through the field, so open space costs a few
+// lookups whatever the number of obstacles. grid has to hold the same obstacles as the field.
+void lidar_scan_sdf(float x, float y, const float* dir_x, const float* dir_y, int count, DistanceField* field, ObstacleGrid* grid, float* out_ranges, float max_scan_distance);
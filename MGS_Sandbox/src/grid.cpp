@@ -1,12 +1,202 @@
+#include <string.h>
+
+#include <algorithm>
+
 #include "grid.hpp"
+#include "memory.hpp"
 
-Grid* create_grid(int radius) {
-    int size = radius * 2 + 1;
-    float* grid_memory = new float[size * size];
+// Interleaves the bits of x and y.
+static uint64_t morton(uint32_t x, uint32_t y) {
+    uint64_t m = 0;
 
-    for (int i = 0; i < size * size; i++) {
-        grid_memory[i] = 0.0f;
+    for (int bit = 0; bit < 32; bit++) {
+        m |= (uint64_t)((x >> bit) & 1) << (2 * bit);
+        m |= (uint64_t)((y >> bit) & 1) << (2 * bit + 1);
     }
 
-    return new Grid{ size, radius, grid_memory };
-}
\ No newline at end of file
+    return m;
+}
+
+void TiledLayout::init(int radius) {
+    size = radius * 2 + 1;
+    offset = radius;
+    tiles_per_side = (size + GRID_TILE_MASK) / GRID_TILE_SIZE;
+
+    struct Tile {
+        uint64_t order;
+        int tq, tr;
+    };
+
+    std::vector<Tile> tiles;
+
+    for (int tq = 0; tq < tiles_per_side; tq++) {
+        for (int tr = 0; tr < tiles_per_side; tr++) {
+            // Keep the tile if any of its cells is within the radius.
+            bool inside = false;
+
+            for (int lq = 0; lq < GRID_TILE_SIZE && !inside; lq++) {
+                for (int lr = 0; lr < GRID_TILE_SIZE && !inside; lr++) {
+                    inside = hex_length(tq * GRID_TILE_SIZE + lq - offset, tr * GRID_TILE_SIZE + lr - offset) <= offset;
+                }
+            }
+
+            if (inside) tiles.push_back({ morton(tq, tr), tq, tr });
+        }
+    }
+
+    std::sort(tiles.begin(), tiles.end(), [](const Tile& a, const Tile& b) { return a.order < b.order; });
+
+    tile_start.assign((size_t)tiles_per_side * tiles_per_side, 0);
+    tile_q.clear();
+    tile_r.clear();
+
+    for (size_t i = 0; i < tiles.size(); i++) {
+        tile_start[(size_t)tiles[i].tq * tiles_per_side + tiles[i].tr] = (uint32_t)((i + 1) * GRID_TILE_CELLS);
+
+        tile_q.push_back(tiles[i].tq * GRID_TILE_SIZE - offset);
+        tile_r.push_back(tiles[i].tr * GRID_TILE_SIZE - offset);
+    }
+}
+
+template <typename T>
+static void inflate_cells(const Grid<T, RhombusLayout>* src, Grid<T, RhombusLayout>* dst) {
+    const RhombusLayout& layout = src->layout;
+    int offset = src->layout.offset;
+
+    ptrdiff_t delta[6];
+    for (int i = 0; i < 6; i++) delta[i] = layout.neighbour_delta(i);
+
+    for (int q = -offset; q <= offset; q++) {
+        int r0 = std::max(-offset, -offset - q);
+        int r1 = std::min(offset, offset - q);
+
+        // Cells strictly inside the radius have all their neighbours; only the ends of the row don't.
+        int inner0 = std::max(-offset + 1, -offset - q + 1);
+        int inner1 = std::min(offset - 1, offset - q - 1);
+
+        if (q == -offset || q == offset || inner0 > inner1) {
+            inner0 = r1 + 1;
+            inner1 = r1;
+        }
+
+        for (int r = r0; r < inner0; r++) {
+            dst->cells[layout.index(q, r)] = max_with_neighbours(src, src->cells, q, r, layout.index(q, r));
+        }
+
+        if (inner0 <= inner1) {
+            size_t first = layout.index(q, inner0);
+            int count = inner1 - inner0 + 1;
+
+            // In runs of a fixed length, which the compiler vectorizes without a scalar tail for every cell type.
+            int i = 0;
+
+            for (; i + GRID_TILE_SIZE <= count; i += GRID_TILE_SIZE) {
+                max_with_neighbours_run(src->cells + first + i, dst->cells + first + i, GRID_TILE_SIZE, delta);
+            }
+
+            max_with_neighbours_run(src->cells + first + i, dst->cells + first + i, count - i, delta);
+        }
+
+        for (int r = inner1 + 1; r <= r1; r++) {
+            dst->cells[layout.index(q, r)] = max_with_neighbours(src, src->cells, q, r, layout.index(q, r));
+        }
+    }
+}
+
+// Side of a tile plus a cell of its neighbours all around.
+const int GRID_HALO_SIZE = GRID_TILE_SIZE + 2;
+
+// Copies the tile starting at starts[1][1] and the cells around it into halo, so the cell at (lq, lr) in the tile is at
+// halo[(lq + 1) * GRID_HALO_SIZE + lr + 1]. starts[1 + dtq][1 + dtr] is the first cell of the tile (dtq, dtr) tiles away.
+template <typename T>
+static void load_tile_halo(const T* in, const size_t starts[3][3], T* halo) {
+    const int S = GRID_TILE_SIZE, M = GRID_TILE_MASK, H = GRID_HALO_SIZE;
+
+    // The last row of the tile before in q, and the first row of the one after.
+    memcpy(halo + 1, in + starts[0][1] + M * S, sizeof(T) * S);
+    memcpy(halo + (S + 1) * H + 1, in + starts[2][1], sizeof(T) * S);
+
+    halo[0] = in[starts[0][0] + M * S + M];
+    halo[S + 1] = in[starts[0][2] + M * S];
+    halo[(S + 1) * H] = in[starts[2][0] + M];
+    halo[(S + 1) * H + S + 1] = in[starts[2][2]];
+
+    for (int lq = 0; lq < S; lq++) {
+        T* row = halo + (lq + 1) * H;
+
+        row[0] = in[starts[1][0] + lq * S + M];
+        memcpy(row + 1, in + starts[1][1] + lq * S, sizeof(T) * S);
+        row[S + 1] = in[starts[1][2] + lq * S];
+    }
+}
+
+template <typename T>
+static void inflate_cells(const Grid<T, TiledLayout>* src, Grid<T, TiledLayout>* dst) {
+    const TiledLayout& layout = src->layout;
+    int offset = src->layout.offset;
+
+    // Every cell of a tile is inflated from a copy of it with its neighbours around it, so the cells on the border of
+    // the tile don't need special cases.
+    alignas(CACHE_LINE_SIZE) T halo[GRID_HALO_SIZE * GRID_HALO_SIZE];
+
+    ptrdiff_t delta[6];
+    for (int i = 0; i < 6; i++) delta[i] = (ptrdiff_t)HEX_NEIGHBOUR_DQ[i] * GRID_HALO_SIZE + HEX_NEIGHBOUR_DR[i];
+
+    for (size_t t = 0; t < layout.tile_q.size(); t++) {
+        size_t start = (t + 1) * GRID_TILE_CELLS;
+        int q0 = layout.tile_q[t], r0 = layout.tile_r[t];
+
+        size_t starts[3][3];
+
+        for (int dtq = -1; dtq <= 1; dtq++) {
+            for (int dtr = -1; dtr <= 1; dtr++) {
+                int tq = (q0 + offset) / GRID_TILE_SIZE + dtq;
+                int tr = (r0 + offset) / GRID_TILE_SIZE + dtr;
+
+                // Tiles off the rhombus only border cells outside the radius, so scratch will do for them.
+                bool on_rhombus = tq >= 0 && tr >= 0 && tq < layout.tiles_per_side && tr < layout.tiles_per_side;
+                starts[dtq + 1][dtr + 1] = on_rhombus ? layout.tile_start[(size_t)tq * layout.tiles_per_side + tr] : 0;
+            }
+        }
+
+        load_tile_halo(src->cells, starts, halo);
+
+        // If the corners are strictly inside the radius, so is the whole tile, and every cell has all its neighbours.
+        int q1 = q0 + GRID_TILE_MASK, r1 = r0 + GRID_TILE_MASK;
+        bool deep = hex_length(q0, r0) < offset && hex_length(q1, r0) < offset && hex_length(q0, r1) < offset && hex_length(q1, r1) < offset;
+
+        for (int lq = 0; lq < GRID_TILE_SIZE; lq++) {
+            const T* in_row = halo + (lq + 1) * GRID_HALO_SIZE + 1;
+            T* out_row = dst->cells + start + (lq << GRID_TILE_SHIFT);
+
+            if (deep) {
+                max_with_neighbours_run(in_row, out_row, GRID_TILE_SIZE, delta);
+                continue;
+            }
+
+            for (int lr = 0; lr < GRID_TILE_SIZE; lr++) {
+                int q = q0 + lq, r = r0 + lr;
+                int length = hex_length(q, r);
+
+                // Only the cells right on the radius are missing neighbours.
+                if (length < offset) {
+                    max_with_neighbours_run(in_row + lr, out_row + lr, 1, delta);
+                } else if (length == offset) {
+                    out_row[lr] = max_with_neighbours(src, src->cells, q, r, start + (lq << GRID_TILE_SHIFT) + lr);
+                }
+            }
+        }
+    }
+}
+
+template <typename T, typename Layout>
+void inflate_grid(const Grid<T, Layout>* src, Grid<T, Layout>* dst) {
+    inflate_cells(src, dst);
+}
+
+template void inflate_grid(const Grid<uint8_t, RhombusLayout>* src, Grid<uint8_t, RhombusLayout>* dst);
+template void inflate_grid(const Grid<uint16_t, RhombusLayout>* src, Grid<uint16_t, RhombusLayout>* dst);
+template void inflate_grid(const Grid<float, RhombusLayout>* src, Grid<float, RhombusLayout>* dst);
+template void inflate_grid(const Grid<uint8_t, TiledLayout>* src, Grid<uint8_t, TiledLayout>* dst);
+template void inflate_grid(const Grid<uint16_t, TiledLayout>* src, Grid<uint16_t, TiledLayout>* dst);
+template void inflate_grid(const Grid<float, TiledLayout>* src, Grid<float, TiledLayout>* dst);
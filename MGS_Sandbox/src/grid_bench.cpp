@@ -0,0 +1,581 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <queue>
+#include <vector>
+
+#include "grid.hpp"
+#include "grid_bench.hpp"
+#include "hex_dstar.hpp"
+#include "hex_hpa.hpp"
+#include "hex_planner.hpp"
+#include "hex_pyramid.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+// Marks about one cell in fifty as occupied (keeping clear of the origin), the same cells whatever the layout.
+template <typename T, typename Layout>
+static void fill_obstacles(Grid<T, Layout>* grid) {
+    for_each_grid_cell(grid, [&](int q, int r, size_t index) {
+        uint32_t h = (uint32_t)(q * 73856093) ^ (uint32_t)(r * 19349663);
+        h ^= h >> 13;
+        h *= 0x5bd1e995;
+        h ^= h >> 15;
+
+        grid->cells[index] = h % 50 == 0 && hex_length(q, r) > 2 ? 1 : 0;
+    });
+}
+
+// Breadth-first search from the origin through free cells, writing the hop count to dist (an array as big as the
+// grid's storage, -1 for unreached). This is the access pattern of a planner. Returns how many cells were reached.
+template <typename T, typename Layout>
+static long flood_fill(const Grid<T, Layout>* grid, std::vector<int>& dist) {
+    dist.assign(grid->layout.cell_count(), -1);
+
+    std::vector<int> queue_q, queue_r;
+    queue_q.push_back(0);
+    queue_r.push_back(0);
+    dist[grid->layout.index(0, 0)] = 0;
+
+    for (size_t head = 0; head < queue_q.size(); head++) {
+        int q = queue_q[head], r = queue_r[head];
+        int d = dist[grid->layout.index(q, r)];
+
+        for (int i = 0; i < 6; i++) {
+            int nq = q + HEX_NEIGHBOUR_DQ[i], nr = r + HEX_NEIGHBOUR_DR[i];
+            if (hex_length(nq, nr) > grid->layout.offset) continue;
+
+            size_t index = grid->layout.index(nq, nr);
+            if (dist[index] >= 0 || grid->cells[index] > 0) continue;
+
+            dist[index] = d + 1;
+            queue_q.push_back(nq);
+            queue_r.push_back(nr);
+        }
+    }
+
+    return (long)queue_q.size();
+}
+
+struct LayoutResult {
+    double inflate_ms;
+    double copy_ms;
+    double flood_ms;
+    size_t bytes;
+
+    long reached;
+
+    // Sum over every cell of the inflated grid and of the hop counts, in (q, r) order, to compare layouts with.
+    double inflated_sum;
+    long dist_sum;
+};
+
+template <typename T, typename Layout>
+static LayoutResult benchmark_layout(int radius, int passes) {
+    LayoutResult result = {};
+
+    Grid<T, Layout> a_grid(radius), b_grid(radius);
+    Grid<T, Layout>* a = &a_grid;
+    Grid<T, Layout>* b = &b_grid;
+
+    fill_obstacles(a);
+
+    Clock::time_point t0 = Clock::now();
+
+    // Grow the obstacles by one hex per pass, ping-ponging between the two grids.
+    for (int i = 0; i < passes; i++) {
+        if (i % 2 == 0) {
+            inflate_grid(a, b);
+        } else {
+            inflate_grid(b, a);
+        }
+    }
+
+    Clock::time_point t1 = Clock::now();
+
+    for (int i = 0; i < passes; i++) {
+        b->copy_from(*a);
+    }
+
+    Clock::time_point t1_copy = Clock::now();
+
+    // Only inflate once for the planning pass, so there's still somewhere to go.
+    fill_obstacles(a);
+    inflate_grid(a, b);
+
+    std::vector<int> dist;
+
+    Clock::time_point t2 = Clock::now();
+    result.reached = flood_fill(b, dist);
+    Clock::time_point t3 = Clock::now();
+
+    result.inflate_ms = std::chrono::duration<double, std::milli>(t1 - t0).count() / passes;
+    result.copy_ms = std::chrono::duration<double, std::milli>(t1_copy - t1).count() / passes;
+    result.flood_ms = std::chrono::duration<double, std::milli>(t3 - t2).count();
+    result.bytes = a->memory() + b->memory();
+
+    for (int q = -a->layout.offset; q <= a->layout.offset; q++) {
+        for (int r = -a->layout.offset; r <= a->layout.offset; r++) {
+            if (hex_length(q, r) > a->layout.offset) continue;
+
+            result.inflated_sum += b->get(q, r);
+            result.dist_sum += dist[b->layout.index(q, r)];
+        }
+    }
+
+    return result;
+}
+
+static uint32_t next_random(uint32_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+
+    return *state;
+}
+
+// Scatters obstacles about 7 hexes across, the way inflated maps look. scratch has to be the same size as grid.
+static void fill_blobs(Grid<float>* grid, Grid<float>* scratch, uint32_t* seed) {
+    for_each_grid_cell(grid, [&](int q, int r, size_t index) {
+        grid->cells[index] = next_random(seed) % 2000 == 0 && hex_length(q, r) > 8 ? 1.0f : 0.0f;
+    });
+
+    for (int i = 0; i < 3; i++) {
+        inflate_grid(grid, scratch);
+        inflate_grid(scratch, grid);
+    }
+}
+
+// Box queries of the sort a planner or collision check makes, against a pyramid and against its base cell by cell.
+// Returns false if the two disagree.
+static bool benchmark_pyramid(int radius) {
+    const int LEVELS = 6;
+    const int QUERIES = 20000;
+    const int QUERY_RADIUS = 16;
+    const int UPDATES = 100000;
+
+    HexPyramid* max_pyramid = create_hex_pyramid(radius, LEVELS, HEX_AGGREGATE_MAX, 0.5f);
+    HexPyramid* count_pyramid = create_hex_pyramid(radius, LEVELS, HEX_AGGREGATE_OCCUPIED, 0.5f);
+
+    Grid<float>& base = max_pyramid->levels[0];
+    Grid<float> scratch(radius);
+
+    uint32_t seed = 12345;
+
+    fill_blobs(&base, &scratch, &seed);
+
+    count_pyramid->levels[0].copy_from(base);
+
+    Clock::time_point t0 = Clock::now();
+    rebuild_hex_pyramid(max_pyramid);
+    Clock::time_point t1 = Clock::now();
+    rebuild_hex_pyramid(count_pyramid);
+
+    std::vector<int> box_q(QUERIES), box_r(QUERIES);
+
+    for (int i = 0; i < QUERIES; i++) {
+        box_q[i] = (int)(next_random(&seed) % (2 * radius + 1)) - radius;
+        box_r[i] = (int)(next_random(&seed) % (2 * radius + 1)) - radius;
+    }
+
+    // Cell by cell. Stops at the first occupied cell, like a collision check would.
+    long brute_any = 0, brute_count = 0;
+
+    Clock::time_point t2 = Clock::now();
+
+    for (int i = 0; i < QUERIES; i++) {
+        bool any = false;
+
+        for (int q = box_q[i] - QUERY_RADIUS; q <= box_q[i] + QUERY_RADIUS && !any; q++) {
+            for (int r = box_r[i] - QUERY_RADIUS; r <= box_r[i] + QUERY_RADIUS && !any; r++) {
+                if (q >= -radius && q <= radius && r >= -radius && r <= radius && base.get(q, r) > 0.5f) any = true;
+            }
+        }
+
+        brute_any += any;
+    }
+
+    Clock::time_point t3 = Clock::now();
+
+    for (int i = 0; i < QUERIES; i++) {
+        for (int q = box_q[i] - QUERY_RADIUS; q <= box_q[i] + QUERY_RADIUS; q++) {
+            for (int r = box_r[i] - QUERY_RADIUS; r <= box_r[i] + QUERY_RADIUS; r++) {
+                if (q >= -radius && q <= radius && r >= -radius && r <= radius && base.get(q, r) > 0.5f) brute_count++;
+            }
+        }
+    }
+
+    Clock::time_point t4 = Clock::now();
+
+    long pyramid_any = 0, pyramid_count = 0;
+
+    for (int i = 0; i < QUERIES; i++) {
+        pyramid_any += hex_pyramid_any_occupied(max_pyramid, box_q[i] - QUERY_RADIUS, box_r[i] - QUERY_RADIUS, box_q[i] + QUERY_RADIUS, box_r[i] + QUERY_RADIUS);
+    }
+
+    Clock::time_point t5 = Clock::now();
+
+    for (int i = 0; i < QUERIES; i++) {
+        pyramid_count += hex_pyramid_count_occupied(count_pyramid, box_q[i] - QUERY_RADIUS, box_r[i] - QUERY_RADIUS, box_q[i] + QUERY_RADIUS, box_r[i] + QUERY_RADIUS);
+    }
+
+    Clock::time_point t6 = Clock::now();
+
+    // Incremental updates, then a check that they left the pyramid the same as a rebuild would.
+    for (int i = 0; i < UPDATES; i++) {
+        int q = (int)(next_random(&seed) % (2 * radius + 1)) - radius;
+        int r = (int)(next_random(&seed) % (2 * radius + 1)) - radius;
+
+        set_hex_pyramid(count_pyramid, q, r, (next_random(&seed) & 1) ? 1.0f : 0.0f);
+    }
+
+    Clock::time_point t7 = Clock::now();
+
+    std::vector<Grid<float>> updated;
+
+    for (int level = 1; level < LEVELS; level++) {
+        updated.emplace_back(count_pyramid->levels[level].layout.offset);
+        updated.back().copy_from(count_pyramid->levels[level]);
+    }
+
+    rebuild_hex_pyramid(count_pyramid);
+
+    bool updates_match = true;
+
+    for (int level = 1; level < LEVELS; level++) {
+        const Grid<float>& rebuilt = count_pyramid->levels[level];
+
+        for (size_t i = 0; i < rebuilt.word_count; i++) {
+            if (updated[level - 1].cells[i] != rebuilt.cells[i]) updates_match = false;
+        }
+    }
+
+    auto ms = [](Clock::time_point a, Clock::time_point b) {
+        return std::chrono::duration<double, std::milli>(b - a).count();
+    };
+
+    printf("> Hex pyramid of %d levels, %d queries of %dx%d hexes.\n", LEVELS, QUERIES, 2 * QUERY_RADIUS + 1, 2 * QUERY_RADIUS + 1);
+    printf(">   %-14s %12s %12s\n", "query", "cell by cell", "pyramid");
+    printf(">   %-14s %10.3f ms %10.3f ms\n", "any occupied", ms(t2, t3), ms(t4, t5));
+    printf(">   %-14s %10.3f ms %10.3f ms\n", "count occupied", ms(t3, t4), ms(t5, t6));
+    printf("> %ld boxes have something in them, %ld occupied cells in all.\n", brute_any, brute_count);
+    printf("> Rebuilding took %.3f ms, %d incremental updates %.3f ms.\n", ms(t0, t1), UPDATES, ms(t6, t7));
+
+    destroy_hex_pyramid(max_pyramid);
+    destroy_hex_pyramid(count_pyramid);
+
+    if (brute_any != pyramid_any || brute_count != pyramid_count) {
+        printf("[!] The pyramid doesn't agree with the grid!\n");
+        return false;
+    }
+
+    if (!updates_match) {
+        printf("[!] Incremental updates don't match a rebuild!\n");
+        return false;
+    }
+
+    return true;
+}
+
+// Cost of the path, or a negative number if it isn't a path the planner may take from start to goal.
+static double check_path(const HexPlanner* planner, const Grid<float>* grid, const std::vector<HexCell>& path, HexCell start, HexCell goal) {
+    if (path.empty() || path.front().q != start.q || path.front().r != start.r || path.back().q != goal.q || path.back().r != goal.r) return -1;
+
+    double cost = 0;
+
+    for (size_t i = 1; i < path.size(); i++) {
+        if (hex_length(path[i].q - path[i - 1].q, path[i].r - path[i - 1].r) != 1) return -1;
+
+        float step = hex_step_cost(planner, grid->get(path[i].q, path[i].r));
+        if (step < 0) return -1;
+
+        cost += step;
+    }
+
+    return cost;
+}
+
+// Plain Dijkstra, to check the planner against. Returns the cost of the cheapest path, or a negative number.
+static double reference_cost(const HexPlanner* planner, const Grid<float>* grid, HexCell start, HexCell goal) {
+    typedef std::pair<double, size_t> Entry;
+
+    std::vector<double> dist(grid->layout.cell_count(), -1);
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+
+    size_t goal_index = grid->layout.index(goal.q, goal.r);
+
+    open.push({ 0.0, grid->layout.index(start.q, start.r) });
+
+    while (!open.empty()) {
+        Entry entry = open.top();
+        open.pop();
+
+        if (dist[entry.second] >= 0) continue;
+        dist[entry.second] = entry.first;
+
+        if (entry.second == goal_index) return entry.first;
+
+        int q = (int)(entry.second / grid->layout.size) - grid->layout.offset;
+        int r = (int)(entry.second % grid->layout.size) - grid->layout.offset;
+
+        size_t neighbours[6];
+        int count = grid_neighbours(grid, q, r, neighbours);
+
+        for (int i = 0; i < count; i++) {
+            float step = hex_step_cost(planner, grid->cells[neighbours[i]]);
+            if (step >= 0 && dist[neighbours[i]] < 0) open.push({ entry.first + step, neighbours[i] });
+        }
+    }
+
+    return -1;
+}
+
+// Plans between random pairs of hexes on a map of blobs and rough ground. Returns false if a path is invalid or, for
+// the first few queries, costs more than the cheapest one.
+static bool benchmark_planners(int radius) {
+    const int QUERIES = 20;
+    const int CHECKED_QUERIES = 3;
+
+    Grid<float> grid(radius), scratch(radius);
+
+    uint32_t seed = 777;
+    fill_blobs(&grid, &scratch, &seed);
+
+    for_each_grid_cell(&grid, [&](int q, int r, size_t index) {
+        if (grid.cells[index] == 0 && next_random(&seed) % 10 == 0) grid.cells[index] = 0.3f;
+    });
+
+    HexPlanner* planner = create_hex_planner(&grid, 4.0f, 0.5f);
+    std::vector<HexCell> path;
+
+    const int CLUSTER_SIZE = 16;
+
+    Clock::time_point build_start = Clock::now();
+    HexHpa* hpa = create_hex_hpa(&grid, CLUSTER_SIZE, 4.0f, 0.5f);
+    double hpa_build_ms = std::chrono::duration<double, std::milli>(Clock::now() - build_start).count();
+
+    int found = 0;
+    long expanded = 0, hpa_expanded = 0;
+    double total_ms = 0, hpa_ms = 0;
+    double worst_ratio = 1, ratio_sum = 0;
+    bool ok = true;
+
+    for (int i = 0; i < QUERIES; i++) {
+        HexCell ends[2];
+
+        for (HexCell& end : ends) {
+            do {
+                end.q = (int16_t)((int)(next_random(&seed) % (2 * radius + 1)) - radius);
+                end.r = (int16_t)((int)(next_random(&seed) % (2 * radius + 1)) - radius);
+            } while (hex_length(end.q, end.r) > radius || grid.get(end.q, end.r) > 0.5f);
+        }
+
+        Clock::time_point t0 = Clock::now();
+        bool planned = plan_hex_path(planner, &grid, ends[0].q, ends[0].r, ends[1].q, ends[1].r, path);
+        Clock::time_point t1 = Clock::now();
+
+        total_ms += std::chrono::duration<double, std::milli>(t1 - t0).count();
+        expanded += planner->expanded;
+
+        if (planned) {
+            found++;
+
+            double cost = check_path(planner, &grid, path, ends[0], ends[1]);
+
+            if (cost < 0 || fabs(cost - planner->path_cost) > 1e-3 * cost) {
+                printf("[!] A* returned a broken path!\n");
+                ok = false;
+            }
+        }
+
+        Clock::time_point t2 = Clock::now();
+        bool hpa_planned = plan_hex_hpa_path(hpa, &grid, ends[0].q, ends[0].r, ends[1].q, ends[1].r, path);
+        Clock::time_point t3 = Clock::now();
+
+        hpa_ms += std::chrono::duration<double, std::milli>(t3 - t2).count();
+        hpa_expanded += hpa->abstract_expanded + hpa->refine_expanded;
+
+        if (hpa_planned) {
+            double cost = check_path(planner, &grid, path, ends[0], ends[1]);
+
+            if (cost < 0 || fabs(cost - hpa->path_cost) > 1e-3 * cost) {
+                printf("[!] HPA* returned a broken path!\n");
+                ok = false;
+            }
+        }
+
+        // HPA* can miss routes that only squeeze diagonally between clusters, so it's allowed to fail where A* didn't.
+        if (hpa_planned && !planned) {
+            printf("[!] HPA* found a path where A* didn't!\n");
+            ok = false;
+        }
+
+        if (hpa_planned && planned) {
+            double ratio = hpa->path_cost / planner->path_cost;
+
+            ratio_sum += ratio;
+            if (ratio > worst_ratio) worst_ratio = ratio;
+        }
+
+        if (i < CHECKED_QUERIES) {
+            double best = reference_cost(planner, &grid, ends[0], ends[1]);
+
+            if ((best < 0) == planned || (planned && fabs(best - planner->path_cost) > 1e-3 * best)) {
+                printf("[!] A* found a cost of %.3f where the cheapest path costs %.3f!\n", planned ? planner->path_cost : -1.0f, best);
+                ok = false;
+            }
+        }
+    }
+
+    printf("> Planning between %d random pairs of hexes (%d reachable).\n", QUERIES, found);
+    printf(">   %-8s %12s %14s\n", "planner", "ms/query", "expanded/query");
+    printf(">   %-8s %12.3f %14ld\n", "A*", total_ms / QUERIES, expanded / QUERIES);
+    printf(">   %-8s %12.3f %14ld\n", "HPA*", hpa_ms / QUERIES, hpa_expanded / QUERIES);
+    printf("> HPA* paths cost %.2f%% more on average (%.2f%% at worst). Building its graph (%dx%d clusters) took %.1f ms.\n", 100.0 * (ratio_sum / (found ? found : 1) - 1), 100.0 * (worst_ratio - 1), CLUSTER_SIZE, CLUSTER_SIZE, hpa_build_ms);
+
+    // Replanning as the rover drives: every step it moves a few hexes along its path and finds a new obstacle ahead.
+    const int STEPS = 50;
+    const int STEP_HEXES = 4;
+    const int OBSTACLE_AHEAD = 12;
+
+    HexCell start = { (int16_t)(-radius / 2), 0 }, goal = { (int16_t)(radius / 2), 0 };
+
+    // Clear out the ends so neither is walled in by a blob.
+    for (HexCell end : { start, goal }) {
+        for (int dq = -4; dq <= 4; dq++) {
+            for (int dr = -4; dr <= 4; dr++) {
+                if (hex_length(dq, dr) <= 4) grid.set(end.q + dq, end.r + dr, 0.0f);
+            }
+        }
+    }
+
+    std::vector<HexCell> astar_path;
+    HexDStar* dstar = create_hex_dstar(&grid, 4.0f, 0.5f);
+    hex_dstar_set_goal(dstar, &grid, goal.q, goal.r);
+
+    Clock::time_point t0 = Clock::now();
+    hex_dstar_plan(dstar, &grid, start.q, start.r, NULL, 0, path);
+    Clock::time_point t1 = Clock::now();
+
+    double dstar_first_ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    double dstar_ms = 0, astar_ms = 0;
+    long dstar_expanded = 0, astar_expanded = 0;
+    double hpa_update_ms = 0;
+    int hpa_rebuilt = 0;
+    int steps = 0;
+
+    std::vector<HexCell> changed;
+
+    for (; steps < STEPS && path.size() > OBSTACLE_AHEAD + 2; steps++) {
+        HexCell ahead = path[OBSTACLE_AHEAD];
+        start = path[STEP_HEXES];
+
+        changed.clear();
+
+        for (int dq = -2; dq <= 2; dq++) {
+            for (int dr = -2; dr <= 2; dr++) {
+                int q = ahead.q + dq, r = ahead.r + dr;
+
+                if (hex_length(dq, dr) > 2 || hex_length(q, r) > radius || (q == goal.q && r == goal.r) || (q == start.q && r == start.r)) continue;
+
+                grid.set(q, r, 1.0f);
+                changed.push_back({ (int16_t)q, (int16_t)r });
+            }
+        }
+
+        hex_hpa_cells_changed(hpa, changed.data(), (int)changed.size());
+
+        Clock::time_point u0 = Clock::now();
+        hpa_rebuilt += update_hex_hpa(hpa, &grid);
+        hpa_update_ms += std::chrono::duration<double, std::milli>(Clock::now() - u0).count();
+
+        t0 = Clock::now();
+        bool dstar_found = hex_dstar_plan(dstar, &grid, start.q, start.r, changed.data(), (int)changed.size(), path);
+        t1 = Clock::now();
+        bool astar_found = plan_hex_path(planner, &grid, start.q, start.r, goal.q, goal.r, astar_path);
+        Clock::time_point t2 = Clock::now();
+
+        dstar_ms += std::chrono::duration<double, std::milli>(t1 - t0).count();
+        astar_ms += std::chrono::duration<double, std::milli>(t2 - t1).count();
+        dstar_expanded += dstar->expanded;
+        astar_expanded += planner->expanded;
+
+        double cost = dstar_found ? check_path(planner, &grid, path, start, goal) : -1;
+
+        if (dstar_found != astar_found || (dstar_found && (cost < 0 || fabs(cost - planner->path_cost) > 1e-3 * cost))) {
+            printf("[!] D* Lite found a cost of %.3f where A* found %.3f!\n", cost, astar_found ? planner->path_cost : -1.0f);
+            ok = false;
+            break;
+        }
+
+        if (!dstar_found) break;
+    }
+
+    if (steps > 0) {
+        printf("> Replanning over %d steps with %zu hexes changing each (D* Lite's first plan took %.3f ms).\n", steps, changed.size(), dstar_first_ms);
+        printf(">   %-8s %12.3f %14ld\n", "A*", astar_ms / steps, astar_expanded / steps);
+        printf(">   %-8s %12.3f %14ld\n", "D* Lite", dstar_ms / steps, dstar_expanded / steps);
+        printf("> HPA* rebuilt %.1f clusters per step in %.3f ms.\n", (double)hpa_rebuilt / steps, hpa_update_ms / steps);
+    }
+
+    destroy_hex_dstar(dstar);
+    destroy_hex_hpa(hpa);
+    destroy_hex_planner(planner);
+
+    return ok;
+}
+
+int run_grid_benchmark(int argc, char** argv) {
+    int radius = 1000;
+
+    if (argc > 2) radius = atoi(argv[2]);
+
+    if (radius <= 0) {
+        printf("usage: mgs_playground --grid-bench [radius (default: 1000)]\n");
+        return 1;
+    }
+
+    const int PASSES = 8;
+
+    printf("> Hex grid of radius %d, %d inflation passes.\n", radius, PASSES);
+
+    struct Run {
+        const char* name;
+        LayoutResult result;
+    };
+
+    Run runs[] = {
+        { "rhombus float", benchmark_layout<float, RhombusLayout>(radius, PASSES) },
+        { "tiled float", benchmark_layout<float, TiledLayout>(radius, PASSES) },
+        { "rhombus u16", benchmark_layout<uint16_t, RhombusLayout>(radius, PASSES) },
+        { "tiled u16", benchmark_layout<uint16_t, TiledLayout>(radius, PASSES) },
+        { "rhombus u8", benchmark_layout<uint8_t, RhombusLayout>(radius, PASSES) },
+        { "tiled u8", benchmark_layout<uint8_t, TiledLayout>(radius, PASSES) },
+    };
+
+    printf(">   %-14s %10s %12s %10s %10s\n", "grid", "MiB", "inflate ms", "copy ms", "flood ms");
+
+    for (const Run& run : runs) {
+        const LayoutResult& result = run.result;
+        printf(">   %-14s %10.1f %12.3f %10.3f %10.3f\n", run.name, result.bytes / (1024.0 * 1024.0), result.inflate_ms, result.copy_ms, result.flood_ms);
+    }
+
+    printf("> The flood fill reached %ld cells.\n", runs[0].result.reached);
+
+    for (const Run& run : runs) {
+        const LayoutResult& result = run.result;
+
+        if (result.inflated_sum != runs[0].result.inflated_sum || result.dist_sum != runs[0].result.dist_sum || result.reached != runs[0].result.reached) {
+            printf("[!] %s doesn't agree with %s!\n", run.name, runs[0].name);
+            return 1;
+        }
+    }
+
+    if (!benchmark_pyramid(radius)) return 1;
+    if (!benchmark_planners(radius)) return 1;
+
+    return 0;
+}
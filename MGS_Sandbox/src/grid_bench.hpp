@@ -0,0 +1,9 @@
+/*
+    Benchmarks for the hex grid: runs the same neighbour-heavy passes over grids stored in different ways, checks they
+    agree, and reports how long each took.
+*/
+
+#pragma once
+
+// mgs_playground --grid-bench [radius]. argv is the full command line. Returns the process exit code.
+int run_grid_benchmark(int argc, char** argv);
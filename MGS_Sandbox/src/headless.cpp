@@ -0,0 +1,804 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "chunked_world.hpp"
+#include "distance_field.hpp"
+#include "headless.hpp"
+#include "hex_lidar.hpp"
+#include "hex_pyramid.hpp"
+#include "level.hpp"
+#include "occupancy.hpp"
+#include "rover.hpp"
+#include "scan_cache.hpp"
+#include "simulation.hpp"
+#include "world.hpp"
+
+// The rover's footprint in headless runs: the circle around a rover as big as the sandbox's (1 m by 1.5 m).
+const float HEADLESS_ROVER_RADIUS = 0.9f;
+
+static void print_usage() {
+    printf("usage: mgs_playground --headless <level.mgslevel | world.mgsworld> [options]\n");
+    printf("  --path <file.mgspath>  Drive along a scripted or recorded path (default: drive in a circle).\n");
+    printf("  --repeat <n>           Run the path n times (default: 1).\n");
+    printf("  --engine <name>        LIDAR engine to use:");
+    for (int i = 0; i < LIDAR_ENGINE_COUNT; i++) printf(" %s", lidar_engine_name((LidarEngine)i));
+    printf(" (default: %s).\n", lidar_engine_name(LIDAR_ENGINE_GRID));
+    printf("  --lidar <model>        sim (271 beams, the default), utm (1081 beams) or <min angle>:<step>:<beams>.\n");
+    printf("  --threads <n>          Split each scan across n threads, 0 for one per core (default: scan on one thread).\n");
+    printf("  --occupancy <update>   How scans go into the occupancy map:");
+    for (int i = 0; i < OCCUPANCY_UPDATE_COUNT; i++) printf(" %s", occupancy_update_name((OccupancyUpdate)i));
+    printf(" (default: %s).\n", occupancy_update_name(OCCUPANCY_UPDATE_CARVE));
+    printf("  --hex <fusion>         Also project every scan into hex grids, fusing with:");
+    for (int i = 0; i < HEX_FUSION_COUNT; i++) printf(" %s", hex_fusion_name((HexFusion)i));
+    printf(".\n");
+    printf("  --sdf <cell size>      Bake the obstacles into a distance field with cells this big in meters (the sdf engine\n");
+    printf("                         does, at %g m by default), and report on its scans, edits and rover clearances.\n", DISTANCE_FIELD_CELL_SIZE);
+    printf("  --cache                Reuse the last scan when the rover stands still (like the sandbox does).\n");
+    printf("  --batch <n>            Instead of driving, scan n poses spread along the path in one batch and one at a time,\n");
+    printf("                         and compare (the batch always uses the simd kernel).\n");
+    printf("  --time-warp <scale>    Run the sandbox's fixed timestep simulation thread instead, scale times faster than\n");
+    printf("                         real time (0 for as fast as it goes), with the path at %d frames a second.\n", SIM_FRAME_HZ);
+}
+
+// Whether two occupancy maps hold the same cells.
+static bool same_occupancy_maps(OccupancyMap* a, OccupancyMap* b) {
+    for (OccupancyTile* tile : a->tiles) {
+        OccupancyTile* other = find_occupancy_tile(b, tile->tx, tile->ty);
+
+        if (!other) {
+            for (int8_t log_odds : tile->log_odds) {
+                if (log_odds != 0) return false;
+            }
+        } else if (memcmp(tile->log_odds, other->log_odds, sizeof(tile->log_odds)) != 0) {
+            return false;
+        }
+    }
+
+    // Tiles only b has have to be unknown too.
+    for (OccupancyTile* tile : b->tiles) {
+        if (find_occupancy_tile(a, tile->tx, tile->ty)) continue;
+
+        for (int8_t log_odds : tile->log_odds) {
+            if (log_odds != 0) return false;
+        }
+    }
+
+    return true;
+}
+
+// Drives the path on the sandbox's simulation thread, reading its states back like the render loop does (keeping a
+// copy of the occupancy map from the changes in them), and reports how much faster than real time it ran.
+static int run_simulation_thread(World* world, ChunkStreamer* streamer, LidarModel* model, LidarEngine engine, int threads, OccupancyUpdate occupancy_update, const std::vector<RoverPose>& poses, int repeat, double time_warp) {
+    std::vector<RoverPose> path;
+    for (int r = 0; r < repeat; r++) path.insert(path.end(), poses.begin(), poses.end());
+
+    WorkerPool* pool = threads >= 0 ? create_worker_pool(threads) : NULL;
+
+    SimConfig config;
+    config.world = world;
+    config.streamer = streamer;
+    config.pool = pool;
+    config.lidar_model = model;
+    config.alternate_lidar_model = NULL;
+    config.engine = engine;
+    config.occupancy_update = occupancy_update;
+    config.occupancy_cell_size = 0.25f;
+    config.hex_size = 1.0f;
+    config.hex_radius = 30;
+    config.start = path[0];
+    config.rover_radius = HEADLESS_ROVER_RADIUS;
+    config.path = &path;
+    config.time_scale = time_warp;
+
+    if (time_warp > 0) {
+        printf("> Running the simulation thread at %gx real time (%.1f s of driving).\n", time_warp, (double)path.size() / SIM_FRAME_HZ);
+    } else {
+        printf("> Running the simulation thread as fast as it goes (%.1f s of driving).\n", (double)path.size() / SIM_FRAME_HZ);
+    }
+
+    OccupancyMap* copy = create_occupancy_map(config.occupancy_cell_size);
+    Grid<float> hex_copy(config.hex_radius);
+
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+
+    Simulation* sim = start_simulation(config);
+
+    if (config.pool) send_sim_command(sim, { SIM_COMMAND_TOGGLE_PARALLEL });
+
+    uint64_t taken_step = 0;
+    long states_taken = 0;
+    double sim_time = 0;
+
+    for (;;) {
+        const SimState* state = take_sim_state(sim);
+
+        if (!state) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        apply_sim_changes(state->changes, taken_step, copy, &hex_copy, NULL);
+
+        taken_step = state->step;
+        sim_time = state->time;
+        states_taken++;
+
+        if (state->finished) break;
+    }
+
+    double wall_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    wait_for_simulation(sim);
+
+    printf("> Simulated %.2f s in %.2f s of real time (%.1fx), %llu physics steps at %d Hz and LIDAR at %d Hz.\n", sim_time, wall_seconds, sim_time / wall_seconds, (unsigned long long)taken_step, SIM_PHYSICS_HZ, SIM_LIDAR_HZ);
+    printf(">   The reader took %ld states.\n", states_taken);
+
+    if (!same_occupancy_maps(simulation_occupancy_map(sim), copy)) {
+        printf("[!] The occupancy map rebuilt from the states doesn't match the simulation's!\n");
+    }
+
+    stop_simulation(sim);
+
+    destroy_occupancy_map(copy);
+    if (pool) destroy_worker_pool(pool);
+
+    return 0;
+}
+
+// Times building the world's distance field and patching an edit into it (checking the patch matches a rebuild), and
+// reports how much room the rover has along the path.
+static void report_distance_field(World* world, const std::vector<RoverPose>& poses) {
+    typedef std::chrono::steady_clock Clock;
+
+    DistanceField* field = world->distance_field;
+
+    Clock::time_point start = Clock::now();
+    DistanceField* rebuilt = create_distance_field(world->obstacles, field->cell_size);
+    double build_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    printf("> Distance field: %d x %d cells of %g m, %.1f MiB, built in %.3f s.\n", field->width, field->height, field->cell_size, field->distance.size() * sizeof(float) / (1024.0 * 1024.0), build_seconds);
+
+    destroy_distance_field(rebuilt);
+
+    // An edit in the middle of the level, like one made in the sandbox, then undoing it. Both should come out exactly
+    // as rebuilding would make them.
+    Obstacle edit = { (field->core_min_x + field->core_max_x) / 2.0f, (field->core_min_y + field->core_max_y) / 2.0f, 1.0f, 1.0f };
+    bool fits = field->core_max_x - field->core_min_x > edit.w && field->core_max_y - field->core_min_y > edit.h;
+
+    if (fits) {
+        std::vector<float> before = field->distance;
+
+        start = Clock::now();
+        add_obstacle(world, edit);
+        update_world(world);
+        double patch_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        rebuilt = create_distance_field(world->obstacles, field->cell_size);
+
+        if (world->distance_field != field || rebuilt->distance != field->distance) {
+            printf("[!] The distance field patched with an obstacle doesn't match a rebuilt one!\n");
+        }
+
+        destroy_distance_field(rebuilt);
+
+        remove_last_obstacle(world);
+        update_world(world);
+
+        if (world->distance_field != field || before != field->distance) {
+            printf("[!] The distance field patched to undo an obstacle doesn't match the original!\n");
+        }
+
+        // Includes rebuilding the obstacle grid and set.
+        printf(">   Adding an obstacle took %.4f s to patch in.\n", patch_seconds);
+    }
+
+    // Rover footprint checks along the path, one lookup each.
+    int blocked = 0;
+    float closest = INFINITY;
+
+    start = Clock::now();
+
+    for (const RoverPose& pose : poses) {
+        float clearance = distance_field_clearance(field, pose.x, pose.y);
+
+        if (clearance < HEADLESS_ROVER_RADIUS) blocked++;
+        if (clearance < closest) closest = clearance;
+    }
+
+    double query_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    printf(">   The rover's footprint (%.1f m around it) may touch an obstacle at %d of %zu poses, least clearance %.2f m, %.1f ns per query.\n", HEADLESS_ROVER_RADIUS, blocked, poses.size(), closest, 1e9 * query_seconds / poses.size());
+
+    // An edit past the edge of the level grows the field rather than rebuilding it. Undoing it should leave the
+    // original distances where they were, and only clear space around them.
+    std::vector<float> before = field->distance;
+    int old_width = field->width, old_height = field->height;
+    float old_min_x = field->min_x, old_min_y = field->min_y;
+
+    Obstacle outside = { field->core_max_x + 2.0f, (field->core_min_y + field->core_max_y) / 2.0f, 1.0f, 1.0f };
+
+    start = Clock::now();
+    add_obstacle(world, outside);
+    update_world(world);
+    double grow_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    bool grown = world->distance_field == field;
+    bool hit = grown && distance_field_clearance(field, outside.x, outside.y) <= 0;
+
+    remove_last_obstacle(world);
+    update_world(world);
+
+    if (!grown || world->distance_field != field) {
+        printf(">   The field would get too big to take in an obstacle past the edge of the level, so that rebuilds it.\n");
+        return;
+    }
+
+    int left = (int)roundf((old_min_x - field->min_x) / field->cell_size);
+    int bottom = (int)roundf((old_min_y - field->min_y) / field->cell_size);
+    bool restored = hit;
+
+    for (int y = 0; y < field->height && restored; y++) {
+        for (int x = 0; x < field->width; x++) {
+            int ox = x - left, oy = y - bottom;
+            bool old_cell = ox >= 0 && oy >= 0 && ox < old_width && oy < old_height;
+
+            float expected = old_cell ? before[(size_t)oy * old_width + ox] : DISTANCE_FIELD_MAX_DISTANCE;
+
+            if (field->distance[(size_t)y * field->width + x] != expected) {
+                restored = false;
+                break;
+            }
+        }
+    }
+
+    if (!restored) printf("[!] The distance field grown to take in an obstacle past its edge doesn't match the original!\n");
+
+    printf(">   Adding an obstacle past the edge of the level took %.4f s to grow the field to %d x %d cells.\n", grow_seconds, field->width, field->height);
+}
+
+// How many of the batch's rows are checked against scan_world with LIDAR_ENGINE_SIMD, which tests every obstacle, when
+// another engine was picked.
+const int HEADLESS_BATCH_CHECKS = 64;
+
+// Scans batch_size poses spread along the path with scan_world_batch, and one scan_world (or scan_world_parallel) at a
+// time with the chosen engine, and reports the poses per second of each. The batch always uses the simd kernel, so its
+// rows are checked against scan_world's with that engine.
+static void run_batch_scans(World* world, LidarModel* model, LidarEngine engine, int threads, const std::vector<RoverPose>& path, int batch_size) {
+    std::vector<RoverPose> poses(batch_size);
+    for (int i = 0; i < batch_size; i++) poses[i] = path[(size_t)i * path.size() / batch_size];
+
+    size_t beam_count = model->beam_count;
+    std::vector<float> one_at_a_time(poses.size() * beam_count);
+    std::vector<float> batch(poses.size() * beam_count);
+
+    WorkerPool* pool = threads >= 0 ? create_worker_pool(threads) : NULL;
+
+    typedef std::chrono::steady_clock Clock;
+
+    Clock::time_point start = Clock::now();
+
+    for (size_t i = 0; i < poses.size(); i++) {
+        if (pool) {
+            scan_world_parallel(world, pool, model, engine, poses[i].x, poses[i].y, poses[i].angle, &one_at_a_time[i * beam_count], 20.0f);
+        } else {
+            scan_world(world, model, engine, poses[i].x, poses[i].y, poses[i].angle, &one_at_a_time[i * beam_count], 20.0f);
+        }
+    }
+
+    double loop_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    start = Clock::now();
+    scan_world_batch(world, pool, model, poses.data(), batch_size, batch.data(), 20.0f);
+    double batch_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    int thread_count = pool ? worker_pool_thread_count(pool) : 1;
+
+    printf("> %d poses on %d thread%s:\n", batch_size, thread_count, thread_count == 1 ? "" : "s");
+    printf(">   One at a time: %.3f s, %.0f poses/s (%s, '%s' engine).\n", loop_seconds, batch_size / loop_seconds, pool ? "scan_world_parallel" : "scan_world", lidar_engine_name(engine));
+    printf(">   Batched:       %.3f s, %.0f poses/s (%.2fx).\n", batch_seconds, batch_size / batch_seconds, loop_seconds / batch_seconds);
+
+    // The loop above already scanned every pose with the simd engine if that's the one picked.
+    bool simd = engine == LIDAR_ENGINE_SIMD;
+    int checks = simd ? batch_size : std::min(batch_size, HEADLESS_BATCH_CHECKS);
+    int mismatched = 0;
+
+    std::vector<float> expected(beam_count);
+
+    for (int k = 0; k < checks; k++) {
+        size_t i = (size_t)k * poses.size() / checks;
+
+        const float* row = &one_at_a_time[i * beam_count];
+
+        if (!simd) {
+            scan_world(world, model, LIDAR_ENGINE_SIMD, poses[i].x, poses[i].y, poses[i].angle, expected.data(), 20.0f);
+            row = expected.data();
+        }
+
+        if (!std::equal(row, row + beam_count, &batch[i * beam_count])) mismatched++;
+    }
+
+    if (mismatched > 0) {
+        printf("[!] %d of %d batched scans don't match the simd engine's!\n", mismatched, checks);
+    }
+
+    if (pool) destroy_worker_pool(pool);
+}
+
+int run_headless(int argc, char** argv) {
+    const char* level_path = NULL;
+    const char* rover_path = NULL;
+    int repeat = 1;
+    LidarEngine engine = LIDAR_ENGINE_GRID;
+    int threads = -1;
+    bool use_cache = false;
+    bool use_hex = false;
+    HexFusion hex_fusion = HEX_FUSION_BLEND;
+    OccupancyUpdate occupancy_update = OCCUPANCY_UPDATE_CARVE;
+    LidarModel* model = NULL;
+
+    // Zero unless --sdf was given.
+    float sdf_cell_size = 0;
+
+    // Zero unless --batch was given.
+    int batch_size = 0;
+
+    // Negative unless --time-warp was given.
+    double time_warp = -1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0) {
+            continue;
+        } else if (strcmp(argv[i], "--path") == 0 && i + 1 < argc) {
+            rover_path = argv[++i];
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+            if (!parse_lidar_engine(argv[++i], &engine)) {
+                printf("[!] Unknown LIDAR engine '%s'.\n", argv[i]);
+                print_usage();
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--lidar") == 0 && i + 1 < argc) {
+            const char* name = argv[++i];
+            float min_angle, angle_step;
+            int beam_count;
+
+            if (model) destroy_lidar_model(model);
+
+            if (strcmp(name, "sim") == 0) {
+                model = create_sim_lidar_model();
+            } else if (strcmp(name, "utm") == 0) {
+                model = create_utm_lidar_model();
+            } else if (sscanf(name, "%f:%f:%d", &min_angle, &angle_step, &beam_count) == 3 && beam_count > 0) {
+                model = create_lidar_model(min_angle, angle_step, beam_count);
+            } else {
+                printf("[!] Unknown LIDAR model '%s'.\n", name);
+                print_usage();
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--occupancy") == 0 && i + 1 < argc) {
+            if (!parse_occupancy_update(argv[++i], &occupancy_update)) {
+                printf("[!] Unknown occupancy update '%s'.\n", argv[i]);
+                print_usage();
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--hex") == 0 && i + 1 < argc) {
+            if (!parse_hex_fusion(argv[++i], &hex_fusion)) {
+                printf("[!] Unknown hex fusion rule '%s'.\n", argv[i]);
+                print_usage();
+                return 1;
+            }
+
+            use_hex = true;
+        } else if (strcmp(argv[i], "--cache") == 0) {
+            use_cache = true;
+        } else if (strcmp(argv[i], "--sdf") == 0 && i + 1 < argc) {
+            sdf_cell_size = (float)atof(argv[++i]);
+
+            if (sdf_cell_size <= 0) {
+                printf("[!] The distance field's cells need a size.\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batch_size = atoi(argv[++i]);
+
+            if (batch_size <= 0) {
+                printf("[!] The batch needs at least one pose.\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--time-warp") == 0 && i + 1 < argc) {
+            time_warp = atof(argv[++i]);
+
+            if (time_warp < 0) {
+                printf("[!] The time warp can't be negative.\n");
+                return 1;
+            }
+        } else if (argv[i][0] != '-' && !level_path) {
+            level_path = argv[i];
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    if (!level_path) {
+        print_usage();
+        return 1;
+    }
+
+    World* world = create_world();
+
+    // Chunked worlds are streamed in around the rover as it drives, instead of being loaded up front.
+    ChunkStreamer* streamer = NULL;
+
+    if (is_chunked_world(level_path)) {
+        printf("> Streaming world %s\n", level_path);
+
+        streamer = open_chunk_streamer(level_path);
+        if (!streamer) return 1;
+    } else {
+        printf("> Loading level %s\n", level_path);
+
+        std::chrono::steady_clock::time_point load_start = std::chrono::steady_clock::now();
+
+        if (!load_level(level_path, world->obstacles)) return 1;
+        mark_world_changed(world);
+
+        double load_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - load_start).count();
+        printf("> Loaded in %.3f s.\n", load_seconds);
+    }
+
+    RoverPose start = { 0, 0, -180.0f };
+    std::vector<RoverPose> poses;
+
+    if (rover_path) {
+        FILE* path_file = fopen(rover_path, "r");
+        if (!path_file) {
+            printf("[!] Couldn't open path %s.\n", rover_path);
+            return 1;
+        }
+
+        bool ok = load_rover_path(path_file, start, poses);
+        fclose(path_file);
+
+        if (!ok) return 1;
+    } else {
+        // A slow circle, turning about as fast as the arrow keys do.
+        RoverPose pose = start;
+        for (int i = 0; i < 1440; i++) {
+            step_rover(&pose, -0.1f, 0.25f);
+            poses.push_back(pose);
+        }
+    }
+
+    if (poses.size() == 0) {
+        printf("[!] The path is empty.\n");
+        return 1;
+    }
+
+    if (!model) model = create_sim_lidar_model();
+
+    if (streamer) {
+        ChunkStreamerStats stats = chunk_streamer_stats(streamer);
+        printf("> %d chunks, %zu poses, %d repeats, '%s' LIDAR engine, %d beams.\n", stats.total_chunks, poses.size(), repeat, lidar_engine_name(engine), model->beam_count);
+    } else {
+        printf("> %zu obstacles, %zu poses, %d repeats, '%s' LIDAR engine, %d beams.\n", world->obstacles.size(), poses.size(), repeat, lidar_engine_name(engine), model->beam_count);
+    }
+
+    if (time_warp >= 0) {
+        int result = run_simulation_thread(world, streamer, model, engine, threads, occupancy_update, poses, repeat, time_warp);
+
+        if (streamer) close_chunk_streamer(streamer);
+
+        destroy_lidar_model(model);
+        destroy_world(world);
+
+        return result;
+    }
+
+    // Same map as the sandbox.
+    const float OCC_MAP_CELL_SIZE = 0.25f;
+    OccupancyMap* occupancy_map = create_occupancy_map(OCC_MAP_CELL_SIZE);
+
+    std::vector<float> lidar_points(model->beam_count);
+
+    // With --hex, scans go into a world frame hex pyramid like the sandbox's, and through a HexBeamTable into a small
+    // grid that follows the rover (cleared before each scan).
+    const float HEX_SIZE = 1.0f;
+    HexPyramid* hex_world_pyramid = NULL;
+    Grid<float> hex_rover_grid;
+    HexBeamTable* hex_table = NULL;
+
+    if (use_hex) {
+        hex_world_pyramid = create_hex_pyramid(200, 4, HEX_AGGREGATE_MAX, 0.5f);
+        hex_rover_grid = Grid<float>((int)ceilf(10.0f / HEX_SIZE) + 1);
+        hex_table = create_hex_beam_table(model, HEX_SIZE, HEX_SIZE / 4.0f, 10.0f);
+    }
+
+    if (streamer) {
+        update_chunk_streamer(streamer, poses[0].x, poses[0].y, 20.0f, true);
+        if (collect_resident_obstacles(streamer, world->obstacles)) mark_world_changed(world);
+    }
+
+    if (engine == LIDAR_ENGINE_SDF && sdf_cell_size == 0) sdf_cell_size = DISTANCE_FIELD_CELL_SIZE;
+    world->distance_field_cell_size = sdf_cell_size;
+
+    // Building the acceleration structures isn't part of a scan.
+    update_world(world);
+
+    if (world->distance_field) {
+        report_distance_field(world, poses);
+    } else if (sdf_cell_size > 0) {
+        printf("> The level needs more than %zu cells for a distance field of %g m cells, so it doesn't get one.\n", DISTANCE_FIELD_MAX_CELLS, sdf_cell_size);
+    }
+
+    // The polar and sdf engines are supposed to give exactly the brute force ranges, so check they do along the path.
+    // Only the obstacles in range of each pose go into the brute force scan, which can't change its ranges but keeps it
+    // quick on big levels.
+    if (engine == LIDAR_ENGINE_POLAR || engine == LIDAR_ENGINE_SDF) {
+        const int CHECK_POSES = 8;
+
+        std::vector<float> dir_x(model->beam_count), dir_y(model->beam_count);
+        std::vector<float> engine_points(model->beam_count);
+        std::vector<Obstacle> nearby;
+        int mismatches = 0;
+
+        for (int i = 0; i < CHECK_POSES; i++) {
+            RoverPose pose = poses[(size_t)i * poses.size() / CHECK_POSES];
+
+            nearby.clear();
+            query_obstacle_grid(world->obstacle_grid, pose.x - 20.0f, pose.y - 20.0f, pose.x + 20.0f, pose.y + 20.0f, nearby);
+
+            rotate_lidar_beams(model, pose.angle, 0, model->beam_count, dir_x.data(), dir_y.data());
+            lidar_scan(pose.x, pose.y, dir_x.data(), dir_y.data(), model->beam_count, nearby, lidar_points.data(), 20.0f);
+
+            scan_world(world, model, engine, pose.x, pose.y, pose.angle, engine_points.data(), 20.0f);
+
+            for (int b = 0; b < model->beam_count; b++) {
+                if (engine_points[b] != lidar_points[b]) mismatches++;
+            }
+        }
+
+        if (mismatches != 0) {
+            printf("[!] %d of %d %s ranges don't match brute force!\n", mismatches, CHECK_POSES * model->beam_count, lidar_engine_name(engine));
+        }
+    }
+
+    if (batch_size > 0) {
+        run_batch_scans(world, model, engine, threads, poses, batch_size);
+
+        if (streamer) close_chunk_streamer(streamer);
+
+        destroy_occupancy_map(occupancy_map);
+        if (use_hex) {
+            destroy_hex_pyramid(hex_world_pyramid);
+            destroy_hex_beam_table(hex_table);
+        }
+        destroy_lidar_model(model);
+        destroy_world(world);
+
+        return 0;
+    }
+
+    WorkerPool* pool = NULL;
+
+    if (threads >= 0) {
+        pool = create_worker_pool(threads);
+
+        // The parallel scan is supposed to be exactly the same as the serial one, so make sure.
+        std::vector<float> serial_points(model->beam_count);
+        scan_world(world, model, engine, poses[0].x, poses[0].y, poses[0].angle, serial_points.data(), 20.0f);
+        scan_world_parallel(world, pool, model, engine, poses[0].x, poses[0].y, poses[0].angle, lidar_points.data(), 20.0f);
+
+        if (serial_points != lidar_points) {
+            printf("[!] The parallel scan doesn't match the serial scan!\n");
+        }
+
+        printf("> Scanning on %d threads.\n", worker_pool_thread_count(pool));
+    }
+
+    ScanCache* cache = NULL;
+
+    if (use_cache) {
+        cache = create_scan_cache();
+
+        // Edit the world in front of the first pose, and make sure rescanning only the beams that can see the edit
+        // gives the same ranges as a full scan.
+        RoverPose pose = poses[0];
+        std::vector<float> full_points(model->beam_count);
+
+        scan_world_cached(world, cache, pool, model, engine, pose.x, pose.y, pose.angle, 20.0f);
+
+        float ahead_x = pose.x + 3.0f * cosf(pose.angle * M_PI / 180.0f);
+        float ahead_y = pose.y + 3.0f * sinf(pose.angle * M_PI / 180.0f);
+
+        add_obstacle(world, { ahead_x, ahead_y, 1.0f, 1.0f });
+
+        for (int step = 0; step < 2; step++) {
+            scan_world_cached(world, cache, pool, model, engine, pose.x, pose.y, pose.angle, 20.0f);
+            scan_world(world, model, engine, pose.x, pose.y, pose.angle, full_points.data(), 20.0f);
+
+            if (cache->ranges != full_points) {
+                printf("[!] The cached scan doesn't match a full scan!\n");
+            }
+
+            if (step == 0) remove_last_obstacle(world);
+        }
+
+        printf("> Rescanned %ld of %d beams after adding and removing an obstacle.\n", cache->rescanned_beams - model->beam_count, 2 * model->beam_count);
+
+        invalidate_scan_cache(cache);
+        update_world(world);
+
+        cache->full_scans = 0;
+        cache->partial_scans = 0;
+        cache->reused_scans = 0;
+        cache->rescanned_beams = 0;
+    }
+
+    typedef std::chrono::steady_clock Clock;
+
+    Clock::duration scan_time(0), occupancy_time(0), streaming_time(0), hex_world_time(0), hex_table_time(0);
+    double range_sum = 0;
+    long scans = 0;
+
+    // Cells inside the tiles' dirty rectangles after each scan: what the sandbox's textures re-upload.
+    long dirty_cells = 0;
+
+    ChunkStreamerStats peak = {};
+
+    for (int r = 0; r < repeat; r++) {
+        for (RoverPose pose : poses) {
+            if (streamer) {
+                Clock::time_point start = Clock::now();
+
+                // Waiting keeps the results independent of disk speed. Rebuilding the world's acceleration
+                // structures for the new chunks counts as streaming, not scanning.
+                update_chunk_streamer(streamer, pose.x, pose.y, 20.0f, true);
+
+                if (collect_resident_obstacles(streamer, world->obstacles)) {
+                    mark_world_changed(world);
+                    update_world(world);
+                }
+
+                streaming_time += Clock::now() - start;
+
+                ChunkStreamerStats stats = chunk_streamer_stats(streamer);
+                if (stats.resident_chunks > peak.resident_chunks) peak.resident_chunks = stats.resident_chunks;
+                if (stats.resident_obstacles > peak.resident_obstacles) peak.resident_obstacles = stats.resident_obstacles;
+            }
+
+            Clock::time_point t0 = Clock::now();
+
+            bool scan_changed = true;
+
+            if (cache) {
+                scan_changed = scan_world_cached(world, cache, pool, model, engine, pose.x, pose.y, pose.angle, 20.0f);
+                lidar_points = cache->ranges;
+            } else if (pool) {
+                scan_world_parallel(world, pool, model, engine, pose.x, pose.y, pose.angle, lidar_points.data(), 20.0f);
+            } else {
+                scan_world(world, model, engine, pose.x, pose.y, pose.angle, lidar_points.data(), 20.0f);
+            }
+
+            Clock::time_point t1 = Clock::now();
+
+            if (scan_changed) update_occupancy_map(occupancy_map, model, occupancy_update, pose.x, pose.y, pose.angle, lidar_points.data(), 10.0f);
+
+            Clock::time_point t2 = Clock::now();
+
+            scan_time += t1 - t0;
+            occupancy_time += t2 - t1;
+            scans++;
+
+            for (OccupancyTile* tile : occupancy_map->tiles) {
+                if (tile->dirty_x0 > tile->dirty_x1) continue;
+
+                dirty_cells += (long)(tile->dirty_x1 - tile->dirty_x0 + 1) * (tile->dirty_y1 - tile->dirty_y0 + 1);
+                reset_occupancy_tile_dirty(tile);
+            }
+
+            if (use_hex && scan_changed) {
+                Clock::time_point h0 = Clock::now();
+
+                project_lidar_to_grid(hex_world_pyramid, model, HEX_SIZE, pose.x, pose.y, pose.angle, lidar_points.data(), 10.0f, hex_fusion, 0.25f, NULL);
+
+                Clock::time_point h1 = Clock::now();
+
+                hex_rover_grid.fill(0.0f);
+                project_lidar_to_grid(&hex_rover_grid, hex_table, lidar_points.data(), 10.0f, hex_fusion, 0.25f);
+
+                Clock::time_point h2 = Clock::now();
+
+                hex_world_time += h1 - h0;
+                hex_table_time += h2 - h1;
+            }
+
+            for (float range : lidar_points) range_sum += range;
+        }
+    }
+
+    double scan_seconds = std::chrono::duration<double>(scan_time).count();
+    double occupancy_seconds = std::chrono::duration<double>(occupancy_time).count();
+    double total_seconds = scan_seconds + occupancy_seconds;
+
+    printf("> %ld scans in %.3f s: %.1f scans per second.\n", scans, total_seconds, scans / total_seconds);
+    printf(">   LIDAR scan:     %.4f ms per scan.\n", 1000.0 * scan_seconds / scans);
+    printf(">   Occupancy map:  %.4f ms per scan.\n", 1000.0 * occupancy_seconds / scans);
+    printf(">   Mean range:     %.6f m.\n", range_sum / ((double)model->beam_count * scans));
+
+    if (use_hex) {
+        int hit_hexes = 0;
+
+        const Grid<float>& base = hex_world_pyramid->levels[0];
+
+        for (size_t i = 0; i < base.word_count; i++) {
+            if (base.cells[i] > 0) hit_hexes++;
+        }
+
+        // How much of the map a planner could rule out at the coarsest level.
+        const Grid<float>& top = hex_world_pyramid->levels.back();
+        int top_side = 1 << (hex_world_pyramid->levels.size() - 1);
+        int free_regions = 0, total_regions = 0;
+
+        for (int q = -top.layout.offset; q <= top.layout.offset; q++) {
+            for (int r = -top.layout.offset; r <= top.layout.offset; r++) {
+                total_regions++;
+                if (hex_pyramid_region(hex_world_pyramid, (int)hex_world_pyramid->levels.size() - 1, q, r) == HEX_REGION_FREE) free_regions++;
+            }
+        }
+
+        printf("> Hex grids ('%s' fusion): %d hexes hit.\n", hex_fusion_name(hex_fusion), hit_hexes);
+        printf(">   World frame:    %.4f ms per scan.\n", 1000.0 * std::chrono::duration<double>(hex_world_time).count() / scans);
+        printf(">   Rover frame:    %.4f ms per scan (table lookup).\n", 1000.0 * std::chrono::duration<double>(hex_table_time).count() / scans);
+        printf(">   %d of %d regions of %dx%d hexes are free.\n", free_regions, total_regions, top_side, top_side);
+
+        destroy_hex_beam_table(hex_table);
+        destroy_hex_pyramid(hex_world_pyramid);
+    }
+
+    long occupied_cells = 0, free_cells = 0;
+
+    for (OccupancyTile* tile : occupancy_map->tiles) {
+        for (int8_t log_odds : tile->log_odds) {
+            if (log_odds > 0) occupied_cells++;
+            if (log_odds < 0) free_cells++;
+        }
+    }
+
+    printf("> %ld occupied and %ld free cells in the occupancy map ('%s' update).\n", occupied_cells, free_cells, occupancy_update_name(occupancy_update));
+    printf(">   %zu tiles, %.1f MiB.\n", occupancy_map->tiles.size(), occupancy_map_memory(occupancy_map) / (1024.0 * 1024.0));
+    printf(">   %.0f of %zu cells changed per scan, by dirty rectangle.\n", (double)dirty_cells / scans, occupancy_map->tiles.size() * OCCUPANCY_TILE_SIZE * OCCUPANCY_TILE_SIZE);
+
+    destroy_occupancy_map(occupancy_map);
+
+    if (cache) {
+        printf("> Scan cache: %ld full scans, %ld partial scans, %ld reused.\n", cache->full_scans, cache->partial_scans, cache->reused_scans);
+
+        destroy_scan_cache(cache);
+    }
+
+    if (streamer) {
+        printf("> Streaming took %.4f ms per scan. At most %d chunks (%ld obstacles) were resident.\n", 1000.0 * std::chrono::duration<double>(streaming_time).count() / scans, peak.resident_chunks, peak.resident_obstacles);
+
+        close_chunk_streamer(streamer);
+    }
+
+    if (pool) destroy_worker_pool(pool);
+
+    destroy_lidar_model(model);
+
+    destroy_world(world);
+
+    return 0;
+}
@@ -0,0 +1,11 @@
+/*
+    Runs the simulation without a window: loads a level, drives the rover along a path and runs the LIDAR and
+    occupancy grid updates as fast as possible, then reports how fast that went.
+
+    Doesn't touch SDL or OpenGL, so it also builds on its own (see the mgs_headless target in the Makefile).
+*/
+
+#pragma once
+
+// argv is the full command line; a leading --headless flag is skipped.
+int run_headless(int argc, char** argv);
@@ -0,0 +1,206 @@
+#include <math.h>
+
+#include "hex_dstar.hpp"
+
+HexDStar* create_hex_dstar(const Grid<float>* grid, float cost_weight, float blocked_threshold) {
+    HexDStar* dstar = new HexDStar;
+
+    dstar->offset = grid->layout.offset;
+    dstar->size = grid->layout.size;
+
+    dstar->cost_weight = cost_weight;
+    dstar->blocked_threshold = blocked_threshold;
+
+    size_t cells = grid->layout.cell_count();
+
+    dstar->g.assign(cells, INFINITY);
+    dstar->rhs.assign(cells, INFINITY);
+
+    dstar->open.init(cells);
+
+    dstar->has_goal = false;
+    dstar->started = false;
+    dstar->goal = 0;
+    dstar->start = 0;
+    dstar->km = 0;
+
+    dstar->expanded = 0;
+    dstar->path_cost = 0;
+
+    return dstar;
+}
+
+void destroy_hex_dstar(HexDStar* dstar) {
+    delete dstar;
+}
+
+static HexCell cell_at(const HexDStar* dstar, uint32_t index) {
+    return { (int16_t)(index / dstar->size - dstar->offset), (int16_t)(index % dstar->size - dstar->offset) };
+}
+
+// Cost of stepping into the hex at index.
+static float step_cost(const HexDStar* dstar, const Grid<float>* grid, size_t index) {
+    float value = grid->cells[index];
+    return value > dstar->blocked_threshold ? INFINITY : 1.0f + dstar->cost_weight * value;
+}
+
+static float heuristic(const HexDStar* dstar, uint32_t a, uint32_t b) {
+    HexCell ca = cell_at(dstar, a), cb = cell_at(dstar, b);
+    return (float)hex_length(ca.q - cb.q, ca.r - cb.r);
+}
+
+static HexDStarKey calculate_key(const HexDStar* dstar, uint32_t index) {
+    float best = fminf(dstar->g[index], dstar->rhs[index]);
+    return { best + heuristic(dstar, dstar->start, index) + dstar->km, best };
+}
+
+static void update_vertex(HexDStar* dstar, const Grid<float>* grid, uint32_t index) {
+    if (index != dstar->goal) {
+        HexCell cell = cell_at(dstar, index);
+
+        size_t neighbours[6];
+        int count = grid_neighbours(grid, cell.q, cell.r, neighbours);
+
+        float best = INFINITY;
+
+        for (int i = 0; i < count; i++) {
+            best = fminf(best, step_cost(dstar, grid, neighbours[i]) + dstar->g[neighbours[i]]);
+        }
+
+        dstar->rhs[index] = best;
+    }
+
+    if (dstar->g[index] != dstar->rhs[index]) {
+        dstar->open.push(index, calculate_key(dstar, index));
+    } else {
+        dstar->open.remove(index);
+    }
+}
+
+static void update_neighbours(HexDStar* dstar, const Grid<float>* grid, uint32_t index) {
+    HexCell cell = cell_at(dstar, index);
+
+    size_t neighbours[6];
+    int count = grid_neighbours(grid, cell.q, cell.r, neighbours);
+
+    for (int i = 0; i < count; i++) {
+        update_vertex(dstar, grid, (uint32_t)neighbours[i]);
+    }
+}
+
+static void compute_shortest_path(HexDStar* dstar, const Grid<float>* grid) {
+    uint32_t start = dstar->start;
+
+    while (!dstar->open.empty() && (dstar->open.top().key < calculate_key(dstar, start) || dstar->rhs[start] != dstar->g[start])) {
+        uint32_t index = dstar->open.top().item;
+        HexDStarKey old_key = dstar->open.top().key;
+        HexDStarKey new_key = calculate_key(dstar, index);
+
+        dstar->expanded++;
+
+        if (old_key < new_key) {
+            // Queued before the rover moved; its place in the queue is out of date.
+            dstar->open.push(index, new_key);
+        } else if (dstar->g[index] > dstar->rhs[index]) {
+            dstar->g[index] = dstar->rhs[index];
+            dstar->open.pop();
+
+            update_neighbours(dstar, grid, index);
+        } else {
+            dstar->g[index] = INFINITY;
+
+            update_vertex(dstar, grid, index);
+            update_neighbours(dstar, grid, index);
+        }
+    }
+}
+
+bool hex_dstar_set_goal(HexDStar* dstar, const Grid<float>* grid, int goal_q, int goal_r) {
+    if (hex_length(goal_q, goal_r) > dstar->offset) return false;
+
+    dstar->open.clear();
+
+    for (size_t i = 0; i < dstar->g.size(); i++) {
+        dstar->g[i] = INFINITY;
+        dstar->rhs[i] = INFINITY;
+    }
+
+    dstar->has_goal = true;
+    dstar->started = false;
+    dstar->goal = (uint32_t)grid->layout.index(goal_q, goal_r);
+    dstar->km = 0;
+
+    dstar->rhs[dstar->goal] = 0;
+
+    return true;
+}
+
+bool hex_dstar_plan(HexDStar* dstar, const Grid<float>* grid, int start_q, int start_r, const HexCell* changed, int changed_count, std::vector<HexCell>& path) {
+    path.clear();
+
+    dstar->expanded = 0;
+    dstar->path_cost = 0;
+
+    if (!dstar->has_goal || hex_length(start_q, start_r) > dstar->offset) return false;
+
+    uint32_t start = (uint32_t)grid->layout.index(start_q, start_r);
+
+    if (dstar->started) {
+        dstar->km += heuristic(dstar, dstar->start, start);
+        dstar->start = start;
+    } else {
+        // The goal's key depends on where the search starts from, so it can only be queued now.
+        dstar->start = start;
+        dstar->started = true;
+
+        dstar->open.push(dstar->goal, calculate_key(dstar, dstar->goal));
+    }
+
+    // A changed hex costs something different to step into, so everything next to it may have a different lookahead.
+    for (int i = 0; i < changed_count; i++) {
+        if (hex_length(changed[i].q, changed[i].r) > dstar->offset) continue;
+
+        update_neighbours(dstar, grid, (uint32_t)grid->layout.index(changed[i].q, changed[i].r));
+    }
+
+    compute_shortest_path(dstar, grid);
+
+    if (dstar->g[start] == INFINITY) return false;
+
+    dstar->path_cost = dstar->g[start];
+
+    // Walk downhill. The length check only guards against costs that haven't settled.
+    uint32_t index = start;
+    path.push_back(cell_at(dstar, index));
+
+    while (index != dstar->goal && path.size() <= dstar->g.size()) {
+        HexCell cell = cell_at(dstar, index);
+
+        size_t neighbours[6];
+        int count = grid_neighbours(grid, cell.q, cell.r, neighbours);
+
+        float best = INFINITY;
+        uint32_t next = index;
+
+        for (int i = 0; i < count; i++) {
+            float cost = step_cost(dstar, grid, neighbours[i]) + dstar->g[neighbours[i]];
+
+            if (cost < best) {
+                best = cost;
+                next = (uint32_t)neighbours[i];
+            }
+        }
+
+        if (next == index) break;
+
+        index = next;
+        path.push_back(cell_at(dstar, index));
+    }
+
+    if (index != dstar->goal) {
+        path.clear();
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,69 @@
+/*
+    Incremental path planning over the hex Grid with D* Lite.
+
+    The search runs backwards from the goal, so g of a hex is the cost of its cheapest path to the goal, and it keeps
+    those costs between queries. When hexes change (a LIDAR update marks some as hit) only the costs that depended on
+    them are repaired, and when the rover moves the old costs stay valid with the key offset km making up for the
+    heuristic now being measured from somewhere else. A repair touches a number of hexes that follows the size of the
+    change rather than the size of the map.
+
+    Costs are the same as HexPlanner's: stepping into a hex costs 1 plus cost_weight times its value, and hexes above
+    blocked_threshold can't be entered.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "grid.hpp"
+#include "indexed_heap.hpp"
+
+struct HexDStarKey {
+    float k1, k2;
+
+    bool operator<(const HexDStarKey& other) const {
+        return k1 < other.k1 || (k1 == other.k1 && k2 < other.k2);
+    }
+};
+
+struct HexDStar {
+    int offset;
+    int size;
+
+    float cost_weight;
+    float blocked_threshold;
+
+    // Per cell, indexed like the grid: the cost to the goal as of the last expansion, and the one-step lookahead.
+    std::vector<float> g;
+    std::vector<float> rhs;
+
+    IndexedHeap<HexDStarKey> open;
+
+    bool has_goal;
+    uint32_t goal;
+
+    // Whether there has been a hex_dstar_plan since the goal was set.
+    bool started;
+
+    // Where the rover was at the last repair, and the sum of how far it has moved since the goal was set.
+    uint32_t start;
+    float km;
+
+    // About the last call to hex_dstar_plan.
+    long expanded;
+    float path_cost;
+};
+
+HexDStar* create_hex_dstar(const Grid<float>* grid, float cost_weight, float blocked_threshold);
+
+void destroy_hex_dstar(HexDStar* dstar);
+
+// Forgets everything and plans towards a new goal from the next hex_dstar_plan. Returns false if the goal is off the grid.
+bool hex_dstar_set_goal(HexDStar* dstar, const Grid<float>* grid, int goal_q, int goal_r);
+
+// Repairs the plan for the hexes whose value changed since the last call (repeats are fine) and a rover now on the start
+// hex, and replaces path with the hexes from the start to the goal. Returns false, leaving path empty, if there's no
+// goal, the start is off the grid, or the goal can't be reached.
+bool hex_dstar_plan(HexDStar* dstar, const Grid<float>* grid, int start_q, int start_r, const HexCell* changed, int changed_count, std::vector<HexCell>& path);
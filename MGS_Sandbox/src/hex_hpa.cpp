@@ -0,0 +1,394 @@
+#include <math.h>
+
+#include <algorithm>
+
+#include "hex_hpa.hpp"
+
+// Runs of open hexes along an edge at least this long get an entrance at each end rather than one in the middle.
+const int HPA_LONG_ENTRANCE = 6;
+
+static HexCell cell_at(const HexHpa* hpa, uint32_t index) {
+    return { (int16_t)(index / hpa->size - hpa->offset), (int16_t)(index % hpa->size - hpa->offset) };
+}
+
+static int cluster_of(const HexHpa* hpa, uint32_t index) {
+    int u = (int)(index / hpa->size), v = (int)(index % hpa->size);
+    return (u / hpa->cluster_size) * hpa->clusters_per_side + v / hpa->cluster_size;
+}
+
+// Whether the hex at storage position (u, v) can be entered.
+static bool open_at(const HexHpa* hpa, const Grid<float>* grid, int u, int v) {
+    if (u < 0 || v < 0 || u >= hpa->size || v >= hpa->size) return false;
+    if (hex_length(u - hpa->offset, v - hpa->offset) > hpa->offset) return false;
+
+    return hex_step_cost(hpa->planner, grid->cells[(size_t)u * hpa->size + v]) >= 0;
+}
+
+// Dijkstra from one hex to every hex of the cluster it's in, without leaving it. Forwards, local_cost ends up as the
+// cost from the source to each hex; backwards, as the cost from each hex to the source. local_cost is indexed by
+// (u - u0) * cluster_size + (v - v0).
+static void search_cluster(HexHpa* hpa, const Grid<float>* grid, int cluster, uint32_t source, bool backwards) {
+    int n = hpa->cluster_size;
+    int u0 = (cluster / hpa->clusters_per_side) * n, v0 = (cluster % hpa->clusters_per_side) * n;
+
+    std::fill(hpa->local_cost.begin(), hpa->local_cost.end(), INFINITY);
+
+    int su = (int)(source / hpa->size), sv = (int)(source % hpa->size);
+    hpa->local_cost[(su - u0) * n + (sv - v0)] = 0;
+    hpa->local_open.push((uint32_t)((su - u0) * n + (sv - v0)), 0.0f);
+
+    while (!hpa->local_open.empty()) {
+        uint32_t local = hpa->local_open.pop();
+        int u = u0 + (int)local / n, v = v0 + (int)local % n;
+        float cost = hpa->local_cost[local];
+
+        // Backwards, reaching this hex from a neighbour means paying to step into this one.
+        float here = backwards ? hex_step_cost(hpa->planner, grid->cells[(size_t)u * hpa->size + v]) : 0;
+        if (here < 0) continue;
+
+        for (int i = 0; i < 6; i++) {
+            int nu = u + HEX_NEIGHBOUR_DQ[i], nv = v + HEX_NEIGHBOUR_DR[i];
+
+            if (nu < u0 || nv < v0 || nu >= u0 + n || nv >= v0 + n || !open_at(hpa, grid, nu, nv)) continue;
+
+            float step = backwards ? here : hex_step_cost(hpa->planner, grid->cells[(size_t)nu * hpa->size + nv]);
+            uint32_t next = (uint32_t)((nu - u0) * n + (nv - v0));
+
+            if (cost + step < hpa->local_cost[next]) {
+                hpa->local_cost[next] = cost + step;
+                hpa->local_open.push(next, cost + step);
+            }
+        }
+    }
+}
+
+static float local_cost_of(const HexHpa* hpa, int cluster, uint32_t index) {
+    int n = hpa->cluster_size;
+    int u = (int)(index / hpa->size) - (cluster / hpa->clusters_per_side) * n;
+    int v = (int)(index % hpa->size) - (cluster % hpa->clusters_per_side) * n;
+
+    return hpa->local_cost[u * n + v];
+}
+
+// Appends the entrances on one edge of a cluster as (hex inside, hex across) pairs. The edge runs over count hexes
+// from (u, v) in steps of (du, dv), and the hex across from each is (across_du, across_dv) away.
+static void find_entrances(const HexHpa* hpa, const Grid<float>* grid, int u, int v, int du, int dv, int count, int across_du, int across_dv, std::vector<uint32_t>& pairs) {
+    int run_start = -1;
+
+    for (int i = 0; i <= count; i++) {
+        int iu = u + du * i, iv = v + dv * i;
+        bool open = i < count && open_at(hpa, grid, iu, iv) && open_at(hpa, grid, iu + across_du, iv + across_dv);
+
+        if (open && run_start < 0) run_start = i;
+        if (open || run_start < 0) continue;
+
+        int length = i - run_start;
+        int picks[2] = { run_start + length / 2, -1 };
+
+        if (length >= HPA_LONG_ENTRANCE) {
+            picks[0] = run_start;
+            picks[1] = i - 1;
+        }
+
+        for (int pick : picks) {
+            if (pick < 0) continue;
+
+            int pu = u + du * pick, pv = v + dv * pick;
+
+            pairs.push_back((uint32_t)((size_t)pu * hpa->size + pv));
+            pairs.push_back((uint32_t)((size_t)(pu + across_du) * hpa->size + pv + across_dv));
+        }
+
+        run_start = -1;
+    }
+}
+
+static void build_cluster(HexHpa* hpa, const Grid<float>* grid, int index) {
+    HexHpaCluster& cluster = hpa->clusters[index];
+    int n = hpa->cluster_size;
+    int u0 = (index / hpa->clusters_per_side) * n, v0 = (index % hpa->clusters_per_side) * n;
+
+    // Both clusters on an edge find the same entrances, so each side's nodes match up with the other's links.
+    std::vector<uint32_t> pairs;
+    find_entrances(hpa, grid, u0, v0, 0, 1, n, -1, 0, pairs);
+    find_entrances(hpa, grid, u0 + n - 1, v0, 0, 1, n, 1, 0, pairs);
+    find_entrances(hpa, grid, u0, v0, 1, 0, n, 0, -1, pairs);
+    find_entrances(hpa, grid, u0, v0 + n - 1, 1, 0, n, 0, 1, pairs);
+
+    cluster.nodes.clear();
+
+    for (size_t i = 0; i < pairs.size(); i += 2) {
+        if (std::find(cluster.nodes.begin(), cluster.nodes.end(), pairs[i]) == cluster.nodes.end()) cluster.nodes.push_back(pairs[i]);
+    }
+
+    size_t count = cluster.nodes.size();
+
+    cluster.link_start.assign(count + 1, 0);
+    cluster.links.clear();
+
+    for (size_t i = 0; i < count; i++) {
+        cluster.link_start[i] = (uint32_t)cluster.links.size();
+
+        for (size_t j = 0; j < pairs.size(); j += 2) {
+            if (pairs[j] == cluster.nodes[i]) cluster.links.push_back(pairs[j + 1]);
+        }
+    }
+
+    cluster.link_start[count] = (uint32_t)cluster.links.size();
+
+    cluster.costs.resize(count * count);
+
+    for (size_t i = 0; i < count; i++) {
+        search_cluster(hpa, grid, index, cluster.nodes[i], false);
+
+        for (size_t j = 0; j < count; j++) {
+            cluster.costs[i * count + j] = local_cost_of(hpa, index, cluster.nodes[j]);
+        }
+    }
+
+    cluster.dirty = false;
+}
+
+HexHpa* create_hex_hpa(const Grid<float>* grid, int cluster_size, float cost_weight, float blocked_threshold) {
+    HexHpa* hpa = new HexHpa;
+
+    hpa->offset = grid->layout.offset;
+    hpa->size = grid->layout.size;
+
+    hpa->cluster_size = cluster_size;
+    hpa->clusters_per_side = (grid->layout.size + cluster_size - 1) / cluster_size;
+
+    hpa->clusters.resize((size_t)hpa->clusters_per_side * hpa->clusters_per_side);
+
+    hpa->planner = create_hex_planner(grid, cost_weight, blocked_threshold);
+
+    hpa->local_cost.resize(cluster_size * cluster_size);
+    hpa->local_open.init(cluster_size * cluster_size);
+
+    hpa->abstract_expanded = 0;
+    hpa->refine_expanded = 0;
+    hpa->path_cost = 0;
+
+    for (size_t i = 0; i < hpa->clusters.size(); i++) {
+        build_cluster(hpa, grid, (int)i);
+    }
+
+    return hpa;
+}
+
+void destroy_hex_hpa(HexHpa* hpa) {
+    destroy_hex_planner(hpa->planner);
+
+    delete hpa;
+}
+
+static void mark_dirty(HexHpa* hpa, int cu, int cv) {
+    if (cu < 0 || cv < 0 || cu >= hpa->clusters_per_side || cv >= hpa->clusters_per_side) return;
+
+    int index = cu * hpa->clusters_per_side + cv;
+
+    if (!hpa->clusters[index].dirty) {
+        hpa->clusters[index].dirty = true;
+        hpa->dirty_clusters.push_back(index);
+    }
+}
+
+void hex_hpa_cells_changed(HexHpa* hpa, const HexCell* changed, int changed_count) {
+    int n = hpa->cluster_size;
+
+    for (int i = 0; i < changed_count; i++) {
+        int u = changed[i].q + hpa->offset, v = changed[i].r + hpa->offset;
+        if (u < 0 || v < 0 || u >= hpa->size || v >= hpa->size) continue;
+
+        int cu = u / n, cv = v / n;
+        mark_dirty(hpa, cu, cv);
+
+        // A hex on an edge is part of the neighbour's entrances too.
+        if (u % n == 0) mark_dirty(hpa, cu - 1, cv);
+        if (u % n == n - 1) mark_dirty(hpa, cu + 1, cv);
+        if (v % n == 0) mark_dirty(hpa, cu, cv - 1);
+        if (v % n == n - 1) mark_dirty(hpa, cu, cv + 1);
+    }
+}
+
+int update_hex_hpa(HexHpa* hpa, const Grid<float>* grid) {
+    int count = (int)hpa->dirty_clusters.size();
+
+    for (int index : hpa->dirty_clusters) {
+        build_cluster(hpa, grid, index);
+    }
+
+    hpa->dirty_clusters.clear();
+
+    return count;
+}
+
+// Index of a node in its cluster's list, or -1.
+static int node_slot(const HexHpaCluster& cluster, uint32_t index) {
+    for (size_t i = 0; i < cluster.nodes.size(); i++) {
+        if (cluster.nodes[i] == index) return (int)i;
+    }
+
+    return -1;
+}
+
+// Searches the abstract graph from start to goal and fills abstract_path with the hexes along the way (start, nodes,
+// goal). start_cost and goal_cost hold the costs from start to the nodes of its cluster and from the nodes of the
+// goal's cluster to goal.
+static bool search_abstract(HexHpa* hpa, const Grid<float>* grid, uint32_t start, uint32_t goal) {
+    HexPlanner* planner = hpa->planner;
+    uint32_t search = begin_hex_search(planner);
+
+    int start_cluster = cluster_of(hpa, start), goal_cluster = cluster_of(hpa, goal);
+    HexCell goal_cell = cell_at(hpa, goal);
+
+    auto relax = [&](uint32_t index, uint32_t from, float cost) {
+        bool seen = planner->search_id[index] == search;
+        if (seen && (!planner->open.contains(index) || cost >= planner->cost[index])) return;
+
+        planner->search_id[index] = search;
+        planner->cost[index] = cost;
+        planner->parent[index] = from;
+
+        HexCell cell = cell_at(hpa, index);
+        planner->open.push(index, { cost + hex_length(goal_cell.q - cell.q, goal_cell.r - cell.r), cost });
+    };
+
+    const HexHpaCluster& first = hpa->clusters[start_cluster];
+
+    // If the start is an entrance itself, it's queued like the other nodes (at no cost) so its links get followed.
+    if (node_slot(first, start) < 0) {
+        planner->search_id[start] = search;
+        planner->cost[start] = 0;
+        planner->parent[start] = start;
+    }
+
+    for (size_t i = 0; i < first.nodes.size(); i++) {
+        if (hpa->start_cost[i] != INFINITY) relax(first.nodes[i], start, hpa->start_cost[i]);
+    }
+
+    bool found = false;
+
+    while (!planner->open.empty()) {
+        uint32_t index = planner->open.pop();
+        hpa->abstract_expanded++;
+
+        if (index == goal) {
+            found = true;
+            break;
+        }
+
+        float cost = planner->cost[index];
+        int cluster_index = cluster_of(hpa, index);
+        const HexHpaCluster& cluster = hpa->clusters[cluster_index];
+        int slot = node_slot(cluster, index);
+
+        if (slot < 0) continue;
+
+        size_t count = cluster.nodes.size();
+
+        for (size_t j = 0; j < count; j++) {
+            float step = cluster.costs[slot * count + j];
+            if (step != INFINITY && (int)j != slot) relax(cluster.nodes[j], index, cost + step);
+        }
+
+        // Hexes across an entrance are always open.
+        for (uint32_t k = cluster.link_start[slot]; k < cluster.link_start[slot + 1]; k++) {
+            uint32_t across = cluster.links[k];
+            relax(across, index, cost + hex_step_cost(planner, grid->cells[across]));
+        }
+
+        if (cluster_index == goal_cluster && hpa->goal_cost[slot] != INFINITY) relax(goal, index, cost + hpa->goal_cost[slot]);
+    }
+
+    planner->open.clear();
+
+    hpa->abstract_path.clear();
+    if (!found) return false;
+
+    for (uint32_t index = goal; ; index = planner->parent[index]) {
+        hpa->abstract_path.push_back(index);
+        if (index == start) break;
+    }
+
+    std::reverse(hpa->abstract_path.begin(), hpa->abstract_path.end());
+
+    return true;
+}
+
+bool plan_hex_hpa_path(HexHpa* hpa, const Grid<float>* grid, int start_q, int start_r, int goal_q, int goal_r, std::vector<HexCell>& path) {
+    path.clear();
+
+    hpa->abstract_expanded = 0;
+    hpa->refine_expanded = 0;
+    hpa->path_cost = 0;
+
+    update_hex_hpa(hpa, grid);
+
+    HexPlanner* planner = hpa->planner;
+
+    if (hex_length(start_q, start_r) > hpa->offset || hex_length(goal_q, goal_r) > hpa->offset) return false;
+
+    uint32_t start = (uint32_t)grid->layout.index(start_q, start_r);
+    uint32_t goal = (uint32_t)grid->layout.index(goal_q, goal_r);
+
+    int start_cluster = cluster_of(hpa, start), goal_cluster = cluster_of(hpa, goal);
+
+    // Close enough that a plain search is about as cheap, and the abstract graph would only make the path worse.
+    if (start_cluster == goal_cluster || hex_length(goal_q - start_q, goal_r - start_r) <= 2 * hpa->cluster_size) {
+        bool found = plan_hex_path(planner, grid, start_q, start_r, goal_q, goal_r, path);
+
+        hpa->refine_expanded = planner->expanded;
+        hpa->path_cost = planner->path_cost;
+
+        return found;
+    }
+
+    if (hex_step_cost(planner, grid->cells[goal]) < 0) return false;
+
+    // Connect the ends to the nodes of their clusters.
+    const HexHpaCluster& first = hpa->clusters[start_cluster];
+    const HexHpaCluster& last = hpa->clusters[goal_cluster];
+
+    search_cluster(hpa, grid, start_cluster, start, false);
+    hpa->start_cost.resize(first.nodes.size());
+
+    for (size_t i = 0; i < first.nodes.size(); i++) {
+        hpa->start_cost[i] = local_cost_of(hpa, start_cluster, first.nodes[i]);
+    }
+
+    search_cluster(hpa, grid, goal_cluster, goal, true);
+    hpa->goal_cost.resize(last.nodes.size());
+
+    for (size_t i = 0; i < last.nodes.size(); i++) {
+        hpa->goal_cost[i] = local_cost_of(hpa, goal_cluster, last.nodes[i]);
+    }
+
+    if (!search_abstract(hpa, grid, start, goal)) return false;
+
+    // Refine each leg. Legs across an entrance are a single step; the others stay within a cluster.
+    path.push_back(cell_at(hpa, start));
+
+    for (size_t i = 1; i < hpa->abstract_path.size(); i++) {
+        HexCell from = cell_at(hpa, hpa->abstract_path[i - 1]);
+        HexCell to = cell_at(hpa, hpa->abstract_path[i]);
+
+        if (hex_length(to.q - from.q, to.r - from.r) == 1) {
+            path.push_back(to);
+            hpa->path_cost += hex_step_cost(planner, grid->cells[hpa->abstract_path[i]]);
+            continue;
+        }
+
+        if (!plan_hex_path(planner, grid, from.q, from.r, to.q, to.r, hpa->leg)) {
+            path.clear();
+            return false;
+        }
+
+        hpa->refine_expanded += planner->expanded;
+        hpa->path_cost += planner->path_cost;
+
+        path.insert(path.end(), hpa->leg.begin() + 1, hpa->leg.end());
+    }
+
+    return true;
+}
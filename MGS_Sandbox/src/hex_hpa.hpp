@@ -0,0 +1,84 @@
+/*
+    Hierarchical path planning (HPA*) over the hex Grid, for routes too long to search hex by hex.
+
+    The grid is cut into clusters of cluster_size x cluster_size hexes (in axial coordinates, so rhombi). Where two
+    clusters side by side both have open hexes along their shared edge, each run of them becomes an entrance: one pair
+    of hexes facing each other (two for long runs, one at each end). Those hexes are the nodes of an abstract graph,
+    joined across entrances by a single step and, within a cluster, by the cost of the cheapest path between them that
+    stays inside it, which is worked out ahead of time.
+
+    A long query searches the abstract graph (a few nodes per cluster instead of hundreds of hexes), then refines each
+    leg with an ordinary A* that only has to cross one cluster. Paths are close to, but not always exactly, the
+    cheapest. Costs are the same as HexPlanner's.
+
+    When hexes change, only the clusters they're in (and the neighbours of those on a shared edge) are marked dirty, and
+    only those are rebuilt, right before the next query.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "grid.hpp"
+#include "hex_planner.hpp"
+
+struct HexHpaCluster {
+    // The entrance hexes in this cluster, as grid indices.
+    std::vector<uint32_t> nodes;
+
+    // The hexes across the border from node i are links[link_start[i] .. link_start[i + 1]).
+    std::vector<uint32_t> link_start;
+    std::vector<uint32_t> links;
+
+    // costs[i * nodes.size() + j] is the cost from node i to node j without leaving the cluster, or infinity.
+    std::vector<float> costs;
+
+    bool dirty;
+};
+
+struct HexHpa {
+    int offset;
+    int size;
+
+    int cluster_size;
+    int clusters_per_side;
+
+    // Indexed by cu * clusters_per_side + cv, where cluster (cu, cv) holds the hexes with
+    // cu * cluster_size <= q + offset < (cu + 1) * cluster_size, and the same for cv and r.
+    std::vector<HexHpaCluster> clusters;
+    std::vector<int> dirty_clusters;
+
+    // Refines legs, plans short routes directly, and lends its per-hex arrays and open set to the abstract search.
+    HexPlanner* planner;
+
+    // Scratch for searches within one cluster, indexed by local position in the cluster.
+    std::vector<float> local_cost;
+    IndexedHeap<float> local_open;
+
+    // Scratch for queries.
+    std::vector<float> start_cost;
+    std::vector<float> goal_cost;
+    std::vector<uint32_t> abstract_path;
+    std::vector<HexCell> leg;
+
+    // About the last query.
+    long abstract_expanded;
+    long refine_expanded;
+    float path_cost;
+};
+
+// Builds the abstract graph for the grid as it is now.
+HexHpa* create_hex_hpa(const Grid<float>* grid, int cluster_size, float cost_weight, float blocked_threshold);
+
+void destroy_hex_hpa(HexHpa* hpa);
+
+// Marks the clusters affected by changes to these hexes, to be rebuilt by the next update_hex_hpa or query.
+void hex_hpa_cells_changed(HexHpa* hpa, const HexCell* changed, int changed_count);
+
+// Rebuilds the dirty clusters. Returns how many there were.
+int update_hex_hpa(HexHpa* hpa, const Grid<float>* grid);
+
+// Finds a path from the start hex to the goal hex and replaces path with it, like plan_hex_path.
+bool plan_hex_hpa_path(HexHpa* hpa, const Grid<float>* grid, int start_q, int start_r, int goal_q, int goal_r, std::vector<HexCell>& path);
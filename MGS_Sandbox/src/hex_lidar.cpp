@@ -0,0 +1,181 @@
+#include <math.h>
+#include <string.h>
+
+#include "hex_lidar.hpp"
+#include "memory.hpp"
+
+const char* hex_fusion_name(HexFusion fusion) {
+    switch (fusion) {
+        case HEX_FUSION_MAX: return "max";
+        case HEX_FUSION_ADD: return "add";
+        case HEX_FUSION_BLEND: return "blend";
+        default: return "unknown";
+    }
+}
+
+bool parse_hex_fusion(const char* name, HexFusion* out_fusion) {
+    for (int i = 0; i < HEX_FUSION_COUNT; i++) {
+        if (strcmp(name, hex_fusion_name((HexFusion)i)) == 0) {
+            *out_fusion = (HexFusion)i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void world_to_axial(const float* x, const float* y, int count, float hex_size, int* out_q, int* out_r) {
+    const float q_scale = (2.0f / 3.0f) / hex_size;
+    const float r_scale_x = (-1.0f / 3.0f) / hex_size;
+    const float r_scale_y = (sqrtf(3.0f) / 3.0f) / hex_size;
+
+    for (int i = 0; i < count; i++) {
+        float fq = q_scale * x[i];
+        float fr = r_scale_x * x[i] + r_scale_y * y[i];
+        float fs = -fq - fr;
+
+        // Round each cube coordinate, then fix up the one that moved the most so they still add up to zero.
+        float rq = floorf(fq + 0.5f);
+        float rr = floorf(fr + 0.5f);
+        float rs = floorf(fs + 0.5f);
+
+        float dq = fabsf(rq - fq);
+        float dr = fabsf(rr - fr);
+        float ds = fabsf(rs - fs);
+
+        bool fix_q = dq > dr && dq > ds;
+        bool fix_r = !fix_q && dr > ds;
+
+        out_q[i] = (int)(fix_q ? -rr - rs : rq);
+        out_r[i] = (int)(fix_r ? -rq - rs : rr);
+    }
+}
+
+// Returns whether the hex's value changed (so false if it's off the grid).
+static inline bool fuse_hex(Grid<float>* grid, int q, int r, HexFusion fusion, float weight) {
+    if (q < -grid->layout.offset || q > grid->layout.offset || r < -grid->layout.offset || r > grid->layout.offset) return false;
+
+    float old_value = grid->get(q, r);
+    float value = old_value;
+
+    switch (fusion) {
+        case HEX_FUSION_MAX:
+            value = fmaxf(value, weight);
+            break;
+        case HEX_FUSION_ADD:
+            value = fminf(value + weight, 1.0f);
+            break;
+        default:
+            value += (1.0f - value) * weight;
+            break;
+    }
+
+    grid->set(q, r, value);
+
+    return value != old_value;
+}
+
+// Returns are converted this many at a time.
+const int HEX_BATCH_SIZE = 64;
+
+// Calls fuse(q, r) with the hex of every return closer than max_distance.
+template <typename Fn>
+static void project_world_frame(LidarModel* model, float hex_size, float x, float y, float angle, const float* lidar_points, float max_distance, Fn fuse) {
+    alignas(CACHE_LINE_SIZE) float dir_x[HEX_BATCH_SIZE];
+    alignas(CACHE_LINE_SIZE) float dir_y[HEX_BATCH_SIZE];
+    alignas(CACHE_LINE_SIZE) float point_x[HEX_BATCH_SIZE];
+    alignas(CACHE_LINE_SIZE) float point_y[HEX_BATCH_SIZE];
+    alignas(CACHE_LINE_SIZE) int q[HEX_BATCH_SIZE];
+    alignas(CACHE_LINE_SIZE) int r[HEX_BATCH_SIZE];
+
+    for (int begin = 0; begin < model->beam_count; begin += HEX_BATCH_SIZE) {
+        int end = begin + HEX_BATCH_SIZE;
+        if (end > model->beam_count) end = model->beam_count;
+
+        int count = end - begin;
+
+        rotate_lidar_beams(model, angle, begin, end, dir_x, dir_y);
+
+        for (int i = 0; i < count; i++) {
+            point_x[i] = x + lidar_points[begin + i] * dir_x[i];
+            point_y[i] = y + lidar_points[begin + i] * dir_y[i];
+        }
+
+        world_to_axial(point_x, point_y, count, hex_size, q, r);
+
+        for (int i = 0; i < count; i++) {
+            if (lidar_points[begin + i] <= max_distance) fuse(q[i], r[i]);
+        }
+    }
+}
+
+void project_lidar_to_grid(Grid<float>* grid, LidarModel* model, float hex_size, float x, float y, float angle, const float* lidar_points, float max_distance, HexFusion fusion, float weight) {
+    project_world_frame(model, hex_size, x, y, angle, lidar_points, max_distance, [&](int q, int r) {
+        fuse_hex(grid, q, r, fusion, weight);
+    });
+}
+
+void project_lidar_to_grid(HexPyramid* pyramid, LidarModel* model, float hex_size, float x, float y, float angle, const float* lidar_points, float max_distance, HexFusion fusion, float weight, std::vector<HexCell>* changed) {
+    project_world_frame(model, hex_size, x, y, angle, lidar_points, max_distance, [&](int q, int r) {
+        if (fuse_hex(&pyramid->levels[0], q, r, fusion, weight)) {
+            update_hex_pyramid(pyramid, q, r);
+            if (changed) changed->push_back({ (int16_t)q, (int16_t)r });
+        }
+    });
+}
+
+HexBeamTable* create_hex_beam_table(LidarModel* model, float hex_size, float bin_size, float max_distance) {
+    HexBeamTable* table = new HexBeamTable;
+
+    table->beam_count = model->beam_count;
+    table->bin_count = (int)ceilf(max_distance / bin_size);
+    table->bin_size = bin_size;
+
+    table->cells = (HexCell*)alloc_aligned(sizeof(HexCell) * table->beam_count * table->bin_count, CACHE_LINE_SIZE);
+
+    float point_x[HEX_BATCH_SIZE], point_y[HEX_BATCH_SIZE];
+    int q[HEX_BATCH_SIZE], r[HEX_BATCH_SIZE];
+
+    for (int beam = 0; beam < model->beam_count; beam++) {
+        for (int begin = 0; begin < table->bin_count; begin += HEX_BATCH_SIZE) {
+            int end = begin + HEX_BATCH_SIZE;
+            if (end > table->bin_count) end = table->bin_count;
+
+            // Each bin goes in the hex of its middle.
+            for (int bin = begin; bin < end; bin++) {
+                float distance = (bin + 0.5f) * bin_size;
+
+                point_x[bin - begin] = distance * model->beam_cos[beam];
+                point_y[bin - begin] = distance * model->beam_sin[beam];
+            }
+
+            world_to_axial(point_x, point_y, end - begin, hex_size, q, r);
+
+            for (int bin = begin; bin < end; bin++) {
+                table->cells[beam * table->bin_count + bin] = { (int16_t)q[bin - begin], (int16_t)r[bin - begin] };
+            }
+        }
+    }
+
+    return table;
+}
+
+void destroy_hex_beam_table(HexBeamTable* table) {
+    free_aligned(table->cells);
+
+    delete table;
+}
+
+void project_lidar_to_grid(Grid<float>* grid, HexBeamTable* table, const float* lidar_points, float max_distance, HexFusion fusion, float weight) {
+    for (int beam = 0; beam < table->beam_count; beam++) {
+        float distance = lidar_points[beam];
+        if (distance > max_distance) continue;
+
+        int bin = (int)(distance / table->bin_size);
+        if (bin >= table->bin_count) continue;
+
+        HexCell cell = table->cells[beam * table->bin_count + bin];
+
+        fuse_hex(grid, cell.q, cell.r, fusion, weight);
+    }
+}
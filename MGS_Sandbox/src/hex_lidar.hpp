@@ -0,0 +1,62 @@
+/*
+    Projects LIDAR returns into the hex Grid.
+
+    Hexes are flat-topped with hex_size meters from center to corner, laid out the way render_grid draws them: hex
+    (q, r) is centered on (3/2 q, sqrt(3)/2 q + sqrt(3) r) * hex_size. World points are converted to axial coordinates
+    a batch at a time with cube rounding, written without branches so the compiler can vectorize it.
+
+    For a grid that moves and turns with the rover, a HexBeamTable holds the hex of every (beam, range bin) pair, so
+    projecting a scan is a table lookup per return with no trigonometry at all.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "grid.hpp"
+#include "hex_pyramid.hpp"
+#include "lidar_model.hpp"
+
+// How a return is merged into the value already in its hex. Grid values go from 0 (free) to 1 (occupied).
+enum HexFusion {
+    HEX_FUSION_MAX,   // The larger of the two.
+    HEX_FUSION_ADD,   // Their sum, up to 1. Effectively a hit count.
+    HEX_FUSION_BLEND, // Moves the hex weight of the way towards 1, so it approaches 1 the more often it's hit.
+
+    HEX_FUSION_COUNT
+};
+
+const char* hex_fusion_name(HexFusion fusion);
+
+// The inverse of hex_fusion_name. Returns false if no rule has that name.
+bool parse_hex_fusion(const char* name, HexFusion* out_fusion);
+
+// Converts count points to the axial coordinates of the hexes they're in.
+void world_to_axial(const float* x, const float* y, int count, float hex_size, int* out_q, int* out_r);
+
+// Fuses a scan taken from a rover at (x, y) facing angle degrees into a world frame grid centered on the origin.
+// Returns closer than max_distance are merged into their hex with the given weight; ones off the grid are dropped.
+void project_lidar_to_grid(Grid<float>* grid, LidarModel* model, float hex_size, float x, float y, float angle, const float* lidar_points, float max_distance, HexFusion fusion, float weight);
+
+// The same into the base of a pyramid, updating the levels above each hex as it goes. If changed isn't NULL, the hexes
+// whose value changed are appended to it (for incremental planners).
+void project_lidar_to_grid(HexPyramid* pyramid, LidarModel* model, float hex_size, float x, float y, float angle, const float* lidar_points, float max_distance, HexFusion fusion, float weight, std::vector<HexCell>* changed);
+
+struct HexBeamTable {
+    int beam_count;
+
+    int bin_count;
+    float bin_size;
+
+    // The hex every return in each bin lands in, in the rover's frame with the rover on hex (0, 0). Beam-major, so a
+    // beam's bins are next to each other.
+    HexCell* cells;
+};
+
+// Range bins are bin_size meters long and go out to max_distance. Bins shorter than a hex keep the rounding error small.
+HexBeamTable* create_hex_beam_table(LidarModel* model, float hex_size, float bin_size, float max_distance);
+
+void destroy_hex_beam_table(HexBeamTable* table);
+
+// Same as project_lidar_to_grid, but into a grid in the rover's frame, with the rover on hex (0, 0).
+void project_lidar_to_grid(Grid<float>* grid, HexBeamTable* table, const float* lidar_points, float max_distance, HexFusion fusion, float weight);
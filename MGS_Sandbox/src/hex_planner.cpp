@@ -0,0 +1,127 @@
+#include <algorithm>
+
+#include "hex_planner.hpp"
+
+HexPlanner* create_hex_planner(const Grid<float>* grid, float cost_weight, float blocked_threshold) {
+    HexPlanner* planner = new HexPlanner;
+
+    planner->offset = grid->layout.offset;
+    planner->size = grid->layout.size;
+
+    planner->cost_weight = cost_weight;
+    planner->blocked_threshold = blocked_threshold;
+
+    size_t cells = grid->layout.cell_count();
+
+    planner->search_id.assign(cells, 0);
+    planner->cost.resize(cells);
+    planner->parent.resize(cells);
+
+    planner->current_search = 0;
+
+    planner->open.init(cells);
+
+    planner->expanded = 0;
+    planner->path_cost = 0;
+
+    return planner;
+}
+
+void destroy_hex_planner(HexPlanner* planner) {
+    delete planner;
+}
+
+uint32_t begin_hex_search(HexPlanner* planner) {
+    if (++planner->current_search == 0) {
+        // Wrapped around, so old searches could look like this one.
+        planner->search_id.assign(planner->search_id.size(), 0);
+        planner->current_search = 1;
+    }
+
+    return planner->current_search;
+}
+
+static bool on_grid(const HexPlanner* planner, int q, int r) {
+    return hex_length(q, r) <= planner->offset;
+}
+
+static HexCell cell_at(const HexPlanner* planner, uint32_t index) {
+    return { (int16_t)(index / planner->size - planner->offset), (int16_t)(index % planner->size - planner->offset) };
+}
+
+bool plan_hex_path(HexPlanner* planner, const Grid<float>* grid, int start_q, int start_r, int goal_q, int goal_r, std::vector<HexCell>& path) {
+    path.clear();
+
+    planner->expanded = 0;
+    planner->path_cost = 0;
+
+    if (!on_grid(planner, start_q, start_r) || !on_grid(planner, goal_q, goal_r)) return false;
+    if (hex_step_cost(planner, grid->get(goal_q, goal_r)) < 0) return false;
+
+    uint32_t search = begin_hex_search(planner);
+
+    uint32_t start = (uint32_t)grid->layout.index(start_q, start_r);
+    uint32_t goal = (uint32_t)grid->layout.index(goal_q, goal_r);
+
+    planner->search_id[start] = search;
+    planner->cost[start] = 0;
+    planner->parent[start] = start;
+
+    planner->open.push(start, { (float)hex_length(goal_q - start_q, goal_r - start_r), 0.0f });
+
+    bool found = false;
+
+    while (!planner->open.empty()) {
+        uint32_t index = planner->open.pop();
+        planner->expanded++;
+
+        if (index == goal) {
+            found = true;
+            break;
+        }
+
+        HexCell cell = cell_at(planner, index);
+        float g = planner->cost[index];
+
+        size_t neighbours[6];
+        int count = grid_neighbours(grid, cell.q, cell.r, neighbours);
+
+        for (int i = 0; i < count; i++) {
+            uint32_t next = (uint32_t)neighbours[i];
+
+            float step = hex_step_cost(planner, grid->cells[next]);
+            if (step < 0) continue;
+
+            float next_g = g + step;
+            bool seen = planner->search_id[next] == search;
+
+            // The heuristic is consistent, so a seen cell that isn't open is already as cheap as it gets.
+            if (seen && (!planner->open.contains(next) || next_g >= planner->cost[next])) continue;
+
+            planner->search_id[next] = search;
+            planner->cost[next] = next_g;
+            planner->parent[next] = index;
+
+            HexCell next_cell = cell_at(planner, next);
+            float h = (float)hex_length(goal_q - next_cell.q, goal_r - next_cell.r);
+
+            planner->open.push(next, { next_g + h, next_g });
+        }
+    }
+
+    planner->open.clear();
+
+    if (!found) return false;
+
+    planner->path_cost = planner->cost[goal];
+
+    for (uint32_t index = goal; ; index = planner->parent[index]) {
+        path.push_back(cell_at(planner, index));
+
+        if (index == start) break;
+    }
+
+    std::reverse(path.begin(), path.end());
+
+    return true;
+}
@@ -0,0 +1,72 @@
+/*
+    A* path planning over the hex Grid.
+
+    Stepping into a hex costs 1 plus cost_weight times its value, and hexes with a value above blocked_threshold can't
+    be entered at all. Every step costs at least 1, so the hex distance to the goal never overestimates and is used as
+    the heuristic.
+
+    A HexPlanner keeps everything a search needs in flat arrays indexed like the grid, allocated when the planner is
+    created. Each cell remembers which search last touched it, so starting a new search doesn't mean clearing them, and
+    queries made every frame allocate nothing once the open set has grown to the size they need.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "grid.hpp"
+#include "indexed_heap.hpp"
+
+struct HexPlannerKey {
+    // Cost so far plus the heuristic.
+    float f;
+
+    // Cost so far. Among equal f, the node furthest along is expanded first, which avoids expanding whole plateaus.
+    float g;
+
+    bool operator<(const HexPlannerKey& other) const {
+        return f < other.f || (f == other.f && g > other.g);
+    }
+};
+
+struct HexPlanner {
+    int offset;
+    int size;
+
+    float cost_weight;
+    float blocked_threshold;
+
+    // Per cell, indexed like the grid. cost and parent only mean something if search_id matches the current search.
+    std::vector<uint32_t> search_id;
+    std::vector<float> cost;
+    std::vector<uint32_t> parent;
+
+    uint32_t current_search;
+
+    IndexedHeap<HexPlannerKey> open;
+
+    // About the last search.
+    long expanded;
+    float path_cost;
+};
+
+// A planner for grids the size of grid.
+HexPlanner* create_hex_planner(const Grid<float>* grid, float cost_weight, float blocked_threshold);
+
+void destroy_hex_planner(HexPlanner* planner);
+
+// Cost of stepping into a hex with the given value, or a negative number if it can't be entered.
+inline float hex_step_cost(const HexPlanner* planner, float value) {
+    return value > planner->blocked_threshold ? -1.0f : 1.0f + planner->cost_weight * value;
+}
+
+// Starts a new search over the planner's arrays and returns its id: cells whose search_id isn't this haven't been seen.
+// plan_hex_path does this itself; it's for other searches that borrow the arrays (the open set has to be left empty).
+uint32_t begin_hex_search(HexPlanner* planner);
+
+// Finds the cheapest path from the start hex to the goal hex, and replaces path with the hexes along it (start and
+// goal included). Returns false, leaving path empty, if either end is off the grid or the goal can't be reached. The
+// start hex is allowed to be blocked, since the rover is already on it.
+bool plan_hex_path(HexPlanner* planner, const Grid<float>* grid, int start_q, int start_r, int goal_q, int goal_r, std::vector<HexCell>& path);
@@ -0,0 +1,186 @@
+#include <string.h>
+
+#include "hex_pyramid.hpp"
+
+const char* hex_aggregate_name(HexAggregate aggregate) {
+    switch (aggregate) {
+        case HEX_AGGREGATE_MAX: return "max";
+        case HEX_AGGREGATE_MEAN: return "mean";
+        case HEX_AGGREGATE_OCCUPIED: return "occupied";
+        default: return "unknown";
+    }
+}
+
+bool parse_hex_aggregate(const char* name, HexAggregate* out_aggregate) {
+    for (int i = 0; i < HEX_AGGREGATE_COUNT; i++) {
+        if (strcmp(name, hex_aggregate_name((HexAggregate)i)) == 0) {
+            *out_aggregate = (HexAggregate)i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+HexPyramid* create_hex_pyramid(int radius, int level_count, HexAggregate aggregate, float threshold) {
+    HexPyramid* pyramid = new HexPyramid;
+
+    pyramid->aggregate = aggregate;
+    pyramid->threshold = threshold;
+
+    pyramid->levels.reserve(level_count);
+
+    for (int level = 0; level < level_count; level++) {
+        // Base coordinates from -radius to radius have parents from -ceil(radius / 2^level) to floor(radius / 2^level).
+        int side = 1 << level;
+        pyramid->levels.emplace_back((radius + side - 1) / side);
+    }
+
+    return pyramid;
+}
+
+void destroy_hex_pyramid(HexPyramid* pyramid) {
+    delete pyramid;
+}
+
+int hex_pyramid_block(const HexPyramid* pyramid, int level, int q, int r, int* q0, int* r0, int* q1, int* r1) {
+    int radius = pyramid->levels[0].layout.offset;
+    int side = 1 << level;
+
+    *q0 = q * side > -radius ? q * side : -radius;
+    *r0 = r * side > -radius ? r * side : -radius;
+    *q1 = (q + 1) * side - 1 < radius ? (q + 1) * side - 1 : radius;
+    *r1 = (r + 1) * side - 1 < radius ? (r + 1) * side - 1 : radius;
+
+    if (*q1 < *q0 || *r1 < *r0) return 0;
+
+    return (*q1 - *q0 + 1) * (*r1 - *r0 + 1);
+}
+
+static int block_cells(const HexPyramid* pyramid, int level, int q, int r) {
+    int q0, r0, q1, r1;
+    return hex_pyramid_block(pyramid, level, q, r, &q0, &r0, &q1, &r1);
+}
+
+// The aggregate of cell (q, r) of a level above the base, from its children.
+static float aggregate_children(const HexPyramid* pyramid, int level, int q, int r) {
+    const Grid<float>& children = pyramid->levels[level - 1];
+
+    float max = 0.0f;
+    float sum = 0.0f;
+
+    for (int cq = q * 2; cq <= q * 2 + 1; cq++) {
+        for (int cr = r * 2; cr <= r * 2 + 1; cr++) {
+            // Children past the edge of their level cover no base cells.
+            if (cq < -children.layout.offset || cq > children.layout.offset || cr < -children.layout.offset || cr > children.layout.offset) continue;
+
+            float value = children.get(cq, cr);
+
+            if (value > max) max = value;
+
+            switch (pyramid->aggregate) {
+                case HEX_AGGREGATE_MEAN:
+                    sum += value * block_cells(pyramid, level - 1, cq, cr);
+                    break;
+                case HEX_AGGREGATE_OCCUPIED:
+                    // Base cells are values; every level above is already a count.
+                    sum += level == 1 ? (value > pyramid->threshold ? 1.0f : 0.0f) : value;
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    switch (pyramid->aggregate) {
+        case HEX_AGGREGATE_MAX: return max;
+        case HEX_AGGREGATE_MEAN: {
+            // Cells on the far edge of a level can be past the edge of the base.
+            int cells = block_cells(pyramid, level, q, r);
+            return cells > 0 ? sum / cells : 0.0f;
+        }
+        default:
+            return sum;
+    }
+}
+
+void set_hex_pyramid(HexPyramid* pyramid, int q, int r, float value) {
+    pyramid->levels[0].set(q, r, value);
+    update_hex_pyramid(pyramid, q, r);
+}
+
+void update_hex_pyramid(HexPyramid* pyramid, int q, int r) {
+    for (int level = 1; level < (int)pyramid->levels.size(); level++) {
+        // >> rounds towards negative infinity, which is the parent of a negative coordinate.
+        q >>= 1;
+        r >>= 1;
+
+        Grid<float>& grid = pyramid->levels[level];
+
+        float value = aggregate_children(pyramid, level, q, r);
+        if (value == grid.get(q, r)) break;
+
+        grid.set(q, r, value);
+    }
+}
+
+void rebuild_hex_pyramid(HexPyramid* pyramid) {
+    for (int level = 1; level < (int)pyramid->levels.size(); level++) {
+        Grid<float>& grid = pyramid->levels[level];
+
+        for (int q = -grid.layout.offset; q <= grid.layout.offset; q++) {
+            for (int r = -grid.layout.offset; r <= grid.layout.offset; r++) {
+                grid.set(q, r, aggregate_children(pyramid, level, q, r));
+            }
+        }
+    }
+}
+
+HexRegion hex_pyramid_region(const HexPyramid* pyramid, int level, int q, int r) {
+    float value = pyramid->levels[level].get(q, r);
+
+    if (level == 0) return value > pyramid->threshold ? HEX_REGION_OCCUPIED : HEX_REGION_FREE;
+
+    switch (pyramid->aggregate) {
+        case HEX_AGGREGATE_MAX:
+            return value > pyramid->threshold ? HEX_REGION_MIXED : HEX_REGION_FREE;
+        case HEX_AGGREGATE_MEAN:
+            // Only all zeros or all ones are certain.
+            if (value <= 0.0f && pyramid->threshold >= 0.0f) return HEX_REGION_FREE;
+            if (value >= 1.0f && pyramid->threshold < 1.0f) return HEX_REGION_OCCUPIED;
+            return HEX_REGION_MIXED;
+        default:
+            if (value == 0.0f) return HEX_REGION_FREE;
+            if (value == block_cells(pyramid, level, q, r)) return HEX_REGION_OCCUPIED;
+            return HEX_REGION_MIXED;
+    }
+}
+
+bool hex_pyramid_any_occupied(const HexPyramid* pyramid, int q0, int r0, int q1, int r1) {
+    return !query_hex_pyramid(pyramid, q0, r0, q1, r1, [](int level, int q, int r, HexRegion region) {
+        return region != HEX_REGION_OCCUPIED;
+    });
+}
+
+long hex_pyramid_count_occupied(const HexPyramid* pyramid, int q0, int r0, int q1, int r1) {
+    long count = 0;
+
+    query_hex_pyramid(pyramid, q0, r0, q1, r1, [&](int level, int q, int r, HexRegion region) {
+        if (region == HEX_REGION_OCCUPIED) {
+            int bq0, br0, bq1, br1;
+            hex_pyramid_block(pyramid, level, q, r, &bq0, &br0, &bq1, &br1);
+
+            // Only the part of the region inside the box.
+            bq0 = bq0 > q0 ? bq0 : q0;
+            br0 = br0 > r0 ? br0 : r0;
+            bq1 = bq1 < q1 ? bq1 : q1;
+            br1 = br1 < r1 ? br1 : r1;
+
+            count += (long)(bq1 - bq0 + 1) * (br1 - br0 + 1);
+        }
+
+        return true;
+    });
+
+    return count;
+}
@@ -0,0 +1,123 @@
+/*
+    A hex grid at several resolutions, so queries can deal with whole regions at a time instead of cell by cell.
+
+    Level 0 is an ordinary Grid<float>, and each level above it has one cell for every 2x2 block of cells in the level
+    below: cell (q, r) of level l covers the base cells from q * 2^l to (q + 1) * 2^l - 1 in q, and the same in r. In
+    world terms that makes a level l cell roughly a hex 2^l times the size, though its exact shape is a rhombus of base
+    hexes; what matters for queries is that the cells of a level cover every base cell exactly once.
+
+    Each parent holds an aggregate of its children (see HexAggregate), kept up to date as base cells change by walking
+    up from the changed cell, so a change costs a few cells per level rather than a rebuild.
+
+    query_hex_pyramid walks an axial box from the top level down and only descends into regions that are neither
+    entirely free nor entirely occupied, so large empty or solid areas cost a single cell.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "grid.hpp"
+
+// What a parent cell holds about the base cells under it.
+enum HexAggregate {
+    HEX_AGGREGATE_MAX,      // The largest value. A region is free if this isn't above the threshold.
+    HEX_AGGREGATE_MEAN,     // The mean value, for coarse costs. Assumes values go from 0 to 1.
+    HEX_AGGREGATE_OCCUPIED, // How many are above the threshold. Tells free, occupied and mixed regions apart exactly.
+
+    HEX_AGGREGATE_COUNT
+};
+
+const char* hex_aggregate_name(HexAggregate aggregate);
+
+// The inverse of hex_aggregate_name. Returns false if no aggregate has that name.
+bool parse_hex_aggregate(const char* name, HexAggregate* out_aggregate);
+
+enum HexRegion {
+    HEX_REGION_FREE,     // Every base cell is at or below the threshold.
+    HEX_REGION_OCCUPIED, // Every base cell is above the threshold.
+    HEX_REGION_MIXED     // Some of each, or the aggregate can't tell.
+};
+
+struct HexPyramid {
+    HexAggregate aggregate;
+
+    // Base cells with a value above this are occupied.
+    float threshold;
+
+    // The base cells are levels[0], which can be read (and rendered) like any other grid. Write to it with
+    // set_hex_pyramid, or write directly and then call update_hex_pyramid or rebuild_hex_pyramid.
+    std::vector<Grid<float>> levels;
+};
+
+// A pyramid whose base supports a circle with the given radius, with level_count levels in all (including the base).
+HexPyramid* create_hex_pyramid(int radius, int level_count, HexAggregate aggregate, float threshold);
+
+void destroy_hex_pyramid(HexPyramid* pyramid);
+
+// Sets a base cell and updates the cells above it.
+void set_hex_pyramid(HexPyramid* pyramid, int q, int r, float value);
+
+// Updates the cells above base cell (q, r) after it was written directly. Stops as soon as a level doesn't change.
+void update_hex_pyramid(HexPyramid* pyramid, int q, int r);
+
+// Recomputes every level above the base, after writing lots of the base directly.
+void rebuild_hex_pyramid(HexPyramid* pyramid);
+
+// The base cells covered by cell (q, r) of a level: q0 <= q <= q1 and r0 <= r <= r1. Returns how many there are.
+int hex_pyramid_block(const HexPyramid* pyramid, int level, int q, int r, int* q0, int* r0, int* q1, int* r1);
+
+HexRegion hex_pyramid_region(const HexPyramid* pyramid, int level, int q, int r);
+
+template <typename Fn>
+bool query_hex_pyramid_cell(const HexPyramid* pyramid, int level, int q, int r, int q0, int r0, int q1, int r1, Fn& fn) {
+    HexRegion region = hex_pyramid_region(pyramid, level, q, r);
+
+    if (level == 0 || region != HEX_REGION_MIXED) return fn(level, q, r, region);
+
+    // Children are only visited if some of their base cells are in the box, which is already clipped to the grid.
+    int side = 1 << (level - 1);
+
+    for (int cq = q * 2; cq <= q * 2 + 1; cq++) {
+        if (cq * side > q1 || (cq + 1) * side - 1 < q0) continue;
+
+        for (int cr = r * 2; cr <= r * 2 + 1; cr++) {
+            if (cr * side > r1 || (cr + 1) * side - 1 < r0) continue;
+
+            if (!query_hex_pyramid_cell(pyramid, level - 1, cq, cr, q0, r0, q1, r1, fn)) return false;
+        }
+    }
+
+    return true;
+}
+
+// Calls fn(level, q, r, region) for a set of pyramid cells covering every base cell with q0 <= q <= q1 and
+// r0 <= r <= r1, as coarse as the aggregate allows: free and occupied regions come whole (and can reach past the box;
+// use hex_pyramid_block to clip them), and only mixed ones are split, down to base cells if need be. fn returns false
+// to stop early, in which case so does this. A hex of radius d around (q, r) fits in the box q +- d, r +- d.
+template <typename Fn>
+bool query_hex_pyramid(const HexPyramid* pyramid, int q0, int r0, int q1, int r1, Fn fn) {
+    int radius = pyramid->levels[0].layout.offset;
+
+    q0 = q0 > -radius ? q0 : -radius;
+    r0 = r0 > -radius ? r0 : -radius;
+    q1 = q1 < radius ? q1 : radius;
+    r1 = r1 < radius ? r1 : radius;
+
+    int top = (int)pyramid->levels.size() - 1;
+
+    // >> rounds towards negative infinity, which is the parent of a negative coordinate.
+    for (int q = q0 >> top; q <= q1 >> top; q++) {
+        for (int r = r0 >> top; r <= r1 >> top; r++) {
+            if (!query_hex_pyramid_cell(pyramid, top, q, r, q0, r0, q1, r1, fn)) return false;
+        }
+    }
+
+    return true;
+}
+
+// Whether any base cell in the box is occupied.
+bool hex_pyramid_any_occupied(const HexPyramid* pyramid, int q0, int r0, int q1, int r1);
+
+// How many base cells in the box are occupied.
+long hex_pyramid_count_occupied(const HexPyramid* pyramid, int q0, int r0, int q1, int r1);
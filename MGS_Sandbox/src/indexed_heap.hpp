@@ -0,0 +1,153 @@
+/*
+    A binary min-heap of items (small integers, like grid cell indices) that knows where each item is, so an item's key
+    can be changed or the item removed without searching for it.
+
+    Storage only ever grows: once a heap has been as big as a search needs, later searches allocate nothing.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+const uint32_t HEAP_ABSENT = 0xffffffff;
+
+// Key needs operator<. The smallest key comes out first.
+template <typename Key>
+struct IndexedHeap {
+    struct Entry {
+        Key key;
+        uint32_t item;
+    };
+
+    std::vector<Entry> entries;
+
+    // Where each item is in entries, or HEAP_ABSENT.
+    std::vector<uint32_t> position;
+
+    // Makes room for items 0 .. item_count - 1 and empties the heap.
+    void init(size_t item_count) {
+        entries.clear();
+        position.assign(item_count, HEAP_ABSENT);
+    }
+
+    bool empty() const {
+        return entries.empty();
+    }
+
+    size_t size() const {
+        return entries.size();
+    }
+
+    bool contains(uint32_t item) const {
+        return position[item] != HEAP_ABSENT;
+    }
+
+    const Entry& top() const {
+        return entries[0];
+    }
+
+    const Key& key(uint32_t item) const {
+        return entries[position[item]].key;
+    }
+
+    // Adds item, or changes its key if it's already in the heap.
+    void push(uint32_t item, const Key& key) {
+        uint32_t i = position[item];
+
+        if (i == HEAP_ABSENT) {
+            i = (uint32_t)entries.size();
+            entries.push_back({ key, item });
+            position[item] = i;
+
+            sift_up(i);
+        } else {
+            bool smaller = key < entries[i].key;
+            entries[i].key = key;
+
+            if (smaller) {
+                sift_up(i);
+            } else {
+                sift_down(i);
+            }
+        }
+    }
+
+    uint32_t pop() {
+        uint32_t item = entries[0].item;
+        remove_at(0);
+
+        return item;
+    }
+
+    void remove(uint32_t item) {
+        if (position[item] != HEAP_ABSENT) remove_at(position[item]);
+    }
+
+    // Empties the heap in time proportional to how full it is.
+    void clear() {
+        for (const Entry& entry : entries) {
+            position[entry.item] = HEAP_ABSENT;
+        }
+
+        entries.clear();
+    }
+
+    void remove_at(uint32_t i) {
+        position[entries[i].item] = HEAP_ABSENT;
+
+        Entry last = entries.back();
+        entries.pop_back();
+
+        if (i == entries.size()) return;
+
+        bool smaller = last.key < entries[i].key;
+
+        entries[i] = last;
+        position[last.item] = i;
+
+        if (smaller) {
+            sift_up(i);
+        } else {
+            sift_down(i);
+        }
+    }
+
+    void sift_up(uint32_t i) {
+        Entry entry = entries[i];
+
+        while (i > 0) {
+            uint32_t parent = (i - 1) / 2;
+            if (!(entry.key < entries[parent].key)) break;
+
+            entries[i] = entries[parent];
+            position[entries[i].item] = i;
+            i = parent;
+        }
+
+        entries[i] = entry;
+        position[entry.item] = i;
+    }
+
+    void sift_down(uint32_t i) {
+        Entry entry = entries[i];
+        uint32_t count = (uint32_t)entries.size();
+
+        for (;;) {
+            uint32_t child = 2 * i + 1;
+            if (child >= count) break;
+
+            if (child + 1 < count && entries[child + 1].key < entries[child].key) child++;
+            if (!(entries[child].key < entry.key)) break;
+
+            entries[i] = entries[child];
+            position[entries[i].item] = i;
+            i = child;
+        }
+
+        entries[i] = entry;
+        position[entry.item] = i;
+    }
+};
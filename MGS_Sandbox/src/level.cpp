@@ -0,0 +1,228 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "chunked_world.hpp"
+#include "level.hpp"
+
+void swap_bytes(void* values, size_t size, size_t count) {
+    uint8_t* bytes = (uint8_t*)values;
+
+    for (size_t i = 0; i < count; i++, bytes += size) {
+        for (size_t j = 0; j < size / 2; j++) {
+            uint8_t byte = bytes[j];
+            bytes[j] = bytes[size - 1 - j];
+            bytes[size - 1 - j] = byte;
+        }
+    }
+}
+
+static void swap_header_bytes(LevelHeader* header) {
+    swap_bytes(&header->version, sizeof(header->version), 1);
+    swap_bytes(&header->obstacle_size, sizeof(header->obstacle_size), 1);
+    swap_bytes(&header->obstacle_count, sizeof(header->obstacle_count), 1);
+}
+
+static bool load_binary_level(const char* path, const char* data, size_t size, std::vector<Obstacle>& obstacles) {
+    LevelHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (LEVEL_HOST_BIG_ENDIAN) swap_header_bytes(&header);
+
+    if (header.version != LEVEL_VERSION) {
+        printf("[!] %s is version %u of the binary level format, but only version %u is supported.\n", path, header.version, LEVEL_VERSION);
+        return false;
+    }
+
+    if (header.obstacle_size != sizeof(Obstacle)) {
+        printf("[!] %s has %u byte obstacles, expected %zu.\n", path, header.obstacle_size, sizeof(Obstacle));
+        return false;
+    }
+
+    if (header.obstacle_count > (size - sizeof(header)) / sizeof(Obstacle)) {
+        printf("[!] %s is truncated.\n", path);
+        return false;
+    }
+
+    // The header is a multiple of 8 bytes and the mapping is page aligned, so the obstacles are suitably aligned.
+    const Obstacle* first = (const Obstacle*)(data + sizeof(header));
+    size_t old_count = obstacles.size();
+    obstacles.insert(obstacles.end(), first, first + header.obstacle_count);
+
+    if (LEVEL_HOST_BIG_ENDIAN) swap_bytes(obstacles.data() + old_count, sizeof(float), header.obstacle_count * 4);
+
+    return true;
+}
+
+static void load_text_level(const char* data, size_t size, std::vector<Obstacle>& obstacles) {
+    const char* end = data + size;
+
+    while (data < end) {
+        const char* line_end = (const char*)memchr(data, '\n', end - data);
+        if (!line_end) line_end = end;
+
+        // strtof needs a terminated string, and the mapping doesn't have one at the end.
+        char line[1024];
+        size_t length = line_end - data;
+        if (length > sizeof(line) - 1) length = sizeof(line) - 1;
+
+        memcpy(line, data, length);
+        line[length] = 0;
+
+        if (strncmp(line, "obstacle", 8) == 0) {
+            char* lptr = line + 8;
+            float x = strtof(lptr, &lptr);
+            float y = strtof(lptr, &lptr);
+            float w = strtof(lptr, &lptr);
+            float h = strtof(lptr, &lptr);
+
+            obstacles.push_back({ x, y, w, h });
+        }
+
+        data = line_end + 1;
+    }
+}
+
+bool load_level(const char* path, std::vector<Obstacle>& obstacles) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("[!] Couldn't open level %s.\n", path);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        printf("[!] Couldn't stat level %s.\n", path);
+        close(fd);
+        return false;
+    }
+
+    size_t size = st.st_size;
+
+    if (size == 0) {
+        close(fd);
+        return true;
+    }
+
+    void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        printf("[!] Couldn't map level %s.\n", path);
+        return false;
+    }
+
+    madvise(mapping, size, MADV_SEQUENTIAL);
+
+    const char* data = (const char*)mapping;
+    bool ok = true;
+
+    if (size >= sizeof(LevelHeader) && memcmp(data, LEVEL_MAGIC, sizeof(LEVEL_MAGIC)) == 0) {
+        ok = load_binary_level(path, data, size, obstacles);
+    } else {
+        load_text_level(data, size, obstacles);
+    }
+
+    munmap(mapping, size);
+
+    return ok;
+}
+
+bool save_level(const char* path, std::vector<Obstacle>& obstacles, LevelFormat format) {
+    FILE* out_file = fopen(path, format == LEVEL_FORMAT_BINARY ? "wb" : "w");
+    if (!out_file) {
+        printf("[!] Couldn't open %s for writing.\n", path);
+        return false;
+    }
+
+    if (format == LEVEL_FORMAT_BINARY) {
+        LevelHeader header;
+        memcpy(header.magic, LEVEL_MAGIC, sizeof(LEVEL_MAGIC));
+        header.version = LEVEL_VERSION;
+        header.obstacle_size = sizeof(Obstacle);
+        header.obstacle_count = obstacles.size();
+
+        if (LEVEL_HOST_BIG_ENDIAN) {
+            swap_header_bytes(&header);
+            fwrite(&header, sizeof(header), 1, out_file);
+
+            for (Obstacle obs : obstacles) {
+                swap_bytes(&obs, sizeof(float), 4);
+                fwrite(&obs, sizeof(Obstacle), 1, out_file);
+            }
+        } else {
+            fwrite(&header, sizeof(header), 1, out_file);
+            fwrite(obstacles.data(), sizeof(Obstacle), obstacles.size(), out_file);
+        }
+    } else {
+        for (Obstacle obs : obstacles) {
+            fprintf(out_file, "obstacle %f %f %f %f\n", obs.x, obs.y, obs.w, obs.h);
+        }
+    }
+
+    bool ok = !ferror(out_file);
+
+    if (fclose(out_file) != 0) ok = false;
+    if (!ok) printf("[!] Failed to write %s.\n", path);
+
+    return ok;
+}
+
+int run_level_converter(int argc, char** argv) {
+    const char* in_path = NULL;
+    const char* out_path = NULL;
+    LevelFormat format = LEVEL_FORMAT_BINARY;
+
+    // Non-zero when writing a chunked world instead of a level.
+    float chunk_size = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--convert") == 0) {
+            continue;
+        } else if (strcmp(argv[i], "--text") == 0) {
+            format = LEVEL_FORMAT_TEXT;
+        } else if (strcmp(argv[i], "--binary") == 0) {
+            format = LEVEL_FORMAT_BINARY;
+        } else if (strcmp(argv[i], "--chunked") == 0 && i + 1 < argc) {
+            chunk_size = strtof(argv[++i], NULL);
+
+            if (chunk_size <= 0) {
+                in_path = NULL;
+                break;
+            }
+        } else if (!in_path) {
+            in_path = argv[i];
+        } else if (!out_path) {
+            out_path = argv[i];
+        } else {
+            in_path = NULL;
+            break;
+        }
+    }
+
+    if (!in_path || !out_path) {
+        printf("usage: mgs_playground --convert <in.mgslevel> <out.mgslevel> [--text | --binary (default)]\n");
+        printf("       mgs_playground --convert <in.mgslevel> <out.mgsworld> --chunked <chunk size in meters>\n");
+        return 1;
+    }
+
+    std::vector<Obstacle> obstacles;
+    if (!load_level(in_path, obstacles)) return 1;
+
+    if (chunk_size > 0) {
+        if (!save_chunked_world(out_path, obstacles, chunk_size)) return 1;
+
+        printf("> Wrote %zu obstacles to %s (chunked, %g m chunks).\n", obstacles.size(), out_path, chunk_size);
+
+        return 0;
+    }
+
+    if (!save_level(out_path, obstacles, format)) return 1;
+
+    printf("> Wrote %zu obstacles to %s (%s).\n", obstacles.size(), out_path, format == LEVEL_FORMAT_BINARY ? "binary" : "text");
+
+    return 0;
+}
@@ -0,0 +1,60 @@
+/*
+    Loading and saving of .mgslevel files.
+
+    There are two formats, told apart by the first bytes of the file:
+        Text:   one obstacle per line, "obstacle <x> <y> <w> <h>". Easy to read and edit by hand.
+        Binary: a LevelHeader followed straight away by the obstacles, packed exactly like the Obstacle struct
+                (four little-endian floats each). The header's numbers are little-endian too. On little-endian
+                hosts loading one is a single copy out of the memory mapped file; big-endian hosts swap the bytes
+                on the way in and out.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "obstacle.hpp"
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+const bool LEVEL_HOST_BIG_ENDIAN = true;
+#else
+const bool LEVEL_HOST_BIG_ENDIAN = false;
+#endif
+
+// Reverses the bytes of each of count size byte values, turning little-endian into host order on big-endian hosts
+// and back. Chunked worlds use it too.
+void swap_bytes(void* values, size_t size, size_t count);
+
+enum LevelFormat {
+    LEVEL_FORMAT_TEXT,
+    LEVEL_FORMAT_BINARY
+};
+
+const char LEVEL_MAGIC[8] = { 'M', 'G', 'S', 'L', 'E', 'V', 'E', 'L' };
+
+// Bump this whenever the binary layout changes.
+const uint32_t LEVEL_VERSION = 1;
+
+struct LevelHeader {
+    char magic[8];
+
+    uint32_t version;
+
+    // sizeof(Obstacle) when the file was written, as a sanity check.
+    uint32_t obstacle_size;
+
+    uint64_t obstacle_count;
+};
+
+// Appends the obstacles in the level to obstacles. Returns false (after printing why) if the file couldn't be read.
+bool load_level(const char* path, std::vector<Obstacle>& obstacles);
+
+bool save_level(const char* path, std::vector<Obstacle>& obstacles, LevelFormat format);
+
+// Command line level converter: mgs_playground --convert <in.mgslevel> <out.mgslevel> [--text | --binary], or
+// --chunked <chunk size> to write a chunked world (see chunked_world.hpp).
+// argv is the full command line. Returns the process exit code.
+int run_level_converter(int argc, char** argv);
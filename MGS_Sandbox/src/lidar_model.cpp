@@ -0,0 +1,61 @@
+#include <math.h>
+
+#include "lidar_model.hpp"
+#include "memory.hpp"
+
+LidarModel* create_lidar_model(float min_angle, float angle_step, int beam_count) {
+    LidarModel* model = new LidarModel;
+
+    model->min_angle = min_angle;
+    model->angle_step = angle_step;
+    model->beam_count = beam_count;
+
+    model->beam_cos = (float*)alloc_aligned(sizeof(float) * beam_count, CACHE_LINE_SIZE);
+    model->beam_sin = (float*)alloc_aligned(sizeof(float) * beam_count, CACHE_LINE_SIZE);
+
+    for (int i = 0; i < beam_count; i++) {
+        // In double, so the last beams don't pick up the rounding error of all the steps before them.
+        double theta = ((double)min_angle + (double)angle_step * i) * M_PI / 180.0;
+
+        model->beam_cos[i] = (float)cos(theta);
+        model->beam_sin[i] = (float)sin(theta);
+    }
+
+    return model;
+}
+
+LidarModel* create_sim_lidar_model() {
+    return create_lidar_model(-45.0f, 1.0f, LIDAR_SIM_BEAM_COUNT);
+}
+
+LidarModel* create_utm_lidar_model() {
+    return create_lidar_model(-45.0f, 0.25f, LIDAR_UTM_BEAM_COUNT);
+}
+
+void destroy_lidar_model(LidarModel* model) {
+    free_aligned(model->beam_cos);
+    free_aligned(model->beam_sin);
+
+    delete model;
+}
+
+float lidar_beam_angle(LidarModel* model, int beam) {
+    return model->min_angle + model->angle_step * beam;
+}
+
+void lidar_heading(float angle, float* cos_angle, float* sin_angle) {
+    double theta = (double)angle * M_PI / 180.0;
+
+    *cos_angle = (float)cos(theta);
+    *sin_angle = (float)sin(theta);
+}
+
+void rotate_lidar_beams(LidarModel* model, float angle, int first_beam, int end_beam, float* dir_x, float* dir_y) {
+    float cos_angle, sin_angle;
+    lidar_heading(angle, &cos_angle, &sin_angle);
+
+    for (int i = first_beam; i < end_beam; i++) {
+        dir_x[i - first_beam] = model->beam_cos[i] * cos_angle - model->beam_sin[i] * sin_angle;
+        dir_y[i - first_beam] = model->beam_sin[i] * cos_angle + model->beam_cos[i] * sin_angle;
+    }
+}
@@ -0,0 +1,48 @@
+/*
+    Describes the LIDAR: which angles its beams point at, relative to the rover.
+
+    The direction of every beam is worked out once when the model is created, so scanning only has to rotate those by
+    the rover's heading (a couple of multiplies per beam) instead of calling cosf/sinf for every ray. The occupancy
+    update and the renderer use the same tables.
+
+    Every scan path (whole, parallel or a few beams at a time) rotates the beams with rotate_lidar_beams, so a beam's
+    direction, and so its range, doesn't depend on how the scan was split up.
+*/
+
+#pragma once
+
+struct LidarModel {
+    // Angle of the first beam relative to the rover, and the angle between beams, in degrees.
+    float min_angle;
+    float angle_step;
+
+    int beam_count;
+
+    // Unit direction of each beam in the rover's frame. Cache line aligned, beam_count long.
+    float* beam_cos;
+    float* beam_sin;
+};
+
+// The simulated scanner the sandbox started out with: 1 degree steps from -45 to 225 degrees.
+const int LIDAR_SIM_BEAM_COUNT = 271;
+
+// The rover's real scanner: 0.25 degree steps over the same range.
+const int LIDAR_UTM_BEAM_COUNT = 1081;
+
+LidarModel* create_lidar_model(float min_angle, float angle_step, int beam_count);
+
+LidarModel* create_sim_lidar_model();
+LidarModel* create_utm_lidar_model();
+
+void destroy_lidar_model(LidarModel* model);
+
+// Angle of a beam relative to the rover, in degrees.
+float lidar_beam_angle(LidarModel* model, int beam);
+
+// Writes the world frame directions of beams [first_beam, end_beam) for a rover heading of angle degrees to
+// dir_x[0 .. end_beam - first_beam) and dir_y[...]. Every caller gets exactly the same directions for a beam, however
+// the beams are split up.
+void rotate_lidar_beams(LidarModel* model, float angle, int first_beam, int end_beam, float* dir_x, float* dir_y);
+
+// The heading rotation used by rotate_lidar_beams.
+void lidar_heading(float angle, float* cos_angle, float* sin_angle);
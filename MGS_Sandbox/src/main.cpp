@@ -1,281 +1,65 @@
-#include <math.h>
-#include <stdint.h>
-
-#include <vector>
-
-#include <GL/gl.h>
-#include <SDL.h>
-
-#include "grid.hpp"
-#include "obstacle.hpp"
-
-const int WINDOW_WIDTH = 800, WINDOW_HEIGHT = 800;
-
-struct OccupancyGrid {
-	float side_size;
-
-	int size;
-
-	int* data;
-};
-
-void fill_hex(float shade) {
-    glBegin(GL_POLYGON);
-
-    glColor4f(shade, shade, shade, 1.0f);
-
-    for (int i = 0; i < 6; i++) {
-        float theta = (M_PI / 3.0f) * i;
-
-        glVertex2f(cosf(theta), sinf(theta));
-    }
-
-    glEnd();
-}
-
-void stroke_hex(int stroke_width) {
-    glLineWidth(stroke_width);
-
-    glBegin(GL_LINE_LOOP);
-
-    glColor4f(1.0f, 0.0f, 0.0f, 1.0f);
-
-    for (int i = 0; i < 6; i++) {
-        float theta = (M_PI / 3.0f) * i;
-
-        glVertex2f(cosf(theta), sinf(theta));
-    }
-
-    glEnd();
-}
-
-void render_grid(Grid* grid, float stroke_width) {
-    for (int q = -grid->offset; q <= grid->offset; q++) {
-        for (int r = -grid->offset; r <= grid->offset; r++) {
-            glPushMatrix();
-
-            glTranslatef((3.0f/2.0f) * q, (sqrtf(3.0f)/2.0f) * q + sqrtf(3.0f) * r, 0.0f);
-
-            fill_hex(1.0f - grid->get(q, r));
-            stroke_hex(stroke_width);
-
-            glPopMatrix();
-        }
-    }
-}
-
-void outline_origin(int stroke_width) {
-    glLineWidth(stroke_width);
-
-    glBegin(GL_LINE_LOOP);
+#include <string.h>
 
-    glColor4f(0.0f, 1.0f, 0.0f, 1.0f);
+#include "grid_bench.hpp"
+#include "headless.hpp"
+#include "level.hpp"
 
-    for (int i = 0; i < 6; i++) {
-        float theta = (M_PI / 3.0f) * i;
+#ifdef MGS_HEADLESS_ONLY
 
-        glVertex2f(cosf(theta), sinf(theta));
+// Built without SDL and OpenGL (make mgs_headless), so headless mode (and the level converter and benchmarks) is all
+// there is.
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "--convert") == 0) {
+        return run_level_converter(argc, argv);
     }
 
-    glEnd();
-}
-
-void render_rover(float rover_x, float rover_y, const float rover_width, const float rover_height, float rover_angle) {
-    glPushMatrix();
-
-    glTranslatef(rover_x, rover_y, 0.0f);
-    glRotatef(rover_angle, 0.0f, 0.0f, -1.0f);
-    glScalef(rover_width, rover_height, 1.0f);
-
-    glBegin(GL_QUADS);
-
-    glColor4f(0.0f, 0.0f, 1.0f, 1.0f);
-
-    glVertex2f(0.5f, 0.5f);
-    glVertex2f(0.5f, -0.5f);
-    glVertex2f(-0.5f, -0.5f);
-    glVertex2f(-0.5f, 0.5f);
-
-    glEnd();
-
-    // Draw the "arrow".
-
-    glBegin(GL_TRIANGLES);
-
-    glColor4f(0.0f, 1.0f, 0.0f, 1.0f);
-
-    glVertex2f(0.0f, 0.25f);
-    glVertex2f(-0.25f, 0.0f);
-    glVertex2f(0.25f, 0.0f);
-
-    glEnd();
-
-    glPopMatrix();
-}
-
-void render_obstacle(Obstacle* obstacle) {
-    glPushMatrix();
-
-    glTranslatef(obstacle->x, obstacle->y, 0.0f);
-
-    glScalef(obstacle->w, obstacle->h, 1.0f);
-
-    glColor4f(1.0f, 0.0f, 1.0f, 1.0f);
-
-    glBegin(GL_QUADS);
-
-    glVertex2f(0.5f, 0.5f);
-    glVertex2f(0.5f, -0.5f);
-    glVertex2f(-0.5f, -0.5f);
-    glVertex2f(-0.5f, 0.5f);
-
-    glEnd();
-
-    glPopMatrix();
-}
-
-void render_occupancy_grid(OccupancyGrid* occupancy_grid, float rover_x, float rover_y, float rover_angle) {
-	int max = 1;
-	for (int i = 0; i < occupancy_grid->size * occupancy_grid->size; i++) {
-		if (occupancy_grid->data[i] > max) {
-			max = occupancy_grid->data[i];
-		}
-	}
-
-	glPushMatrix();
-
-	int hs = occupancy_grid->size / 2;
-
-	glTranslatef(rover_x, rover_y, 0.0f);
-	glRotatef(rover_angle, 0.0f, 0.0f, -1.0f);
-	glScalef(occupancy_grid->side_size, occupancy_grid->side_size, 1.0f);
-	glTranslatef(-hs, -hs, 0.0f);
-
-
-	for (int x = 0; x < occupancy_grid->size; x++) {
-		for (int y = 0; y < occupancy_grid->size; y++) {
-			int idx = y * occupancy_grid->size + x;
-
-			glColor4f(0.0f, 0.0f, 0.0f, (float)occupancy_grid->data[idx] / (float)max);
-			//glColor4f(0.0f, 0.0f, 0.0f, 0.25f);
-
-			glBegin(GL_QUADS);
-
-			glVertex2f(x, y);
-			glVertex2f(x + 1, y);
-			glVertex2f(x + 1, y + 1);
-			glVertex2f(x, y + 1);
-
-			glEnd();
-		}
-	}
-
-	glPopMatrix();
-}
-
-void render_lidar_range(float rover_x, float rover_y, float rover_angle) {
-    glPushMatrix();
-
-    glTranslatef(rover_x, rover_y, 0.0f);
-    glRotatef(rover_angle, 0.0f, 0.0f, -1.0f);
-    glScalef(10.0f, 10.0f, 1.0f);
-
-    glColor4f(1.0f, 0.564f, 0.141f, 0.75f);
-
-    glBegin(GL_TRIANGLE_FAN);
-
-    glVertex2f(0.0f, 0.0f);
-
-    for (int i = -45; i <= 225; i++) {
-        float theta = i * M_PI / 180.0f;
-
-        glVertex2f(cosf(theta), sinf(theta));
+    if (argc > 1 && strcmp(argv[1], "--grid-bench") == 0) {
+        return run_grid_benchmark(argc, argv);
     }
 
-    glEnd();
-
-    glPopMatrix();
+    return run_headless(argc, argv);
 }
 
-void render_lidar_point(float rover_x, float rover_y, float rover_angle, float point_angle, float distance, float pixels_per_meter) {
-    glPushMatrix();
-
-    glTranslatef(rover_x, rover_y, 0.0f);
-    glRotatef(rover_angle, 0.0f, 0.0f, -1.0f);
-    glScalef(distance, distance, 1.0f);
-
-    glColor4f(0.0f, 1.0f, 0.0f, 1.0f);
+#else
 
-    glBegin(GL_QUADS);
-
-    float theta = point_angle * M_PI / 180.0f;
+#include <math.h>
+#include <stdint.h>
 
-    float hw = 2.0f / (pixels_per_meter * distance);
+#include <vector>
 
-    glVertex2f(cosf(theta) + hw, sinf(theta) + hw);
-    glVertex2f(cosf(theta) + hw, sinf(theta) - hw);
-    glVertex2f(cosf(theta) - hw, sinf(theta) - hw);
-    glVertex2f(cosf(theta) - hw, sinf(theta) + hw);
+#include <GL/gl.h>
+#include <SDL.h>
 
-    glEnd();
+#include "chunked_world.hpp"
+#include "grid.hpp"
+#include "hex_lidar.hpp"
+#include "obstacle.hpp"
+#include "obstacle_grid.hpp"
+#include "occupancy.hpp"
+#include "renderer.hpp"
+#include "rover.hpp"
+#include "simulation.hpp"
+#include "world.hpp"
 
-    glPopMatrix();
-}
+const int WINDOW_WIDTH = 800, WINDOW_HEIGHT = 800;
 
 float lerp(float a, float b, float t) {
     return (1.0f - t) * a + t * b;
 }
 
-void save_level(FILE* out_file, std::vector<Obstacle>& obstacles) {
-	for (Obstacle obs : obstacles) {
-		fprintf(out_file, "obstacle %f %f %f %f\n", obs.x, obs.y, obs.w, obs.h);
-	}
-}
-
-bool read_line(FILE* in_file, char* line) {
-	for (;;) {
-		char c;
-		fread(&c, 1, 1, in_file);
-
-		if (c == '\n') return true;
-		if (feof(in_file)) return false;
-
-		*line = c;
-		line++;
-	}
-}
-
-void load_level(FILE* in_file, std::vector<Obstacle>& obstacles) {
-	char line[1024];
-
-	while (true) {
-		if (!read_line(in_file, line)) break;
-
-		if (strncmp(line, "obstacle", 8) == 0) {
-			char* lptr = line + 8;
-			float x = strtof(lptr, &lptr);
-			float y = strtof(lptr, &lptr);
-			float w = strtof(lptr, &lptr);
-			float h = strtof(lptr, &lptr);
-
-			obstacles.push_back({ x, y, w, h });
-		}
-	}
-}
-
-
-OccupancyGrid* create_occupancy_grid(float side_size, int size) {
-	OccupancyGrid* grid = new OccupancyGrid;
-
-	grid->side_size = side_size;
-	grid->size = size;
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "--headless") == 0) {
+        return run_headless(argc, argv);
+    }
 
-	grid->data = new int[size * size];
+    if (argc > 1 && strcmp(argv[1], "--convert") == 0) {
+        return run_level_converter(argc, argv);
+    }
 
-	return grid;
-}
+    if (argc > 1 && strcmp(argv[1], "--grid-bench") == 0) {
+        return run_grid_benchmark(argc, argv);
+    }
 
-int main(int argc, char** argv) {
     SDL_Init(SDL_INIT_VIDEO);
 
     SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, 16);
@@ -303,53 +87,102 @@ int main(int argc, char** argv) {
 
     glDisable(GL_DEPTH_TEST);
 
+    // Draws everything from vertex buffers and textures. F reports how many draw calls, vertices and texel uploads the
+    // last frame took.
+    Renderer* renderer = create_renderer();
+    uint64_t frame_ticks = 0;
+
     float grid_size = 1.0f; // Length of each hexagon side in meters.
+    const int GRID_RADIUS = 30;
 
     const float MIN_PPM = 10.0f;
     const float MAX_PPM = 200.0f;
     float pixels_per_meter = 30.0f;
 
-    Grid* grid = create_grid(30);
-
-	const float OCC_GRID_SIDE_SIZE = 0.25f;
-	OccupancyGrid* occupancy_grid = create_occupancy_grid(OCC_GRID_SIDE_SIZE, ceilf(20.0f / OCC_GRID_SIDE_SIZE));
-
     const float ROVER_WIDTH = 1.0f;
     const float ROVER_HEIGHT = 1.5f;
 	const float ROVER_SPEED = 0.5f;
 
-    float rover_angle = -180.0f;
-
-    float rover_x = 0, rover_y = 0;
-
 	float rover_dangle = 0;
 	float rover_speed = 0;
 
     float translate_x = (WINDOW_WIDTH/2.0f)/pixels_per_meter, translate_y = (WINDOW_HEIGHT/2.0f)/pixels_per_meter;
 
-    std::vector<Obstacle> obstacles;
+    World* world = create_world();
+
+    // Set when the level is a chunked world, which gets streamed in around the rover and can't be edited.
+    ChunkStreamer* streamer = NULL;
 
 	if (argc > 1) {
-		FILE* in_file = fopen(argv[1], "r");
-		printf("> Loading level %s\n", argv[1]);
-		load_level(in_file, obstacles);
-		fclose(in_file);
+		if (is_chunked_world(argv[1])) {
+			printf("> Streaming world %s\n", argv[1]);
+			streamer = open_chunk_streamer(argv[1]);
+		} else {
+			printf("> Loading level %s\n", argv[1]);
+			load_level(argv[1], world->obstacles);
+			mark_world_changed(world);
+		}
 	}
 
-    float lidar_points[271];
+    // T switches between the simulated scanner and a model of the real one.
+    LidarModel* sim_lidar_model = create_sim_lidar_model();
+    LidarModel* utm_lidar_model = create_utm_lidar_model();
+
+    // Toggled with M: split scans across a pool of worker threads.
+    WorkerPool* worker_pool = create_worker_pool(0);
+
+    // The rover, the LIDAR and the maps run on the simulation thread from here on. The world, streamer, models and
+    // pool are only touched through commands until it's stopped.
+    SimConfig sim_config;
+    sim_config.world = world;
+    sim_config.streamer = streamer;
+    sim_config.pool = worker_pool;
+    sim_config.lidar_model = sim_lidar_model;
+    sim_config.alternate_lidar_model = utm_lidar_model;
+    sim_config.engine = LIDAR_ENGINE_GRID;
+    sim_config.occupancy_update = OCCUPANCY_UPDATE_CARVE;
+    sim_config.occupancy_cell_size = 0.25f;
+    sim_config.hex_size = grid_size;
+    sim_config.hex_radius = GRID_RADIUS;
+    sim_config.start = { 0, 0, -180.0f };
+    sim_config.rover_radius = 0.5f * sqrtf(ROVER_WIDTH * ROVER_WIDTH + ROVER_HEIGHT * ROVER_HEIGHT);
+    sim_config.path = NULL;
+    sim_config.time_scale = 1.0;
+
+    Simulation* sim = start_simulation(sim_config);
+
+    // Copies of the simulation's maps, kept up to date from the changes in each state. C clears the occupancy map, and
+    // middle click sets a goal for the path planner.
+	OccupancyMap* occupancy_map = create_occupancy_map(sim_config.occupancy_cell_size);
+    Grid<float> hex_grid(GRID_RADIUS);
+    std::vector<HexCell> changed_hexes;
+
+    update_render_grid(renderer, &hex_grid, NULL, 0);
+
+    // The latest state taken from the simulation, and the obstacles as of it, with a grid to find the ones on screen.
+    const SimState* state = NULL;
+    uint64_t state_step = 0;
+
+    std::vector<Obstacle> obstacles;
+    uint64_t obstacles_version = UINT64_MAX;
+    ObstacleGrid* obstacle_grid = NULL;
 
     bool right_mouse_down = false;
 
 	bool display_grid = true;
 	bool display_lidar = true;
 	bool display_obstacles = true;
-	bool display_occupancy_grid = true;
+	bool display_occupancy_map = true;
 
     Obstacle drag_obstacle;
     bool dragging = false;
 
+    // The obstacles on screen, found through obstacle_grid every frame.
+    std::vector<Obstacle> visible_obstacles;
+
     for (;;) {
         bool should_quit = false;
+        bool drive_changed = false;
 
         SDL_Event event;
         while (SDL_PollEvent(&event)) {
@@ -358,59 +191,85 @@ int main(int argc, char** argv) {
                 break;
             }
 
+            SimCommand command;
+
             if (event.type == SDL_KEYDOWN) {
                 if (event.key.keysym.sym == SDLK_ESCAPE) {
                     should_quit = true;
                     break;
                 } else if (event.key.keysym.sym == SDLK_u) {
-                    if (obstacles.size() != 0) {
-                        printf("> Undoing last placed obstacle.\n");
-
-                        obstacles.pop_back();
-                    }
+                    command.type = SIM_COMMAND_UNDO_OBSTACLE;
+                    send_sim_command(sim, command);
                 } else if (event.key.keysym.sym == SDLK_r) {
                     printf("> Resetting camera position.\n");
 
                     translate_x = (WINDOW_WIDTH/2.0f)/pixels_per_meter;
                     translate_y = (WINDOW_HEIGHT/2.0f)/pixels_per_meter;
                 } else if (event.key.keysym.sym == SDLK_s) {
-					printf("> Saving current level.\n");
-
-					FILE* level_file = fopen("level.mgslevel", "w");
-					save_level(level_file, obstacles);
-					fclose(level_file);
+					// Shift+S saves in the binary format.
+					command.type = SIM_COMMAND_SAVE_LEVEL;
+					command.format = (SDL_GetModState() & KMOD_SHIFT) ? LEVEL_FORMAT_BINARY : LEVEL_FORMAT_TEXT;
+					send_sim_command(sim, command);
 				} else if (event.key.keysym.sym == SDLK_g) {
 					auto mod_state = SDL_GetModState();
 
 					if (mod_state & KMOD_SHIFT) {
-						display_occupancy_grid = !display_occupancy_grid;
+						display_occupancy_map = !display_occupancy_map;
 					} else {
 						display_grid = !display_grid;
 					}
+				} else if (event.key.keysym.sym == SDLK_c) {
+					command.type = SIM_COMMAND_CLEAR_OCCUPANCY;
+					send_sim_command(sim, command);
 				} else if (event.key.keysym.sym == SDLK_l) {
 					display_lidar = !display_lidar;
 				} else if (event.key.keysym.sym == SDLK_o) {
 					display_obstacles = !display_obstacles;
+				} else if (event.key.keysym.sym == SDLK_e) {
+					command.type = SIM_COMMAND_NEXT_ENGINE;
+					send_sim_command(sim, command);
+				} else if (event.key.keysym.sym == SDLK_f) {
+					printf("> Last frame took %.3f ms to submit, in %ld draw calls and %ld vertices, uploading %ld texels.\n", 1000.0 * frame_ticks / SDL_GetPerformanceFrequency(), renderer->draw_calls, renderer->vertex_count, renderer->texels_uploaded);
+				} else if (event.key.keysym.sym == SDLK_m) {
+					command.type = SIM_COMMAND_TOGGLE_PARALLEL;
+					send_sim_command(sim, command);
+				} else if (event.key.keysym.sym == SDLK_t) {
+					command.type = SIM_COMMAND_SWITCH_LIDAR_MODEL;
+					send_sim_command(sim, command);
+				} else if (event.key.keysym.sym == SDLK_p) {
+					command.type = SIM_COMMAND_TOGGLE_RECORDING;
+					send_sim_command(sim, command);
+				} else if (event.key.keysym.sym == SDLK_d) {
+					command.type = SIM_COMMAND_TOGGLE_DISTANCE_FIELD;
+					send_sim_command(sim, command);
 				} else if (event.key.keysym.sym == SDLK_UP) {
 					rover_speed = -ROVER_SPEED / 5.0f;
+					drive_changed = true;
 				} else if (event.key.keysym.sym == SDLK_DOWN) {
 					rover_speed = ROVER_SPEED / 5.0f;
+					drive_changed = true;
 				} else if (event.key.keysym.sym == SDLK_LEFT) {
 					rover_dangle = ROVER_SPEED;
+					drive_changed = true;
 				} else if (event.key.keysym.sym == SDLK_RIGHT) {
 					rover_dangle = -ROVER_SPEED;
+					drive_changed = true;
 				}
             }
 
 			if (event.type == SDL_KEYUP) {
 				if (event.key.keysym.sym == SDLK_UP) {
 					rover_speed = 0;
+					drive_changed = true;
 				} else if (event.key.keysym.sym == SDLK_DOWN) {
 					rover_speed = 0;
+					drive_changed = true;
 				} else if (event.key.keysym.sym == SDLK_LEFT) {
 					rover_dangle = 0;
+					drive_changed = true;
 				} else if (event.key.keysym.sym == SDLK_RIGHT) {
 					rover_dangle = 0;
+					drive_changed = true;
 				}
 			}
 
@@ -457,6 +316,16 @@ int main(int argc, char** argv) {
                     } else {
                         right_mouse_down = true;
                     }
+                } else if (event.button.button == SDL_BUTTON_MIDDLE) {
+                    int mx, my;
+                    SDL_GetMouseState(&mx, &my);
+
+                    float goal_x = mx / pixels_per_meter - translate_x;
+                    float goal_y = my / pixels_per_meter - translate_y;
+
+                    command.type = SIM_COMMAND_SET_GOAL;
+                    world_to_axial(&goal_x, &goal_y, 1, grid_size, &command.q, &command.r);
+                    send_sim_command(sim, command);
                 } else if (event.button.button == SDL_BUTTON_LEFT) {
                     dragging = true;
 
@@ -482,7 +351,9 @@ int main(int argc, char** argv) {
                     if (drag_obstacle.w < 1e-6 || drag_obstacle.h < 1e-6) {
                         printf("[!] Not adding an obstacle: too small!\n");
                     } else {
-                        obstacles.push_back(drag_obstacle);                        
+                        command.type = SIM_COMMAND_ADD_OBSTACLE;
+                        command.obstacle = drag_obstacle;
+                        send_sim_command(sim, command);
                     }
                 }
             }
@@ -510,9 +381,37 @@ int main(int argc, char** argv) {
 
         if (should_quit) break;
 
-		rover_angle += rover_dangle;
-		rover_x += rover_speed * cosf((rover_angle + 90) * M_PI / 180.0f);
-		rover_y += rover_speed * sinf((rover_angle + 90) * M_PI / 180.0f);
+        if (drive_changed) {
+            SimCommand command;
+            command.type = SIM_COMMAND_DRIVE;
+            command.speed = rover_speed;
+            command.dangle = rover_dangle;
+
+            send_sim_command(sim, command);
+        }
+
+        // Catch up with the simulation, if it has moved on since the last frame.
+        if (const SimState* latest = take_sim_state(sim)) {
+            state = latest;
+
+            apply_sim_changes(state->changes, state_step, occupancy_map, &hex_grid, &changed_hexes);
+            state_step = state->step;
+
+            // Only the hexes that changed need new colours.
+            update_render_grid(renderer, &hex_grid, changed_hexes.data(), (int)changed_hexes.size());
+            changed_hexes.clear();
+
+            if (state->world_version != obstacles_version) {
+                obstacles = *state->obstacles;
+                obstacles_version = state->world_version;
+
+                if (obstacle_grid) destroy_obstacle_grid(obstacle_grid);
+                obstacle_grid = create_obstacle_grid(obstacles, OBSTACLE_GRID_CELL_SIZE);
+            }
+        }
+
+        uint64_t frame_start = SDL_GetPerformanceCounter();
+        reset_render_stats(renderer);
 
         glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
@@ -523,6 +422,10 @@ int main(int argc, char** argv) {
         glScalef(pixels_per_meter, pixels_per_meter, 1.0f);
         glTranslatef(translate_x, translate_y, 0.0f);
 
+        // The part of the world on screen. Only what overlaps it gets drawn.
+        float view_min_x = -translate_x, view_min_y = -translate_y;
+        float view_max_x = WINDOW_WIDTH / pixels_per_meter - translate_x, view_max_y = WINDOW_HEIGHT / pixels_per_meter - translate_y;
+
         if (display_grid) {
             // Grid display.
             
@@ -531,59 +434,58 @@ int main(int argc, char** argv) {
 
             float line_thickness = 20.0f * ((pixels_per_meter - MIN_PPM) / (MAX_PPM - MIN_PPM)) + 2.0f;
 
-            render_grid(grid, line_thickness);
-            outline_origin(line_thickness);
+            render_grid(renderer, line_thickness, view_min_x / grid_size, view_min_y / grid_size, view_max_x / grid_size, view_max_y / grid_size, pixels_per_meter * grid_size);
 
             glPopMatrix();
         }
 
         if (dragging) {
-            render_obstacle(&drag_obstacle);
+            render_obstacles(renderer, &drag_obstacle, 1);
         }
 
-		if (display_obstacles) {
-			for (Obstacle obs : obstacles) {
-				render_obstacle(&obs);
-			}
+		if (display_obstacles && obstacle_grid) {
+			visible_obstacles.clear();
+			query_obstacle_grid(obstacle_grid, view_min_x, view_min_y, view_max_x, view_max_y, visible_obstacles);
+
+			render_obstacles(renderer, visible_obstacles.data(), (int)visible_obstacles.size());
 		}
 
+		RoverPose rover = state->rover;
 
-		if (display_lidar) render_lidar_range(rover_x, rover_y, rover_angle);
+		if (display_lidar) render_lidar_range(renderer, state->lidar_model, rover.x, rover.y, rover.angle);
 
-        render_rover(rover_x, rover_y, ROVER_WIDTH, ROVER_HEIGHT, rover_angle);
+        render_rover(renderer, rover.x, rover.y, ROVER_WIDTH, ROVER_HEIGHT, rover.angle);
 
-        lidar_scan(rover_x, rover_y, rover_angle, obstacles, lidar_points, 20.0f);
+		if (state->has_goal) {
+			glPushMatrix();
+			glScalef(grid_size, grid_size, 1.0f);
 
-		// Update the occupancy grid.
-		memset(occupancy_grid->data, 0, sizeof(int) * occupancy_grid->size * occupancy_grid->size);
+			render_hex_path(renderer, state->path, 4.0f);
 
-		for (int i = -45; i <= 225; i++) {
-			float distance = lidar_points[i + 45];
+			glPopMatrix();
+		}
 
-			if (distance <= 10.0f)  {
-				if (display_lidar) render_lidar_point(rover_x, rover_y, rover_angle, i, distance, pixels_per_meter);
+		if (display_lidar) render_lidar_points(renderer, state->lidar_model, rover.x, rover.y, rover.angle, state->ranges.data(), 10.0f, pixels_per_meter);
 
-				// Add to occupancy grid.
-				// First, get position-centric cartesian coordinates.
-				float lp_x = distance * cosf((float)i * M_PI / 180.0f);
-				float lp_y = distance * sinf((float)i * M_PI / 180.0f);
+		if (display_occupancy_map) render_occupancy_map(renderer, occupancy_map, view_min_x, view_min_y, view_max_x, view_max_y);
 
-				lp_x += occupancy_grid->side_size * (occupancy_grid->size / 2);
-				lp_y += occupancy_grid->side_size * (occupancy_grid->size / 2);
+        frame_ticks = SDL_GetPerformanceCounter() - frame_start;
 
-				// What grid cell?
+        SDL_GL_SwapWindow(window);
+    }
 
-				int gc_x = lp_x / occupancy_grid->side_size;
-				int gc_y = lp_y / occupancy_grid->side_size;
+    stop_simulation(sim);
 
-				occupancy_grid->data[gc_y * occupancy_grid->size + gc_x]++;
-			}
-		}
+    if (streamer) close_chunk_streamer(streamer);
 
-		if (display_occupancy_grid) render_occupancy_grid(occupancy_grid, rover_x, rover_y, rover_angle);
+    if (obstacle_grid) destroy_obstacle_grid(obstacle_grid);
 
-        SDL_GL_SwapWindow(window);
-    }
+    destroy_renderer(renderer);
+    destroy_occupancy_map(occupancy_map);
+    destroy_lidar_model(sim_lidar_model);
+    destroy_lidar_model(utm_lidar_model);
+    destroy_worker_pool(worker_pool);
+    destroy_world(world);
 
     SDL_DestroyWindow(window);
 
@@ -591,3 +493,5 @@ int main(int argc, char** argv) {
 
     return 0;
 }
+
+#endif
@@ -0,0 +1,22 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "memory.hpp"
+
+void* alloc_aligned(size_t size, size_t alignment) {
+    void* memory = NULL;
+
+    // posix_memalign doesn't like zero sized allocations on every platform.
+    if (size == 0) size = alignment;
+
+    if (posix_memalign(&memory, alignment, size) != 0) {
+        printf("[!] Failed to allocate %zu bytes.\n", size);
+        abort();
+    }
+
+    return memory;
+}
+
+void free_aligned(void* memory) {
+    free(memory);
+}
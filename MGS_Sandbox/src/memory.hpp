@@ -0,0 +1,15 @@
+/*
+    Small memory helpers shared by the containers that want SIMD friendly storage.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+// Cache line size, which is also enough alignment for any SIMD load we do.
+const size_t CACHE_LINE_SIZE = 64;
+
+// Allocates size bytes aligned to alignment (a power of two, at least sizeof(void*)). Free with free_aligned.
+void* alloc_aligned(size_t size, size_t alignment);
+
+void free_aligned(void* memory);
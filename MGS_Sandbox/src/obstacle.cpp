@@ -1,5 +1,6 @@
 #include <assert.h>
 #include <math.h>
+#include <string.h>
 
 #include "obstacle.hpp"
 
@@ -14,91 +15,115 @@ static bool line_line_collision(float a0x, float a0y, float a1x, float a1y, floa
 
     *out_intersection_x = a0x + (u0 * (a1x - a0x));
     *out_intersection_y = a0y + (u0 * (a1y - a0y));
-    
+
     return true;
 }
 
-void lidar_scan(float x, float y, float angle, std::vector<Obstacle>& obstacles, float out_points[271], float max_scan_distance) {
-    for (int i = -45; i <= 225; i++) {
-        float theta = ((float)i + angle) * M_PI / 180.0f;
+void ray_obstacle_collision(float x, float y, float x1, float y1, const Obstacle& obs, float* min_sq) {
+    float isect_x, isect_y, isect0_x = NAN, isect0_y = NAN, isect1_x = NAN, isect1_y = NAN;
+
+    // Top.
+    if (line_line_collision(x, y, x1, y1, obs.x - obs.w/2.0f, obs.y - obs.h/2.0f, obs.x + obs.w/2.0f, obs.y - obs.h/2.0f, &isect_x, &isect_y)) {
+        if (isnan(isect0_x)) {
+            isect0_x = isect_x;
+            isect0_y = isect_y;
+        } else {
+            isect1_x = isect_x;
+            isect1_y = isect_y;
+        }
+    }
 
-        float x1 = max_scan_distance * cosf(theta);
-        float y1 = max_scan_distance * sinf(theta);
+    // Right.
+    if (line_line_collision(x, y, x1, y1, obs.x + obs.w/2.0f, obs.y - obs.h/2.0f, obs.x + obs.w/2.0f, obs.y + obs.h/2.0f, &isect_x, &isect_y)) {
+        if (isnan(isect0_x)) {
+            isect0_x = isect_x;
+            isect0_y = isect_y;
+        } else {
+            isect1_x = isect_x;
+            isect1_y = isect_y;
+        }
+    }
 
-        float min_sq = max_scan_distance * max_scan_distance;
+    // Bottom.
+    if (line_line_collision(x, y, x1, y1, obs.x + obs.w/2.0f, obs.y + obs.h/2.0f, obs.x - obs.w/2.0f, obs.y + obs.h/2.0f, &isect_x, &isect_y)) {
+        if (isnan(isect0_x)) {
+            isect0_x = isect_x;
+            isect0_y = isect_y;
+        } else {
+            isect1_x = isect_x;
+            isect1_y = isect_y;
+        }
+    }
 
-        for (Obstacle obs : obstacles) {
-            float isect_x, isect_y, isect0_x = NAN, isect0_y = NAN, isect1_x = NAN, isect1_y = NAN;
-
-            // Top.
-            if (line_line_collision(x, y, x1, y1, obs.x - obs.w/2.0f, obs.y - obs.h/2.0f, obs.x + obs.w/2.0f, obs.y - obs.h/2.0f, &isect_x, &isect_y)) {
-                if (isnan(isect0_x)) {
-                    isect0_x = isect_x;
-                    isect0_y = isect_y;
-                } else {
-                    isect1_x = isect_x;
-                    isect1_y = isect_y;
-                }
-            }
+    // Left.
+    if (line_line_collision(x, y, x1, y1, obs.x - obs.w/2.0f, obs.y + obs.h/2.0f, obs.x - obs.w/2.0f, obs.y - obs.h/2.0f, &isect_x, &isect_y)) {
+        if (isnan(isect0_x)) {
+            isect0_x = isect_x;
+            isect0_y = isect_y;
+        } else {
+            isect1_x = isect_x;
+            isect1_y = isect_y;
+        }
+    }
 
-            // Right.
-            if (line_line_collision(x, y, x1, y1, obs.x + obs.w/2.0f, obs.y - obs.h/2.0f, obs.x + obs.w/2.0f, obs.y + obs.h/2.0f, &isect_x, &isect_y)) {
-                if (isnan(isect0_x)) {
-                    isect0_x = isect_x;
-                    isect0_y = isect_y;
-                } else {
-                    isect1_x = isect_x;
-                    isect1_y = isect_y;
-                }
-            }
+    if (!isnan(isect0_x)) {
+        assert(!isnan(isect0_x) && !isnan(isect0_y)); // isect1 could be NAN still if the rectangle went beyond the max scan distance.
 
-            // Bottom.
-            if (line_line_collision(x, y, x1, y1, obs.x + obs.w/2.0f, obs.y + obs.h/2.0f, obs.x - obs.w/2.0f, obs.y + obs.h/2.0f, &isect_x, &isect_y)) {
-                if (isnan(isect0_x)) {
-                    isect0_x = isect_x;
-                    isect0_y = isect_y;
-                } else {
-                    isect1_x = isect_x;
-                    isect1_y = isect_y;
-                }
-            }
+        if (isnan(isect1_x)) {
+            float d0_sq = (x - isect0_x)*(x - isect0_x) + (y - isect0_y)*(y - isect0_y);
 
-            // Left.
-            if (line_line_collision(x, y, x1, y1, obs.x - obs.w/2.0f, obs.y + obs.h/2.0f, obs.x - obs.w/2.0f, obs.y - obs.h/2.0f, &isect_x, &isect_y)) {
-                if (isnan(isect0_x)) {
-                    isect0_x = isect_x;
-                    isect0_y = isect_y;
-                } else {
-                    isect1_x = isect_x;
-                    isect1_y = isect_y;
-                }
-            }
+            assert(d0_sq >= 0);
 
-			if (!isnan(isect0_x)) {
-                assert(!isnan(isect0_x) && !isnan(isect0_y)); // isect1 could be NAN still if the rectangle went beyond the max scan distance.
+            if (d0_sq < *min_sq) *min_sq = d0_sq;
+        } else {
+            float d0_sq = (x - isect0_x)*(x - isect0_x) + (y - isect0_y)*(y - isect0_y);
+            float d1_sq = (x - isect1_x)*(x - isect1_x) + (y - isect1_y)*(y - isect1_y);
 
-				if (isnan(isect1_x)) {
-					float d0_sq = (x - isect0_x)*(x - isect0_x) + (y - isect0_y)*(y - isect0_y);
+            assert(d0_sq >= 0);
+            assert(d1_sq >= 0);
 
-					assert(d0_sq >= 0);
+            if (d0_sq < d1_sq) {
+                if (d0_sq < *min_sq) *min_sq = d0_sq;
+            } else {
+                if (d1_sq < *min_sq) *min_sq = d1_sq;
+            }
+        }
+    }
+}
 
-					if (d0_sq < min_sq) min_sq = d0_sq;
-				} else {
-					float d0_sq = (x - isect0_x)*(x - isect0_x) + (y - isect0_y)*(y - isect0_y);
-					float d1_sq = (x - isect1_x)*(x - isect1_x) + (y - isect1_y)*(y - isect1_y);
+void lidar_scan(float x, float y, const float* dir_x, const float* dir_y, int count, std::vector<Obstacle>& obstacles, float* out_ranges, float max_scan_distance) {
+    for (int i = 0; i < count; i++) {
+        float x1 = x + max_scan_distance * dir_x[i];
+        float y1 = y + max_scan_distance * dir_y[i];
 
-					assert(d0_sq >= 0);
-					assert(d1_sq >= 0);
+        float min_sq = max_scan_distance * max_scan_distance;
 
-					if (d0_sq < d1_sq) {
-						if (d0_sq < min_sq) min_sq = d0_sq;
-					} else {
-						if (d1_sq < min_sq) min_sq = d1_sq;
-					}
-				}
-            }
+        for (Obstacle obs : obstacles) {
+            ray_obstacle_collision(x, y, x1, y1, obs, &min_sq);
         }
 
-        out_points[i + 45] = sqrtf(min_sq);
+        out_ranges[i] = sqrtf(min_sq);
     }
 }
+
+const char* lidar_engine_name(LidarEngine engine) {
+    switch (engine) {
+        case LIDAR_ENGINE_BRUTE_FORCE: return "brute-force";
+        case LIDAR_ENGINE_GRID: return "grid";
+        case LIDAR_ENGINE_SIMD: return "simd";
+        case LIDAR_ENGINE_POLAR: return "polar";
+        case LIDAR_ENGINE_SDF: return "sdf";
+        default: return "unknown";
+    }
+}
+
+bool parse_lidar_engine(const char* name, LidarEngine* out_engine) {
+    for (int i = 0; i < LIDAR_ENGINE_COUNT; i++) {
+        if (strcmp(name, lidar_engine_name((LidarEngine)i)) == 0) {
+            *out_engine = (LidarEngine)i;
+            return true;
+        }
+    }
+
+    return false;
+}
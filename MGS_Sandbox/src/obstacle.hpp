@@ -1,3 +1,5 @@
+#pragma once
+
 #include <vector>
 
 struct Obstacle {
@@ -5,4 +7,29 @@ struct Obstacle {
     float x, y, w, h;
 };
 
-void lidar_scan(float x, float y, float angle, std::vector<Obstacle>& obstacles, float out_points[271], float max_scan_distance);
\ No newline at end of file
+// Selects how rays are intersected with the obstacles. Every engine returns the same ranges (up to rounding), so this
+// is mostly useful for comparing their speed.
+enum LidarEngine {
+    LIDAR_ENGINE_BRUTE_FORCE, // Every ray against every obstacle.
+    LIDAR_ENGINE_GRID,        // Rays walk an ObstacleGrid and only test the obstacles in the cells they cross.
+    LIDAR_ENGINE_SIMD,        // Every ray against every obstacle, many obstacles at a time, using an ObstacleSet.
+    LIDAR_ENGINE_POLAR,       // Every obstacle against only the rays that point at it (see polar_scan.hpp).
+    LIDAR_ENGINE_SDF,         // Rays sphere traced through a DistanceField, finished against the obstacles nearby.
+
+    LIDAR_ENGINE_COUNT
+};
+
+const char* lidar_engine_name(LidarEngine engine);
+
+// The inverse of lidar_engine_name. Returns false if no engine has that name.
+bool parse_lidar_engine(const char* name, LidarEngine* out_engine);
+
+// Intersects the segment (x, y) -> (x1, y1) with the four edges of the obstacle.
+// If the nearest intersection is closer than sqrt(*min_sq), *min_sq is replaced with its squared distance from (x, y).
+void ray_obstacle_collision(float x, float y, float x1, float y1, const Obstacle& obs, float* min_sq);
+
+// Scans count rays from (x, y), ray i pointing along (dir_x[i], dir_y[i]) (a unit vector), and writes the distance to
+// the nearest obstacle along it (or max_scan_distance if there's nothing in range) to out_ranges[i].
+// A ray's range doesn't depend on which other rays are in the same call, so a scan can be split up across threads.
+// The other engines work the same way.
+void lidar_scan(float x, float y, const float* dir_x, const float* dir_y, int count, std::vector<Obstacle>& obstacles, float* out_ranges, float max_scan_distance);
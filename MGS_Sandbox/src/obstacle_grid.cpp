@@ -0,0 +1,247 @@
+#include <math.h>
+#include <stdint.h>
+
+#include "obstacle_grid.hpp"
+
+// Cell range covered by a rectangle, clamped to the grid.
+static void rect_cells(ObstacleGrid* grid, float min_x, float min_y, float max_x, float max_y, int* cx0, int* cy0, int* cx1, int* cy1) {
+    *cx0 = (int)floorf((min_x - grid->min_x) / grid->cell_size);
+    *cy0 = (int)floorf((min_y - grid->min_y) / grid->cell_size);
+    *cx1 = (int)floorf((max_x - grid->min_x) / grid->cell_size);
+    *cy1 = (int)floorf((max_y - grid->min_y) / grid->cell_size);
+
+    if (*cx0 < 0) *cx0 = 0;
+    if (*cy0 < 0) *cy0 = 0;
+    if (*cx1 > grid->width - 1) *cx1 = grid->width - 1;
+    if (*cy1 > grid->height - 1) *cy1 = grid->height - 1;
+}
+
+// Cell range covered by an obstacle, clamped to the grid.
+static void obstacle_cells(ObstacleGrid* grid, const Obstacle& obs, int* cx0, int* cy0, int* cx1, int* cy1) {
+    rect_cells(grid, obs.x - obs.w/2.0f, obs.y - obs.h/2.0f, obs.x + obs.w/2.0f, obs.y + obs.h/2.0f, cx0, cy0, cx1, cy1);
+}
+
+ObstacleGrid* create_obstacle_grid(std::vector<Obstacle>& obstacles, float cell_size) {
+    ObstacleGrid* grid = new ObstacleGrid;
+
+    grid->min_x = grid->min_y = 0;
+    grid->cell_size = cell_size;
+    grid->width = grid->height = 0;
+
+    if (obstacles.size() == 0) {
+        grid->cell_start.push_back(0);
+        return grid;
+    }
+
+    float max_x = -INFINITY, max_y = -INFINITY;
+    grid->min_x = INFINITY;
+    grid->min_y = INFINITY;
+
+    for (Obstacle obs : obstacles) {
+        grid->min_x = fminf(grid->min_x, obs.x - obs.w/2.0f);
+        grid->min_y = fminf(grid->min_y, obs.y - obs.h/2.0f);
+        max_x = fmaxf(max_x, obs.x + obs.w/2.0f);
+        max_y = fmaxf(max_y, obs.y + obs.h/2.0f);
+    }
+
+    // Aim for a few cells per obstacle at most.
+    int64_t max_cells = 4 * (int64_t)obstacles.size();
+    if (max_cells < 1024) max_cells = 1024;
+
+    for (;;) {
+        grid->width = (int)floorf((max_x - grid->min_x) / grid->cell_size) + 1;
+        grid->height = (int)floorf((max_y - grid->min_y) / grid->cell_size) + 1;
+
+        if ((int64_t)grid->width * grid->height <= max_cells) break;
+
+        grid->cell_size *= 2.0f;
+    }
+
+    int cell_count = grid->width * grid->height;
+
+    // Counting sort: count how many obstacles land in each cell, turn the counts into start offsets, then drop the
+    // obstacles into place.
+    grid->cell_start.assign(cell_count + 1, 0);
+
+    for (Obstacle obs : obstacles) {
+        int cx0, cy0, cx1, cy1;
+        obstacle_cells(grid, obs, &cx0, &cy0, &cx1, &cy1);
+
+        for (int cy = cy0; cy <= cy1; cy++) {
+            for (int cx = cx0; cx <= cx1; cx++) {
+                grid->cell_start[cy * grid->width + cx + 1]++;
+            }
+        }
+    }
+
+    for (int i = 0; i < cell_count; i++) {
+        grid->cell_start[i + 1] += grid->cell_start[i];
+    }
+
+    grid->cell_obstacles.resize(grid->cell_start[cell_count]);
+
+    std::vector<int> fill(grid->cell_start.begin(), grid->cell_start.end() - 1);
+
+    for (Obstacle obs : obstacles) {
+        int cx0, cy0, cx1, cy1;
+        obstacle_cells(grid, obs, &cx0, &cy0, &cx1, &cy1);
+
+        for (int cy = cy0; cy <= cy1; cy++) {
+            for (int cx = cx0; cx <= cx1; cx++) {
+                grid->cell_obstacles[fill[cy * grid->width + cx]++] = obs;
+            }
+        }
+    }
+
+    return grid;
+}
+
+void destroy_obstacle_grid(ObstacleGrid* grid) {
+    delete grid;
+}
+
+// Appends the obstacles overlapping the rectangle to out, looking only at the cells it covers.
+void query_obstacle_grid(ObstacleGrid* grid, float min_x, float min_y, float max_x, float max_y, std::vector<Obstacle>& out) {
+    if (grid->width == 0) return;
+
+    int qx0, qy0, qx1, qy1;
+    rect_cells(grid, min_x, min_y, max_x, max_y, &qx0, &qy0, &qx1, &qy1);
+
+    for (int cy = qy0; cy <= qy1; cy++) {
+        for (int cx = qx0; cx <= qx1; cx++) {
+            int i = cy * grid->width + cx;
+
+            for (int j = grid->cell_start[i]; j < grid->cell_start[i + 1]; j++) {
+                const Obstacle& obs = grid->cell_obstacles[j];
+
+                if (obs.x + obs.w/2.0f < min_x || obs.x - obs.w/2.0f > max_x) continue;
+                if (obs.y + obs.h/2.0f < min_y || obs.y - obs.h/2.0f > max_y) continue;
+
+                // An obstacle is copied into every cell it overlaps, so only report it from the first of those the
+                // query covers.
+                int ox0, oy0, ox1, oy1;
+                obstacle_cells(grid, obs, &ox0, &oy0, &ox1, &oy1);
+
+                if (cx != (ox0 > qx0 ? ox0 : qx0) || cy != (oy0 > qy0 ? oy0 : qy0)) continue;
+
+                out.push_back(obs);
+            }
+        }
+    }
+}
+
+void ray_obstacle_grid_rect_collision(ObstacleGrid* grid, float min_x, float min_y, float max_x, float max_y, float x, float y, float x1, float y1, float* min_sq) {
+    if (grid->width == 0) return;
+
+    int cx0, cy0, cx1, cy1;
+    rect_cells(grid, min_x, min_y, max_x, max_y, &cx0, &cy0, &cx1, &cy1);
+
+    for (int cy = cy0; cy <= cy1; cy++) {
+        for (int cx = cx0; cx <= cx1; cx++) {
+            int i = cy * grid->width + cx;
+
+            for (int j = grid->cell_start[i]; j < grid->cell_start[i + 1]; j++) {
+                ray_obstacle_collision(x, y, x1, y1, grid->cell_obstacles[j], min_sq);
+            }
+        }
+    }
+}
+
+// Walks the cells crossed by the ray from (x, y) in direction (dx, dy) (a unit vector) up to max_scan_distance,
+// and returns the squared distance to the nearest hit (or max_scan_distance squared if nothing was hit).
+static float grid_ray_min_sq(ObstacleGrid* grid, float x, float y, float dx, float dy, float max_scan_distance) {
+    float x1 = x + max_scan_distance * dx;
+    float y1 = y + max_scan_distance * dy;
+
+    float min_sq = max_scan_distance * max_scan_distance;
+
+    if (grid->width == 0) return min_sq;
+
+    // Clip the ray to the grid bounds.
+    float t0 = 0, t1 = max_scan_distance;
+
+    float lo[2] = { grid->min_x, grid->min_y };
+    float hi[2] = { grid->min_x + grid->width * grid->cell_size, grid->min_y + grid->height * grid->cell_size };
+    float o[2] = { x, y };
+    float d[2] = { dx, dy };
+
+    for (int axis = 0; axis < 2; axis++) {
+        if (d[axis] == 0.0f) {
+            if (o[axis] < lo[axis] || o[axis] > hi[axis]) return min_sq;
+            continue;
+        }
+
+        float ta = (lo[axis] - o[axis]) / d[axis];
+        float tb = (hi[axis] - o[axis]) / d[axis];
+
+        if (ta > tb) {
+            float tmp = ta;
+            ta = tb;
+            tb = tmp;
+        }
+
+        if (ta > t0) t0 = ta;
+        if (tb < t1) t1 = tb;
+    }
+
+    if (t0 > t1) return min_sq;
+
+    int cx = (int)floorf((x + t0 * dx - grid->min_x) / grid->cell_size);
+    int cy = (int)floorf((y + t0 * dy - grid->min_y) / grid->cell_size);
+
+    if (cx < 0) cx = 0;
+    if (cy < 0) cy = 0;
+    if (cx > grid->width - 1) cx = grid->width - 1;
+    if (cy > grid->height - 1) cy = grid->height - 1;
+
+    int step_x = dx > 0 ? 1 : -1;
+    int step_y = dy > 0 ? 1 : -1;
+
+    // Distance along the ray at which the next vertical/horizontal cell boundary is crossed, and the distance
+    // between consecutive boundaries.
+    float t_max_x = INFINITY, t_max_y = INFINITY;
+    float t_delta_x = INFINITY, t_delta_y = INFINITY;
+
+    if (dx != 0.0f) {
+        float boundary = grid->min_x + (cx + (dx > 0 ? 1 : 0)) * grid->cell_size;
+        t_max_x = (boundary - x) / dx;
+        t_delta_x = grid->cell_size / fabsf(dx);
+    }
+
+    if (dy != 0.0f) {
+        float boundary = grid->min_y + (cy + (dy > 0 ? 1 : 0)) * grid->cell_size;
+        t_max_y = (boundary - y) / dy;
+        t_delta_y = grid->cell_size / fabsf(dy);
+    }
+
+    for (;;) {
+        int cell = cy * grid->width + cx;
+
+        for (int i = grid->cell_start[cell]; i < grid->cell_start[cell + 1]; i++) {
+            ray_obstacle_collision(x, y, x1, y1, grid->cell_obstacles[i], &min_sq);
+        }
+
+        float t_exit = fminf(t_max_x, t_max_y);
+
+        // Anything in the cells further along is at least t_exit away.
+        if (t_exit >= t1 || min_sq <= t_exit * t_exit) break;
+
+        if (t_max_x < t_max_y) {
+            cx += step_x;
+            if (cx < 0 || cx >= grid->width) break;
+            t_max_x += t_delta_x;
+        } else {
+            cy += step_y;
+            if (cy < 0 || cy >= grid->height) break;
+            t_max_y += t_delta_y;
+        }
+    }
+
+    return min_sq;
+}
+
+void lidar_scan_grid(float x, float y, const float* dir_x, const float* dir_y, int count, ObstacleGrid* grid, float* out_ranges, float max_scan_distance) {
+    for (int i = 0; i < count; i++) {
+        out_ranges[i] = sqrtf(grid_ray_min_sq(grid, x, y, dir_x[i], dir_y[i], max_scan_distance));
+    }
+}
@@ -0,0 +1,47 @@
+/*
+    A uniform grid over the obstacles, used to speed up lidar_scan.
+
+    Every cell stores a copy of each obstacle that overlaps it, so a ray only has to look at the cells it passes
+    through. The cells are walked in order along the ray (Amanatides and Woo, "A Fast Voxel Traversal Algorithm for
+    Ray Tracing"), which means the walk can stop as soon as a hit is closer than the far side of the current cell.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "obstacle.hpp"
+
+struct ObstacleGrid {
+    // World position of the corner of cell (0, 0).
+    float min_x, min_y;
+
+    float cell_size;
+
+    int width, height;
+
+    // The obstacles overlapping cell (cx, cy) are cell_obstacles[cell_start[i]] up to (but not including)
+    // cell_obstacles[cell_start[i + 1]], where i = cy * width + cx.
+    std::vector<int> cell_start;
+    std::vector<Obstacle> cell_obstacles;
+};
+
+// Builds a grid over the obstacles. cell_size is in meters, and gets doubled until the grid has a sensible number
+// of cells for the amount of obstacles (so a handful of obstacles spread over a huge level doesn't make a huge grid).
+// The grid holds copies of the obstacles, so it has to be rebuilt whenever they change.
+ObstacleGrid* create_obstacle_grid(std::vector<Obstacle>& obstacles, float cell_size);
+
+void destroy_obstacle_grid(ObstacleGrid* grid);
+
+// Appends every obstacle overlapping the rectangle from (min_x, min_y) to (max_x, max_y) to out, once each, by only
+// looking at the cells the rectangle covers.
+void query_obstacle_grid(ObstacleGrid* grid, float min_x, float min_y, float max_x, float max_y, std::vector<Obstacle>& out);
+
+// Runs ray_obstacle_collision(x, y, x1, y1, obs, min_sq) on every obstacle in the cells the rectangle from
+// (min_x, min_y) to (max_x, max_y) covers, so *min_sq ends up the same as testing every obstacle overlapping it (and
+// maybe some more), in whatever order. Obstacles in several of the cells are tested more than once, which doesn't
+// change the result.
+void ray_obstacle_grid_rect_collision(ObstacleGrid* grid, float min_x, float min_y, float max_x, float max_y, float x, float y, float x1, float y1, float* min_sq);
+
+// Same as lidar_scan, but only tests the obstacles in the grid cells each ray crosses.
+void lidar_scan_grid(float x, float y, const float* dir_x, const float* dir_y, int count, ObstacleGrid* grid, float* out_ranges, float max_scan_distance);
@@ -0,0 +1,226 @@
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define OBSTACLE_SET_X86 1
+#include <immintrin.h>
+#endif
+
+#include "memory.hpp"
+#include "obstacle_set.hpp"
+
+ObstacleSet* create_obstacle_set(std::vector<Obstacle>& obstacles) {
+    ObstacleSet* set = new ObstacleSet;
+
+    set->count = (int)obstacles.size();
+    set->padded_count = (set->count + OBSTACLE_SET_PADDING - 1) / OBSTACLE_SET_PADDING * OBSTACLE_SET_PADDING;
+
+    size_t bytes = sizeof(float) * set->padded_count;
+
+    set->x = (float*)alloc_aligned(bytes, CACHE_LINE_SIZE);
+    set->y = (float*)alloc_aligned(bytes, CACHE_LINE_SIZE);
+    set->w = (float*)alloc_aligned(bytes, CACHE_LINE_SIZE);
+    set->h = (float*)alloc_aligned(bytes, CACHE_LINE_SIZE);
+
+    for (int i = 0; i < set->padded_count; i++) {
+        if (i < set->count) {
+            set->x[i] = obstacles[i].x;
+            set->y[i] = obstacles[i].y;
+            set->w[i] = obstacles[i].w;
+            set->h[i] = obstacles[i].h;
+        } else {
+            // Far enough away that any hit is way past the scan distance.
+            set->x[i] = 1e30f;
+            set->y[i] = 1e30f;
+            set->w[i] = 0;
+            set->h[i] = 0;
+        }
+    }
+
+    return set;
+}
+
+void destroy_obstacle_set(ObstacleSet* set) {
+    free_aligned(set->x);
+    free_aligned(set->y);
+    free_aligned(set->w);
+    free_aligned(set->h);
+
+    delete set;
+}
+
+// These match what minps/maxps do (including which operand wins on a tie), so the scalar kernel gives exactly the
+// same answers as the vector ones.
+static inline float slab_min(float a, float b) { return a < b ? a : b; }
+static inline float slab_max(float a, float b) { return a > b ? a : b; }
+
+static float kernel_scalar(ObstacleSet* set, float x, float y, float inv_dx, float inv_dy) {
+    float best = INFINITY;
+
+    for (int i = 0; i < set->padded_count; i++) {
+        float hw = 0.5f * set->w[i];
+        float hh = 0.5f * set->h[i];
+
+        float tx0 = ((set->x[i] - hw) - x) * inv_dx;
+        float tx1 = ((set->x[i] + hw) - x) * inv_dx;
+        float ty0 = ((set->y[i] - hh) - y) * inv_dy;
+        float ty1 = ((set->y[i] + hh) - y) * inv_dy;
+
+        float t_near = slab_max(slab_min(tx0, tx1), slab_min(ty0, ty1));
+        float t_far = slab_min(slab_max(tx0, tx1), slab_max(ty0, ty1));
+
+        // Starting inside the box means the hit is where the ray leaves it.
+        float t = t_near >= 0 ? t_near : t_far;
+
+        if (t_far >= t_near && t_far >= 0) best = slab_min(best, t);
+    }
+
+    return best;
+}
+
+#ifdef OBSTACLE_SET_X86
+
+static inline __m128 slab_sse(const float* bx, const float* by, const float* bw, const float* bh, __m128 x, __m128 y, __m128 inv_dx, __m128 inv_dy, __m128 best) {
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 inf = _mm_set1_ps(INFINITY);
+
+    __m128 hw = _mm_mul_ps(half, _mm_load_ps(bw));
+    __m128 hh = _mm_mul_ps(half, _mm_load_ps(bh));
+    __m128 cx = _mm_load_ps(bx);
+    __m128 cy = _mm_load_ps(by);
+
+    __m128 tx0 = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(cx, hw), x), inv_dx);
+    __m128 tx1 = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(cx, hw), x), inv_dx);
+    __m128 ty0 = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(cy, hh), y), inv_dy);
+    __m128 ty1 = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(cy, hh), y), inv_dy);
+
+    __m128 t_near = _mm_max_ps(_mm_min_ps(tx0, tx1), _mm_min_ps(ty0, ty1));
+    __m128 t_far = _mm_min_ps(_mm_max_ps(tx0, tx1), _mm_max_ps(ty0, ty1));
+
+    __m128 inside = _mm_cmpge_ps(t_near, zero);
+    __m128 t = _mm_or_ps(_mm_and_ps(inside, t_near), _mm_andnot_ps(inside, t_far));
+
+    __m128 hit = _mm_and_ps(_mm_cmpge_ps(t_far, t_near), _mm_cmpge_ps(t_far, zero));
+    t = _mm_or_ps(_mm_and_ps(hit, t), _mm_andnot_ps(hit, inf));
+
+    return _mm_min_ps(best, t);
+}
+
+static float kernel_sse(ObstacleSet* set, float x, float y, float inv_dx, float inv_dy) {
+    __m128 vx = _mm_set1_ps(x);
+    __m128 vy = _mm_set1_ps(y);
+    __m128 vinv_dx = _mm_set1_ps(inv_dx);
+    __m128 vinv_dy = _mm_set1_ps(inv_dy);
+
+    // Two independent accumulators to keep the min chains from serialising.
+    __m128 best0 = _mm_set1_ps(INFINITY);
+    __m128 best1 = best0;
+
+    for (int i = 0; i < set->padded_count; i += 8) {
+        best0 = slab_sse(set->x + i, set->y + i, set->w + i, set->h + i, vx, vy, vinv_dx, vinv_dy, best0);
+        best1 = slab_sse(set->x + i + 4, set->y + i + 4, set->w + i + 4, set->h + i + 4, vx, vy, vinv_dx, vinv_dy, best1);
+    }
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, _mm_min_ps(best0, best1));
+
+    return slab_min(slab_min(lanes[0], lanes[1]), slab_min(lanes[2], lanes[3]));
+}
+
+__attribute__((target("avx2")))
+static inline __m256 slab_avx2(const float* bx, const float* by, const float* bw, const float* bh, __m256 x, __m256 y, __m256 inv_dx, __m256 inv_dy, __m256 best) {
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 inf = _mm256_set1_ps(INFINITY);
+
+    __m256 hw = _mm256_mul_ps(half, _mm256_load_ps(bw));
+    __m256 hh = _mm256_mul_ps(half, _mm256_load_ps(bh));
+    __m256 cx = _mm256_load_ps(bx);
+    __m256 cy = _mm256_load_ps(by);
+
+    __m256 tx0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_sub_ps(cx, hw), x), inv_dx);
+    __m256 tx1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_add_ps(cx, hw), x), inv_dx);
+    __m256 ty0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_sub_ps(cy, hh), y), inv_dy);
+    __m256 ty1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_add_ps(cy, hh), y), inv_dy);
+
+    __m256 t_near = _mm256_max_ps(_mm256_min_ps(tx0, tx1), _mm256_min_ps(ty0, ty1));
+    __m256 t_far = _mm256_min_ps(_mm256_max_ps(tx0, tx1), _mm256_max_ps(ty0, ty1));
+
+    __m256 t = _mm256_blendv_ps(t_far, t_near, _mm256_cmp_ps(t_near, zero, _CMP_GE_OQ));
+
+    __m256 hit = _mm256_and_ps(_mm256_cmp_ps(t_far, t_near, _CMP_GE_OQ), _mm256_cmp_ps(t_far, zero, _CMP_GE_OQ));
+    t = _mm256_blendv_ps(inf, t, hit);
+
+    return _mm256_min_ps(best, t);
+}
+
+__attribute__((target("avx2")))
+static float kernel_avx2(ObstacleSet* set, float x, float y, float inv_dx, float inv_dy) {
+    __m256 vx = _mm256_set1_ps(x);
+    __m256 vy = _mm256_set1_ps(y);
+    __m256 vinv_dx = _mm256_set1_ps(inv_dx);
+    __m256 vinv_dy = _mm256_set1_ps(inv_dy);
+
+    __m256 best0 = _mm256_set1_ps(INFINITY);
+    __m256 best1 = best0;
+
+    for (int i = 0; i < set->padded_count; i += 16) {
+        best0 = slab_avx2(set->x + i, set->y + i, set->w + i, set->h + i, vx, vy, vinv_dx, vinv_dy, best0);
+        best1 = slab_avx2(set->x + i + 8, set->y + i + 8, set->w + i + 8, set->h + i + 8, vx, vy, vinv_dx, vinv_dy, best1);
+    }
+
+    __m256 best = _mm256_min_ps(best0, best1);
+    __m128 best4 = _mm_min_ps(_mm256_castps256_ps128(best), _mm256_extractf128_ps(best, 1));
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, best4);
+
+    return slab_min(slab_min(lanes[0], lanes[1]), slab_min(lanes[2], lanes[3]));
+}
+
+#endif
+
+ObstacleSetKernel obstacle_set_kernel() {
+#ifdef OBSTACLE_SET_X86
+    static ObstacleSetKernel kernel = __builtin_cpu_supports("avx2") ? OBSTACLE_SET_KERNEL_AVX2 :
+                                      __builtin_cpu_supports("sse2") ? OBSTACLE_SET_KERNEL_SSE : OBSTACLE_SET_KERNEL_SCALAR;
+    return kernel;
+#else
+    return OBSTACLE_SET_KERNEL_SCALAR;
+#endif
+}
+
+const char* obstacle_set_kernel_name(ObstacleSetKernel kernel) {
+    switch (kernel) {
+        case OBSTACLE_SET_KERNEL_SCALAR: return "scalar";
+        case OBSTACLE_SET_KERNEL_SSE: return "SSE";
+        case OBSTACLE_SET_KERNEL_AVX2: return "AVX2";
+        default: return "unknown";
+    }
+}
+
+float ray_obstacle_set_distance(ObstacleSet* set, float x, float y, float dx, float dy, float max_scan_distance) {
+    // Keep the inverse direction finite, so a ray starting exactly on a box edge can't produce 0 * inf = NaN.
+    const float MIN_COMPONENT = 1e-20f;
+
+    float inv_dx = 1.0f / (fabsf(dx) < MIN_COMPONENT ? copysignf(MIN_COMPONENT, dx) : dx);
+    float inv_dy = 1.0f / (fabsf(dy) < MIN_COMPONENT ? copysignf(MIN_COMPONENT, dy) : dy);
+
+    float best;
+
+    switch (obstacle_set_kernel()) {
+#ifdef OBSTACLE_SET_X86
+        case OBSTACLE_SET_KERNEL_AVX2: best = kernel_avx2(set, x, y, inv_dx, inv_dy); break;
+        case OBSTACLE_SET_KERNEL_SSE: best = kernel_sse(set, x, y, inv_dx, inv_dy); break;
+#endif
+        default: best = kernel_scalar(set, x, y, inv_dx, inv_dy); break;
+    }
+
+    return slab_min(best, max_scan_distance);
+}
+
+void lidar_scan_simd(float x, float y, const float* dir_x, const float* dir_y, int count, ObstacleSet* set, float* out_ranges, float max_scan_distance) {
+    for (int i = 0; i < count; i++) {
+        out_ranges[i] = ray_obstacle_set_distance(set, x, y, dir_x[i], dir_y[i], max_scan_distance);
+    }
+}
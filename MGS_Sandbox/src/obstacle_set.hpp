@@ -0,0 +1,53 @@
+/*
+    Structure-of-arrays copy of the obstacles, for intersecting rays with many of them at once.
+
+    Rays are tested against the obstacles with the slab test (the ray is clipped against the x and y extents of each
+    box in turn), which only needs a few multiplies and min/maxes per box and vectorises cleanly. The kernel that gets
+    used is picked at runtime from what the CPU supports: AVX2 (16 boxes per iteration), SSE (8 boxes per iteration)
+    or plain scalar code. All of them produce bit-identical results.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "obstacle.hpp"
+
+// Everything is padded out to a multiple of this many obstacles, so the kernels never need a remainder loop.
+const int OBSTACLE_SET_PADDING = 16;
+
+struct ObstacleSet {
+    int count;
+
+    // count rounded up to OBSTACLE_SET_PADDING. The padding obstacles are empty and far away, so they are never hit.
+    int padded_count;
+
+    // Each array is padded_count long and cache line aligned.
+    float* x;
+    float* y;
+    float* w;
+    float* h;
+};
+
+ObstacleSet* create_obstacle_set(std::vector<Obstacle>& obstacles);
+
+void destroy_obstacle_set(ObstacleSet* set);
+
+enum ObstacleSetKernel {
+    OBSTACLE_SET_KERNEL_SCALAR,
+    OBSTACLE_SET_KERNEL_SSE,
+    OBSTACLE_SET_KERNEL_AVX2
+};
+
+// Which kernel ray_obstacle_set_distance uses on this machine.
+ObstacleSetKernel obstacle_set_kernel();
+
+const char* obstacle_set_kernel_name(ObstacleSetKernel kernel);
+
+// Returns the distance from (x, y) along (dx, dy) (a unit vector) to the nearest obstacle in the set, or
+// max_scan_distance if nothing is hit before then. Like lidar_scan, if (x, y) is inside an obstacle the distance to
+// where the ray leaves it is used.
+float ray_obstacle_set_distance(ObstacleSet* set, float x, float y, float dx, float dy, float max_scan_distance);
+
+// Same as lidar_scan, but uses the vectorised slab test. Ranges agree with lidar_scan up to rounding.
+void lidar_scan_simd(float x, float y, const float* dir_x, const float* dir_y, int count, ObstacleSet* set, float* out_ranges, float max_scan_distance);
@@ -0,0 +1,340 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memory.hpp"
+#include "occupancy.hpp"
+
+const char* occupancy_update_name(OccupancyUpdate update) {
+	switch (update) {
+		case OCCUPANCY_UPDATE_ENDPOINTS: return "endpoints";
+		case OCCUPANCY_UPDATE_CARVE: return "carve";
+		default: return "unknown";
+	}
+}
+
+bool parse_occupancy_update(const char* name, OccupancyUpdate* out_update) {
+	for (int i = 0; i < OCCUPANCY_UPDATE_COUNT; i++) {
+		if (strcmp(name, occupancy_update_name((OccupancyUpdate)i)) == 0) {
+			*out_update = (OccupancyUpdate)i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Enough for the area a scan can reach, so a short drive never has to grow the table.
+const size_t OCCUPANCY_INITIAL_SLOTS = 256;
+
+OccupancyMap* create_occupancy_map(float cell_size) {
+	OccupancyMap* map = new OccupancyMap;
+
+	map->cell_size = cell_size;
+	map->slots.resize(OCCUPANCY_INITIAL_SLOTS, { 0, NULL });
+
+	return map;
+}
+
+void destroy_occupancy_map(OccupancyMap* map) {
+	for (OccupancyTile* block : map->blocks) {
+		free_aligned(block);
+	}
+
+	delete map;
+}
+
+void clear_occupancy_map(OccupancyMap* map) {
+	map->tiles.clear();
+
+	for (OccupancyTileSlot& slot : map->slots) {
+		slot.tile = NULL;
+	}
+}
+
+static uint64_t tile_key(int32_t tx, int32_t ty) {
+	return ((uint64_t)(uint32_t)tx << 32) | (uint32_t)ty;
+}
+
+static size_t tile_slot(uint64_t key, size_t slot_count) {
+	// Fibonacci hashing, so neighbouring tiles don't all end up in neighbouring slots.
+	return (size_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & (slot_count - 1);
+}
+
+OccupancyTile* find_occupancy_tile(OccupancyMap* map, int32_t tx, int32_t ty) {
+	uint64_t key = tile_key(tx, ty);
+	size_t mask = map->slots.size() - 1;
+
+	for (size_t i = tile_slot(key, map->slots.size());; i = (i + 1) & mask) {
+		OccupancyTileSlot& slot = map->slots[i];
+
+		if (!slot.tile) return NULL;
+		if (slot.key == key) return slot.tile;
+	}
+}
+
+static void insert_tile(std::vector<OccupancyTileSlot>& slots, uint64_t key, OccupancyTile* tile) {
+	size_t mask = slots.size() - 1;
+	size_t i = tile_slot(key, slots.size());
+
+	while (slots[i].tile) i = (i + 1) & mask;
+
+	slots[i] = { key, tile };
+}
+
+static OccupancyTile* allocate_tile(OccupancyMap* map) {
+	size_t index = map->tiles.size();
+
+	if (index == map->blocks.size() * OCCUPANCY_TILES_PER_BLOCK) {
+		map->blocks.push_back((OccupancyTile*)alloc_aligned(sizeof(OccupancyTile) * OCCUPANCY_TILES_PER_BLOCK, CACHE_LINE_SIZE));
+	}
+
+	OccupancyTile* tile = &map->blocks[index / OCCUPANCY_TILES_PER_BLOCK][index % OCCUPANCY_TILES_PER_BLOCK];
+	map->tiles.push_back(tile);
+
+	return tile;
+}
+
+// Finds the tile, creating an unknown one if there isn't one yet.
+static OccupancyTile* get_occupancy_tile(OccupancyMap* map, int32_t tx, int32_t ty) {
+	OccupancyTile* tile = find_occupancy_tile(map, tx, ty);
+	if (tile) return tile;
+
+	if (2 * (map->tiles.size() + 1) > map->slots.size()) {
+		std::vector<OccupancyTileSlot> slots(2 * map->slots.size(), { 0, NULL });
+
+		for (OccupancyTile* existing : map->tiles) {
+			insert_tile(slots, tile_key(existing->tx, existing->ty), existing);
+		}
+
+		map->slots.swap(slots);
+	}
+
+	tile = allocate_tile(map);
+
+	memset(tile->log_odds, 0, sizeof(tile->log_odds));
+	tile->tx = tx;
+	tile->ty = ty;
+
+	tile->dirty_x0 = 0;
+	tile->dirty_y0 = 0;
+	tile->dirty_x1 = OCCUPANCY_TILE_MASK;
+	tile->dirty_y1 = OCCUPANCY_TILE_MASK;
+
+	insert_tile(map->slots, tile_key(tx, ty), tile);
+
+	return tile;
+}
+
+void reset_occupancy_tile_dirty(OccupancyTile* tile) {
+	// Past the last cell, so the first one marked after this brings x0 back to at most x1.
+	tile->dirty_x0 = OCCUPANCY_TILE_SIZE;
+	tile->dirty_y0 = OCCUPANCY_TILE_SIZE;
+	tile->dirty_x1 = 0;
+	tile->dirty_y1 = 0;
+}
+
+// Grows the tile's dirty rectangle to take in the cells from (lx0, ly0) to (lx1, ly1), in either order.
+static inline void mark_tile_dirty(OccupancyTile* tile, int lx0, int ly0, int lx1, int ly1) {
+	if (lx0 > lx1) { int t = lx0; lx0 = lx1; lx1 = t; }
+	if (ly0 > ly1) { int t = ly0; ly0 = ly1; ly1 = t; }
+
+	if (lx0 < tile->dirty_x0) tile->dirty_x0 = (uint8_t)lx0;
+	if (ly0 < tile->dirty_y0) tile->dirty_y0 = (uint8_t)ly0;
+	if (lx1 > tile->dirty_x1) tile->dirty_x1 = (uint8_t)lx1;
+	if (ly1 > tile->dirty_y1) tile->dirty_y1 = (uint8_t)ly1;
+}
+
+void write_occupancy_cells(OccupancyMap* map, int32_t tx, int32_t ty, int x0, int y0, int x1, int y1, const int8_t* cells) {
+	OccupancyTile* tile = get_occupancy_tile(map, tx, ty);
+	int width = x1 - x0 + 1;
+
+	for (int ly = y0; ly <= y1; ly++) {
+		memcpy(&tile->log_odds[ly * OCCUPANCY_TILE_SIZE + x0], cells, width);
+		cells += width;
+	}
+
+	mark_tile_dirty(tile, x0, y0, x1, y1);
+}
+
+int8_t occupancy_log_odds(OccupancyMap* map, int32_t cx, int32_t cy) {
+	OccupancyTile* tile = find_occupancy_tile(map, cx >> OCCUPANCY_TILE_SHIFT, cy >> OCCUPANCY_TILE_SHIFT);
+	if (!tile) return 0;
+
+	return tile->log_odds[(cy & OCCUPANCY_TILE_MASK) * OCCUPANCY_TILE_SIZE + (cx & OCCUPANCY_TILE_MASK)];
+}
+
+size_t occupancy_map_memory(OccupancyMap* map) {
+	return sizeof(OccupancyMap) + sizeof(OccupancyTileSlot) * map->slots.capacity() + sizeof(OccupancyTile*) * (map->tiles.capacity() + map->blocks.capacity()) + sizeof(OccupancyTile) * OCCUPANCY_TILES_PER_BLOCK * map->blocks.size();
+}
+
+// Beams are set up this many at a time. The setup has no branches, so the compiler can vectorize it.
+const int OCCUPANCY_BATCH_SIZE = 64;
+
+struct BeamBatch {
+	int count;
+
+	// In cells.
+	alignas(CACHE_LINE_SIZE) float end_x[OCCUPANCY_BATCH_SIZE];
+	alignas(CACHE_LINE_SIZE) float end_y[OCCUPANCY_BATCH_SIZE];
+
+	alignas(CACHE_LINE_SIZE) float dir_x[OCCUPANCY_BATCH_SIZE];
+	alignas(CACHE_LINE_SIZE) float dir_y[OCCUPANCY_BATCH_SIZE];
+
+	// Whether the beam stopped on something within range.
+	alignas(CACHE_LINE_SIZE) bool hit[OCCUPANCY_BATCH_SIZE];
+};
+
+static void setup_beam_batch(BeamBatch* batch, LidarModel* model, int first_beam, int end_beam, float start_x, float start_y, float cos_angle, float sin_angle, float inv_cell_size, const float* lidar_points, float max_distance) {
+	batch->count = end_beam - first_beam;
+
+	const float* beam_cos = model->beam_cos + first_beam;
+	const float* beam_sin = model->beam_sin + first_beam;
+	const float* ranges = lidar_points + first_beam;
+
+	for (int i = 0; i < batch->count; i++) {
+		// Same rotation as the scan, so the hit lands where the beam stopped.
+		float dir_x = beam_cos[i] * cos_angle - beam_sin[i] * sin_angle;
+		float dir_y = beam_sin[i] * cos_angle + beam_cos[i] * sin_angle;
+
+		float distance = fminf(ranges[i], max_distance) * inv_cell_size;
+
+		batch->end_x[i] = start_x + distance * dir_x;
+		batch->end_y[i] = start_y + distance * dir_y;
+		batch->dir_x[i] = dir_x;
+		batch->dir_y[i] = dir_y;
+		batch->hit[i] = ranges[i] <= max_distance;
+	}
+}
+
+static inline void mark_free(int8_t* cell) {
+	int value = *cell - OCCUPANCY_LOG_ODDS_MISS;
+	if (value < OCCUPANCY_LOG_ODDS_MIN) value = OCCUPANCY_LOG_ODDS_MIN;
+
+	*cell = (int8_t)value;
+}
+
+static inline void mark_occupied(int8_t* cell) {
+	int value = *cell + OCCUPANCY_LOG_ODDS_HIT;
+	if (value > OCCUPANCY_LOG_ODDS_MAX) value = OCCUPANCY_LOG_ODDS_MAX;
+
+	*cell = (int8_t)value;
+}
+
+// Marks every cell from the one holding (start_x, start_y) up to, but not including, the one holding (end_x, end_y)
+// as free. All in cells. This is Amanatides and Woo's traversal.
+static void carve_beam(OccupancyMap* map, float start_x, float start_y, float end_x, float end_y, float dir_x, float dir_y) {
+	int cx = (int)floorf(start_x), cy = (int)floorf(start_y);
+	int ex = (int)floorf(end_x), ey = (int)floorf(end_y);
+
+	int step_x = dir_x < 0 ? -1 : 1;
+	int step_y = dir_y < 0 ? -1 : 1;
+
+	// How far along the beam to go one cell in x (or y), and how far until the next x (or y) cell border.
+	float t_delta_x = dir_x != 0 ? fabsf(1.0f / dir_x) : INFINITY;
+	float t_delta_y = dir_y != 0 ? fabsf(1.0f / dir_y) : INFINITY;
+
+	float t_max_x = dir_x != 0 ? (dir_x > 0 ? cx + 1 - start_x : start_x - cx) * t_delta_x : INFINITY;
+	float t_max_y = dir_y != 0 ? (dir_y > 0 ? cy + 1 - start_y : start_y - cy) * t_delta_y : INFINITY;
+
+	// Knowing the step count up front (and never stepping past the end cell on either axis) means rounding can't
+	// make the walk miss the end cell.
+	int steps = abs(ex - cx) + abs(ey - cy);
+
+	if (steps == 0) return;
+
+	// Walk within the current tile, and only go back to the hash when crossing into the next one.
+	OccupancyTile* tile = get_occupancy_tile(map, cx >> OCCUPANCY_TILE_SHIFT, cy >> OCCUPANCY_TILE_SHIFT);
+	int lx = cx & OCCUPANCY_TILE_MASK, ly = cy & OCCUPANCY_TILE_MASK;
+
+	// The walk only ever moves one way in x and in y, so the cells it marks in a tile all lie in the rectangle
+	// between the first and last of them.
+	int first_lx = lx, first_ly = ly;
+
+	for (int i = 0; i < steps; i++) {
+		mark_free(&tile->log_odds[ly * OCCUPANCY_TILE_SIZE + lx]);
+
+		int marked_lx = lx, marked_ly = ly;
+
+		if ((t_max_x < t_max_y && cx != ex) || cy == ey) {
+			cx += step_x;
+			lx += step_x;
+			t_max_x += t_delta_x;
+		} else {
+			cy += step_y;
+			ly += step_y;
+			t_max_y += t_delta_y;
+		}
+
+		if (i + 1 == steps) {
+			mark_tile_dirty(tile, first_lx, first_ly, marked_lx, marked_ly);
+			break;
+		}
+
+		if ((unsigned)lx >= (unsigned)OCCUPANCY_TILE_SIZE || (unsigned)ly >= (unsigned)OCCUPANCY_TILE_SIZE) {
+			mark_tile_dirty(tile, first_lx, first_ly, marked_lx, marked_ly);
+
+			tile = get_occupancy_tile(map, cx >> OCCUPANCY_TILE_SHIFT, cy >> OCCUPANCY_TILE_SHIFT);
+			lx &= OCCUPANCY_TILE_MASK;
+			ly &= OCCUPANCY_TILE_MASK;
+
+			first_lx = lx;
+			first_ly = ly;
+		}
+	}
+}
+
+void update_occupancy_map(OccupancyMap* map, LidarModel* model, OccupancyUpdate update, float x, float y, float angle, const float* lidar_points, float max_distance) {
+	float cos_angle, sin_angle;
+	lidar_heading(angle, &cos_angle, &sin_angle);
+
+	float inv_cell_size = 1.0f / map->cell_size;
+
+	float start_x = x * inv_cell_size;
+	float start_y = y * inv_cell_size;
+
+	BeamBatch batch;
+
+	// All the carving happens before any of the hits.
+	if (update == OCCUPANCY_UPDATE_CARVE) {
+		for (int begin = 0; begin < model->beam_count; begin += OCCUPANCY_BATCH_SIZE) {
+			int end = begin + OCCUPANCY_BATCH_SIZE;
+			if (end > model->beam_count) end = model->beam_count;
+
+			setup_beam_batch(&batch, model, begin, end, start_x, start_y, cos_angle, sin_angle, inv_cell_size, lidar_points, max_distance);
+
+			for (int i = 0; i < batch.count; i++) {
+				carve_beam(map, start_x, start_y, batch.end_x[i], batch.end_y[i], batch.dir_x[i], batch.dir_y[i]);
+			}
+		}
+	}
+
+	// Neighbouring beams mostly land in the same tile.
+	OccupancyTile* tile = NULL;
+
+	for (int begin = 0; begin < model->beam_count; begin += OCCUPANCY_BATCH_SIZE) {
+		int end = begin + OCCUPANCY_BATCH_SIZE;
+		if (end > model->beam_count) end = model->beam_count;
+
+		setup_beam_batch(&batch, model, begin, end, start_x, start_y, cos_angle, sin_angle, inv_cell_size, lidar_points, max_distance);
+
+		for (int i = 0; i < batch.count; i++) {
+			if (!batch.hit[i]) continue;
+
+			int cx = (int)floorf(batch.end_x[i]);
+			int cy = (int)floorf(batch.end_y[i]);
+
+			int32_t tx = cx >> OCCUPANCY_TILE_SHIFT, ty = cy >> OCCUPANCY_TILE_SHIFT;
+			if (!tile || tile->tx != tx || tile->ty != ty) tile = get_occupancy_tile(map, tx, ty);
+
+			int lx = cx & OCCUPANCY_TILE_MASK, ly = cy & OCCUPANCY_TILE_MASK;
+
+			mark_occupied(&tile->log_odds[ly * OCCUPANCY_TILE_SIZE + lx]);
+			mark_tile_dirty(tile, lx, ly, lx, ly);
+		}
+	}
+}
+
+float occupancy_probability(int8_t log_odds) {
+	return 1.0f / (1.0f + expf(-(float)log_odds / OCCUPANCY_LOG_ODDS_ONE));
+}
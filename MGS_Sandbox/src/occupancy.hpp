@@ -0,0 +1,125 @@
+/*
+	A world-frame occupancy map that fuses every LIDAR scan into what the rover has seen so far.
+
+	Each cell holds the log-odds of being occupied, in fixed point (OCCUPANCY_LOG_ODDS_ONE is a log-odds of 1), so a
+	cell is an int8_t and updates are saturating adds. A scan only touches the cells its beams cross or land in;
+	nothing is cleared between scans.
+
+	The map has no bounds. Cells are stored in OCCUPANCY_TILE_SIZE square tiles, which are only created once a beam
+	reaches them, so memory follows the area explored rather than its bounding box. Tiles are found through an open
+	addressing hash keyed on the tile coordinate and handed out from a pool, and the cells within a tile are a plain
+	row-major array, so walking a beam only needs a lookup when it crosses into another tile.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "lidar_model.hpp"
+#include "memory.hpp"
+
+// Fixed point scale of the log-odds.
+const int OCCUPANCY_LOG_ODDS_ONE = 16;
+
+// Added to a cell each time a return lands in it (a hit probability of about 0.7).
+const int OCCUPANCY_LOG_ODDS_HIT = 14;
+
+// Taken off every cell a beam passes through on its way (a miss probability of about 0.4).
+const int OCCUPANCY_LOG_ODDS_MISS = 6;
+
+// Cells saturate here, so a few scans can always change their mind about a cell (probabilities 0.02 and 0.98).
+const int OCCUPANCY_LOG_ODDS_MIN = -64;
+const int OCCUPANCY_LOG_ODDS_MAX = 64;
+
+enum OccupancyUpdate {
+	// Only add hits where the returns land. Cheap, but obstacles that went away never clear.
+	OCCUPANCY_UPDATE_ENDPOINTS,
+
+	// Also walk every beam through the map, marking the cells it crossed as free.
+	OCCUPANCY_UPDATE_CARVE,
+
+	OCCUPANCY_UPDATE_COUNT
+};
+
+const char* occupancy_update_name(OccupancyUpdate update);
+
+// Looks up an update by the name occupancy_update_name gives it. Returns false if there isn't one.
+bool parse_occupancy_update(const char* name, OccupancyUpdate* out_update);
+
+// Tiles are 64 by 64 cells, 4 KiB, which is a page.
+const int OCCUPANCY_TILE_SHIFT = 6;
+const int OCCUPANCY_TILE_SIZE = 1 << OCCUPANCY_TILE_SHIFT;
+const int OCCUPANCY_TILE_MASK = OCCUPANCY_TILE_SIZE - 1;
+
+// How many tiles the pool allocates at once.
+const int OCCUPANCY_TILES_PER_BLOCK = 64;
+
+struct alignas(CACHE_LINE_SIZE) OccupancyTile {
+	// Row-major. 0 means unknown.
+	int8_t log_odds[OCCUPANCY_TILE_SIZE * OCCUPANCY_TILE_SIZE];
+
+	// Tile (tx, ty) holds cells tx * OCCUPANCY_TILE_SIZE to (tx + 1) * OCCUPANCY_TILE_SIZE - 1 in x, and the same for y.
+	int32_t tx, ty;
+
+	// The cells changed since the last reset_occupancy_tile_dirty, as an inclusive rectangle. Empty when dirty_x0 >
+	// dirty_x1. A new tile is dirty all over, so whatever mirrors the map (like the renderer's textures) can copy just
+	// these cells.
+	uint8_t dirty_x0, dirty_y0, dirty_x1, dirty_y1;
+};
+
+struct OccupancyTileSlot {
+	uint64_t key;
+
+	// NULL when the slot is empty.
+	OccupancyTile* tile;
+};
+
+struct OccupancyMap {
+	// Cell (cx, cy) covers x in [cx * cell_size, (cx + 1) * cell_size), and the same for y.
+	float cell_size;
+
+	// Open addressing with linear probing. The size is a power of two, and at most half the slots are used.
+	std::vector<OccupancyTileSlot> slots;
+
+	// Every tile in use, in the order they were created.
+	std::vector<OccupancyTile*> tiles;
+
+	// Blocks of OCCUPANCY_TILES_PER_BLOCK tiles. Clearing the map keeps them, so it can fill back up without
+	// allocating.
+	std::vector<OccupancyTile*> blocks;
+};
+
+OccupancyMap* create_occupancy_map(float cell_size);
+
+void destroy_occupancy_map(OccupancyMap* map);
+
+// Back to everything unknown.
+void clear_occupancy_map(OccupancyMap* map);
+
+// The tile at tile coordinate (tx, ty), or NULL if nothing has been seen there yet.
+OccupancyTile* find_occupancy_tile(OccupancyMap* map, int32_t tx, int32_t ty);
+
+// Marks the tile as up to date with whatever mirrors it.
+void reset_occupancy_tile_dirty(OccupancyTile* tile);
+
+// Copies cells into the rectangle from (x0, y0) to (x1, y1) (inclusive, in cells within the tile) of tile (tx, ty),
+// creating the tile if it isn't there yet, and marks them dirty. cells holds the rectangle row by row. For keeping a
+// copy of a map up to date from another's dirty rectangles.
+void write_occupancy_cells(OccupancyMap* map, int32_t tx, int32_t ty, int x0, int y0, int x1, int y1, const int8_t* cells);
+
+// The log-odds of cell (cx, cy), 0 if it's unknown.
+int8_t occupancy_log_odds(OccupancyMap* map, int32_t cx, int32_t cy);
+
+// Bytes held by the map, including pooled tiles that aren't in use.
+size_t occupancy_map_memory(OccupancyMap* map);
+
+// Fuses a scan taken from a rover at (x, y) facing angle degrees. Returns closer than max_distance count as hits.
+// When carving, beams clear the cells up to their return (or up to
+// max_distance if they didn't hit anything), and hits are added after all the carving so a beam grazing past an
+// obstacle can't wipe out another beam's hit on it.
+void update_occupancy_map(OccupancyMap* map, LidarModel* model, OccupancyUpdate update, float x, float y, float angle, const float* lidar_points, float max_distance);
+
+// The probability a cell is occupied, from its log-odds.
+float occupancy_probability(int8_t log_odds);
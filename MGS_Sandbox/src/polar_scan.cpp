@@ -0,0 +1,115 @@
+#include <math.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "polar_scan.hpp"
+
+const float TWO_PI = 6.28318530718f;
+
+// Obstacles are tested against the beams up to this many radians outside the angles they subtend, so a beam that
+// grazes a corner isn't missed because atan2f or the beam angles rounded differently from the intersection test.
+const float POLAR_ANGLE_PADDING = 1e-4f;
+
+// Wraps an angle in radians into [0, 2 pi).
+static float wrap_angle(float angle) {
+    angle = fmodf(angle, TWO_PI);
+    if (angle < 0) angle += TWO_PI;
+    if (angle >= TWO_PI) angle = 0;
+
+    return angle;
+}
+
+// The first ray at or after angle (radians counterclockwise from the first ray), or count if there's none.
+static int first_ray_from(float angle, float angle_step, int count) {
+    float ray = ceilf(angle / angle_step);
+
+    if (ray < 0) return 0;
+    if (ray > count) return count;
+    return (int)ray;
+}
+
+// The first ray after angle, or count if there's none.
+static int first_ray_after(float angle, float angle_step, int count) {
+    float ray = floorf(angle / angle_step) + 1;
+
+    if (ray < 0) return 0;
+    if (ray > count) return count;
+    return (int)ray;
+}
+
+// Intersects rays [begin, end) with the obstacle, keeping the nearest hit of each in min_sq.
+static void rasterize_obstacle(float x, float y, const float* dir_x, const float* dir_y, int begin, int end, const Obstacle& obs, float* min_sq, float max_scan_distance) {
+    for (int i = begin; i < end; i++) {
+        ray_obstacle_collision(x, y, x + max_scan_distance * dir_x[i], y + max_scan_distance * dir_y[i], obs, &min_sq[i]);
+    }
+}
+
+void lidar_scan_polar(float x, float y, float first_angle, float angle_step, const float* dir_x, const float* dir_y, int count, std::vector<Obstacle>& obstacles, float* out_ranges, float max_scan_distance) {
+    if (count == 0) return;
+
+    // Working out which rays an obstacle covers from the step needs them to go up in angle, by less than a full turn.
+    if (!(angle_step > 0) || angle_step * (count - 1) >= TWO_PI) {
+        lidar_scan(x, y, dir_x, dir_y, count, obstacles, out_ranges, max_scan_distance);
+        return;
+    }
+
+    first_angle = wrap_angle(first_angle);
+
+    // The depth buffer, in squared meters like ray_obstacle_collision. out_ranges doubles as it until the end.
+    float* min_sq = out_ranges;
+
+    for (int i = 0; i < count; i++) min_sq[i] = max_scan_distance * max_scan_distance;
+
+    for (const Obstacle& obs : obstacles) {
+        float min_x = obs.x - obs.w / 2.0f;
+        float max_x = obs.x + obs.w / 2.0f;
+        float min_y = obs.y - obs.h / 2.0f;
+        float max_y = obs.y + obs.h / 2.0f;
+
+        // Nothing in it can be hit if its nearest point is out of range.
+        float near_x = x - std::max(min_x, std::min(x, max_x));
+        float near_y = y - std::max(min_y, std::min(y, max_y));
+        if (near_x * near_x + near_y * near_y > max_scan_distance * max_scan_distance) continue;
+
+        // From inside (or on the edge of) the obstacle, every ray can hit it.
+        if (x >= min_x && x <= max_x && y >= min_y && y <= max_y) {
+            rasterize_obstacle(x, y, dir_x, dir_y, 0, count, obs, min_sq, max_scan_distance);
+            continue;
+        }
+
+        // From outside, it covers less than half a turn, so the corners' angles either side of its center give the
+        // angles it covers.
+        float center_angle = atan2f(obs.y - y, obs.x - x);
+
+        float corners_x[4] = { min_x, max_x, max_x, min_x };
+        float corners_y[4] = { min_y, min_y, max_y, max_y };
+
+        float low = 0, high = 0;
+
+        for (int c = 0; c < 4; c++) {
+            float offset = wrap_angle(atan2f(corners_y[c] - y, corners_x[c] - x) - center_angle);
+            if (offset > TWO_PI / 2) offset -= TWO_PI;
+
+            low = std::min(low, offset);
+            high = std::max(high, offset);
+        }
+
+        float start = wrap_angle(center_angle + low - POLAR_ANGLE_PADDING - first_angle);
+        float end = start + (high - low) + 2 * POLAR_ANGLE_PADDING;
+
+        int first = first_ray_from(start, angle_step, count);
+        int last = first_ray_after(end, angle_step, count);
+
+        rasterize_obstacle(x, y, dir_x, dir_y, first, last, obs, min_sq, max_scan_distance);
+
+        // The part past a full turn wraps around to the first rays.
+        if (end >= TWO_PI) {
+            int wrapped = first_ray_after(end - TWO_PI, angle_step, count);
+
+            rasterize_obstacle(x, y, dir_x, dir_y, 0, std::min(wrapped, first), obs, min_sq, max_scan_distance);
+        }
+    }
+
+    for (int i = 0; i < count; i++) out_ranges[i] = sqrtf(min_sq[i]);
+}
@@ -0,0 +1,21 @@
+/*
+    A LIDAR engine that goes through the obstacles once per scan instead of once per ray.
+
+    Every obstacle in range is "rasterized" into a polar depth buffer indexed by beam: the angles its corners subtend
+    from the rover pick out the run of beams that can hit it (the beams are evenly spaced, so that's a division by the
+    step), and only those beams are intersected with it, each keeping the nearest hit. Each obstacle only covers a few
+    beams, so a scan costs about obstacles + beams rather than obstacles * beams, and nothing is allocated. The
+    intersections are lidar_scan's own, and a beam that isn't tested against an obstacle couldn't have hit it, so the
+    ranges are exactly lidar_scan's, not approximations.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "obstacle.hpp"
+
+// Same as lidar_scan, and bit-identical to it. Ray i has to point first_angle + i * angle_step radians
+// counterclockwise from the x axis (as a LidarModel's beams do, see scan_world_beams), and the rays have to sweep
+// through less than a full turn; if angle_step isn't positive or they sweep further, this just calls lidar_scan.
+void lidar_scan_polar(float x, float y, float first_angle, float angle_step, const float* dir_x, const float* dir_y, int count, std::vector<Obstacle>& obstacles, float* out_ranges, float max_scan_distance);
@@ -0,0 +1,722 @@
+#ifndef MGS_HEADLESS_ONLY
+
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include <SDL.h>
+
+#include "renderer.hpp"
+
+// Buffer objects are OpenGL 1.5, past what the system headers can be relied on to declare, so they're looked up.
+static PFNGLGENBUFFERSPROC gl_gen_buffers;
+static PFNGLDELETEBUFFERSPROC gl_delete_buffers;
+static PFNGLBINDBUFFERPROC gl_bind_buffer;
+static PFNGLBUFFERDATAPROC gl_buffer_data;
+
+static bool load_buffer_functions() {
+    int major = 0, minor = 0;
+    const char* version = (const char*)glGetString(GL_VERSION);
+
+    if (!version || sscanf(version, "%d.%d", &major, &minor) != 2) return false;
+    if (major < 1 || (major == 1 && minor < 5)) return false;
+
+    gl_gen_buffers = (PFNGLGENBUFFERSPROC)SDL_GL_GetProcAddress("glGenBuffers");
+    gl_delete_buffers = (PFNGLDELETEBUFFERSPROC)SDL_GL_GetProcAddress("glDeleteBuffers");
+    gl_bind_buffer = (PFNGLBINDBUFFERPROC)SDL_GL_GetProcAddress("glBindBuffer");
+    gl_buffer_data = (PFNGLBUFFERDATAPROC)SDL_GL_GetProcAddress("glBufferData");
+
+    return gl_gen_buffers && gl_delete_buffers && gl_bind_buffer && gl_buffer_data;
+}
+
+Renderer* create_renderer() {
+    Renderer* renderer = new Renderer;
+
+    renderer->has_buffers = load_buffer_functions();
+
+    if (!renderer->has_buffers) {
+        printf("[!] OpenGL %s has no buffer objects, drawing from client memory.\n", (const char*)glGetString(GL_VERSION));
+    }
+
+    renderer->grid_offset = 0;
+    renderer->grid_size = 0;
+
+    renderer->hex_position_buffer = 0;
+    renderer->hex_texcoord_buffer = 0;
+    renderer->hex_fill_buffer = 0;
+    renderer->hex_outline_buffer = 0;
+
+    renderer->vertex_buffer = 0;
+
+    if (renderer->has_buffers) {
+        GLuint buffers[5];
+        gl_gen_buffers(5, buffers);
+
+        renderer->hex_position_buffer = buffers[0];
+        renderer->hex_texcoord_buffer = buffers[1];
+        renderer->hex_fill_buffer = buffers[2];
+        renderer->hex_outline_buffer = buffers[3];
+        renderer->vertex_buffer = buffers[4];
+    }
+
+    glGenTextures(1, &renderer->hex_texture);
+    renderer->hex_texture_size = 0;
+    renderer->hex_dirty = { 0, 0, -1, -1 };
+    renderer->hex_visible_origin = -1;
+
+    // Unknown and free cells aren't drawn. Occupied ones fade in from 0.5 (unknown) to fully black at the most certain.
+    for (int i = 0; i < 256; i++) {
+        int8_t log_odds = (int8_t)(uint8_t)i;
+        float alpha = log_odds > 0 ? 2.0f * occupancy_probability(log_odds) - 1.0f : 0.0f;
+
+        renderer->occupancy_palette[i] = (uint8_t)(alpha * 255.0f + 0.5f);
+    }
+
+    reset_render_stats(renderer);
+
+    return renderer;
+}
+
+void destroy_renderer(Renderer* renderer) {
+    if (renderer->has_buffers) {
+        GLuint buffers[5] = {
+            renderer->hex_position_buffer, renderer->hex_texcoord_buffer, renderer->hex_fill_buffer,
+            renderer->hex_outline_buffer, renderer->vertex_buffer
+        };
+
+        gl_delete_buffers(5, buffers);
+    }
+
+    glDeleteTextures(1, &renderer->hex_texture);
+
+    for (auto& entry : renderer->occupancy_textures) {
+        glDeleteTextures(1, &entry.second);
+    }
+
+    delete renderer;
+}
+
+void reset_render_stats(Renderer* renderer) {
+    renderer->draw_calls = 0;
+    renderer->vertex_count = 0;
+    renderer->texels_uploaded = 0;
+}
+
+static uint8_t colour_byte(float value) {
+    if (value <= 0.0f) return 0;
+    if (value >= 1.0f) return 255;
+
+    return (uint8_t)(value * 255.0f + 0.5f);
+}
+
+static RenderColour make_colour(float r, float g, float b, float a) {
+    return { colour_byte(r), colour_byte(g), colour_byte(b), colour_byte(a) };
+}
+
+// Binds buffer (if there are buffer objects) and uploads data to it, returning what the gl*Pointer and glDrawElements
+// calls should be given as the start of the data: an offset into the buffer, or the data itself.
+static const char* upload(Renderer* renderer, GLenum target, GLuint buffer, const void* data, size_t bytes, GLenum usage) {
+    if (!renderer->has_buffers) return (const char*)data;
+
+    gl_bind_buffer(target, buffer);
+    gl_buffer_data(target, bytes, data, usage);
+
+    return NULL;
+}
+
+static const char* bind(Renderer* renderer, GLenum target, GLuint buffer, const void* data) {
+    if (!renderer->has_buffers) return (const char*)data;
+
+    gl_bind_buffer(target, buffer);
+
+    return NULL;
+}
+
+static void unbind(Renderer* renderer) {
+    if (!renderer->has_buffers) return;
+
+    gl_bind_buffer(GL_ARRAY_BUFFER, 0);
+    gl_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+// Nearest sampling, so every texel stays one flat cell however far in the view is zoomed.
+static void create_texture(GLuint texture, GLenum format, int size, const void* pixels) {
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glTexImage2D(GL_TEXTURE_2D, 0, format, size, size, 0, format, GL_UNSIGNED_BYTE, pixels);
+}
+
+// Uploads the dirty rectangle of pixels, a row-major image row_length wide, to the bound texture at the same place.
+static void upload_dirty_rect(Renderer* renderer, GLenum format, const uint8_t* pixels, int row_length, DirtyRect dirty) {
+    int width = dirty.x1 - dirty.x0 + 1, height = dirty.y1 - dirty.y0 + 1;
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, row_length);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, dirty.x0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, dirty.y0);
+
+    glTexSubImage2D(GL_TEXTURE_2D, 0, dirty.x0, dirty.y0, width, height, format, GL_UNSIGNED_BYTE, pixels);
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    renderer->texels_uploaded += (long)width * height;
+}
+
+// Hex corner i of the flat-topped unit hex, as render_grid has always drawn them.
+static void hex_corner(int i, float* x, float* y) {
+    float theta = (M_PI / 3.0f) * i;
+
+    *x = cosf(theta);
+    *y = sinf(theta);
+}
+
+static void build_hex_geometry(Renderer* renderer, int offset, int size) {
+    size_t hex_count = (size_t)size * size;
+
+    renderer->grid_offset = offset;
+    renderer->grid_size = size;
+
+    renderer->hex_positions.resize(hex_count * 12);
+    renderer->hex_texcoords.resize(hex_count * 12);
+    renderer->hex_fill_indices.clear();
+    renderer->hex_outline_indices.clear();
+    renderer->hex_visible_rows.clear();
+    renderer->hex_visible_origin = -1;
+
+    int texture_size = 1;
+    while (texture_size < size) texture_size *= 2;
+
+    renderer->hex_texture_size = texture_size;
+    renderer->hex_shades.assign(hex_count, 255);
+
+    float corner_x[6], corner_y[6];
+    for (int i = 0; i < 6; i++) hex_corner(i, &corner_x[i], &corner_y[i]);
+
+    // Same order as the grid's cells, so hex h is the one at index h in the grid.
+    for (int q = -offset; q < size - offset; q++) {
+        for (int r = -offset; r < size - offset; r++) {
+            uint32_t hex = (uint32_t)((q + offset) * size + (r + offset));
+
+            float center_x = (3.0f/2.0f) * q;
+            float center_y = (sqrtf(3.0f)/2.0f) * q + sqrtf(3.0f) * r;
+
+            // The middle of the hex's texel.
+            float u = (r + offset + 0.5f) / texture_size;
+            float v = (q + offset + 0.5f) / texture_size;
+
+            float* positions = &renderer->hex_positions[hex * 12];
+            float* texcoords = &renderer->hex_texcoords[hex * 12];
+
+            for (int i = 0; i < 6; i++) {
+                positions[2 * i] = center_x + corner_x[i];
+                positions[2 * i + 1] = center_y + corner_y[i];
+
+                texcoords[2 * i] = u;
+                texcoords[2 * i + 1] = v;
+            }
+        }
+    }
+
+    if (renderer->has_buffers) {
+        upload(renderer, GL_ARRAY_BUFFER, renderer->hex_position_buffer, renderer->hex_positions.data(), renderer->hex_positions.size() * sizeof(float), GL_STATIC_DRAW);
+        upload(renderer, GL_ARRAY_BUFFER, renderer->hex_texcoord_buffer, renderer->hex_texcoords.data(), renderer->hex_texcoords.size() * sizeof(float), GL_STATIC_DRAW);
+
+        unbind(renderer);
+    }
+
+    // Allocated blank; update_render_grid fills every hex in straight after.
+    create_texture(renderer->hex_texture, GL_LUMINANCE, texture_size, NULL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    renderer->hex_dirty = { 0, 0, -1, -1 };
+}
+
+static void set_hex_shade(Renderer* renderer, int q, int r, float value) {
+    int u = q + renderer->grid_offset, v = r + renderer->grid_offset;
+    if (u < 0 || u >= renderer->grid_size || v < 0 || v >= renderer->grid_size) return;
+
+    renderer->hex_shades[(size_t)u * renderer->grid_size + v] = colour_byte(1.0f - value);
+
+    DirtyRect& dirty = renderer->hex_dirty;
+
+    if (dirty.x0 > dirty.x1) {
+        dirty = { v, u, v, u };
+    } else {
+        if (v < dirty.x0) dirty.x0 = v;
+        if (v > dirty.x1) dirty.x1 = v;
+        if (u < dirty.y0) dirty.y0 = u;
+        if (u > dirty.y1) dirty.y1 = u;
+    }
+}
+
+void update_render_grid(Renderer* renderer, const Grid<float>* grid, const HexCell* changed, int changed_count) {
+    if (renderer->grid_size != grid->layout.size || renderer->grid_offset != grid->layout.offset) {
+        build_hex_geometry(renderer, grid->layout.offset, grid->layout.size);
+        changed = NULL;
+    }
+
+    if (changed) {
+        for (int i = 0; i < changed_count; i++) {
+            set_hex_shade(renderer, changed[i].q, changed[i].r, grid->get(changed[i].q, changed[i].r));
+        }
+    } else {
+        for (int q = -grid->layout.offset; q < grid->layout.size - grid->layout.offset; q++) {
+            for (int r = -grid->layout.offset; r < grid->layout.size - grid->layout.offset; r++) {
+                set_hex_shade(renderer, q, r, grid->get(q, r));
+            }
+        }
+    }
+}
+
+// Appends the indices for hexes [first_hex, end_hex) to the visible lists.
+static void push_hex_indices(Renderer* renderer, uint32_t first_hex, uint32_t end_hex) {
+    for (uint32_t hex = first_hex; hex < end_hex; hex++) {
+        uint32_t first = hex * 6;
+
+        // A fan of four triangles from the first corner.
+        for (uint32_t i = 0; i < 4; i++) {
+            renderer->hex_fill_indices.push_back(first);
+            renderer->hex_fill_indices.push_back(first + i + 1);
+            renderer->hex_fill_indices.push_back(first + i + 2);
+        }
+
+        for (uint32_t i = 0; i < 6; i++) {
+            renderer->hex_outline_indices.push_back(first + i);
+            renderer->hex_outline_indices.push_back(first + (i + 1) % 6);
+        }
+    }
+}
+
+// Works out which hexes overlap the view (in grid units), and rebuilds the index lists if they aren't the ones the
+// lists were last built for.
+static void cull_hexes(Renderer* renderer, float view_min_x, float view_min_y, float view_max_x, float view_max_y) {
+    int offset = renderer->grid_offset, size = renderer->grid_size;
+
+    // Hex (q, r) is centered on (3/2 q, sqrt(3)/2 q + sqrt(3) r), and reaches 1 either side in x and sqrt(3)/2 in y.
+    const float SQRT_3 = sqrtf(3.0f);
+
+    int q0 = (int)ceilf((view_min_x - 1.0f) / 1.5f);
+    int q1 = (int)floorf((view_max_x + 1.0f) / 1.5f);
+
+    if (q0 < -offset) q0 = -offset;
+    if (q1 > size - offset - 1) q1 = size - offset - 1;
+
+    std::vector<int>& rows = renderer->hex_culled_rows;
+    rows.clear();
+    rows.push_back(q0);
+
+    for (int q = q0; q <= q1; q++) {
+        int r0 = (int)ceilf((view_min_y - SQRT_3 / 2.0f - (SQRT_3 / 2.0f) * q) / SQRT_3);
+        int r1 = (int)floorf((view_max_y + SQRT_3 / 2.0f - (SQRT_3 / 2.0f) * q) / SQRT_3);
+
+        if (r0 < -offset) r0 = -offset;
+        if (r1 > size - offset - 1) r1 = size - offset - 1;
+
+        rows.push_back(r0);
+        rows.push_back(r1);
+    }
+
+    if (rows == renderer->hex_visible_rows) return;
+
+    renderer->hex_visible_rows.swap(rows);
+    renderer->hex_fill_indices.clear();
+    renderer->hex_outline_indices.clear();
+    renderer->hex_visible_origin = -1;
+
+    // Hexes with the same q are next to each other, so each row of the view is one run of them.
+    for (int q = q0; q <= q1; q++) {
+        int r0 = renderer->hex_visible_rows[1 + 2 * (q - q0)];
+        int r1 = renderer->hex_visible_rows[2 + 2 * (q - q0)];
+        if (r0 > r1) continue;
+
+        if (q == 0 && r0 <= 0 && r1 >= 0) {
+            renderer->hex_visible_origin = (int)(renderer->hex_outline_indices.size() + 12 * (0 - r0));
+        }
+
+        uint32_t row = (uint32_t)((q + offset) * size + offset);
+        push_hex_indices(renderer, row + r0, row + r1 + 1);
+    }
+
+    if (renderer->has_buffers) {
+        upload(renderer, GL_ELEMENT_ARRAY_BUFFER, renderer->hex_fill_buffer, renderer->hex_fill_indices.data(), renderer->hex_fill_indices.size() * sizeof(uint32_t), GL_DYNAMIC_DRAW);
+        upload(renderer, GL_ELEMENT_ARRAY_BUFFER, renderer->hex_outline_buffer, renderer->hex_outline_indices.data(), renderer->hex_outline_indices.size() * sizeof(uint32_t), GL_DYNAMIC_DRAW);
+
+        unbind(renderer);
+    }
+}
+
+// The whole grid as one parallelogram with the shade texture stretched over it. Hex (q, r) becomes the parallelogram
+// of axial coordinates within half a hex of it, which is about the same area in the same place.
+static void render_grid_image(Renderer* renderer) {
+    int offset = renderer->grid_offset, size = renderer->grid_size;
+    float extent = (float)size / renderer->hex_texture_size;
+
+    const float SQRT_3 = sqrtf(3.0f);
+
+    float q0 = -offset - 0.5f, q1 = size - offset - 0.5f;
+    float r0 = -offset - 0.5f, r1 = size - offset - 0.5f;
+
+    std::vector<TexturedVertex>& vertices = renderer->textured_vertices;
+
+    vertices.push_back({ 1.5f * q0, (SQRT_3 / 2.0f) * q0 + SQRT_3 * r0, 0.0f, 0.0f });
+    vertices.push_back({ 1.5f * q0, (SQRT_3 / 2.0f) * q0 + SQRT_3 * r1, extent, 0.0f });
+    vertices.push_back({ 1.5f * q1, (SQRT_3 / 2.0f) * q1 + SQRT_3 * r1, extent, extent });
+    vertices.push_back({ 1.5f * q1, (SQRT_3 / 2.0f) * q1 + SQRT_3 * r0, 0.0f, extent });
+
+    const char* base = upload(renderer, GL_ARRAY_BUFFER, renderer->vertex_buffer, vertices.data(), vertices.size() * sizeof(TexturedVertex), GL_STREAM_DRAW);
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+
+    glVertexPointer(2, GL_FLOAT, sizeof(TexturedVertex), base + offsetof(TexturedVertex, x));
+    glTexCoordPointer(2, GL_FLOAT, sizeof(TexturedVertex), base + offsetof(TexturedVertex, u));
+
+    glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+    glDrawArrays(GL_QUADS, 0, 4);
+
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    unbind(renderer);
+
+    renderer->draw_calls++;
+    renderer->vertex_count += 4;
+
+    vertices.clear();
+}
+
+void render_grid(Renderer* renderer, float stroke_width, float view_min_x, float view_min_y, float view_max_x, float view_max_y, float pixels_per_unit) {
+    if (renderer->grid_size == 0) return;
+
+    glBindTexture(GL_TEXTURE_2D, renderer->hex_texture);
+
+    if (renderer->hex_dirty.x0 <= renderer->hex_dirty.x1) {
+        upload_dirty_rect(renderer, GL_LUMINANCE, renderer->hex_shades.data(), renderer->grid_size, renderer->hex_dirty);
+        renderer->hex_dirty = { 0, 0, -1, -1 };
+    }
+
+    glEnable(GL_TEXTURE_2D);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+
+    if (pixels_per_unit < RENDER_HEX_DETAIL_PIXELS) {
+        render_grid_image(renderer);
+
+        glDisable(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        return;
+    }
+
+    cull_hexes(renderer, view_min_x, view_min_y, view_max_x, view_max_y);
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+
+    glVertexPointer(2, GL_FLOAT, 0, bind(renderer, GL_ARRAY_BUFFER, renderer->hex_position_buffer, renderer->hex_positions.data()));
+    glTexCoordPointer(2, GL_FLOAT, 0, bind(renderer, GL_ARRAY_BUFFER, renderer->hex_texcoord_buffer, renderer->hex_texcoords.data()));
+
+    glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+
+    const char* fill = bind(renderer, GL_ELEMENT_ARRAY_BUFFER, renderer->hex_fill_buffer, renderer->hex_fill_indices.data());
+    glDrawElements(GL_TRIANGLES, (GLsizei)renderer->hex_fill_indices.size(), GL_UNSIGNED_INT, fill);
+
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glLineWidth(stroke_width);
+
+    const char* outline = bind(renderer, GL_ELEMENT_ARRAY_BUFFER, renderer->hex_outline_buffer, renderer->hex_outline_indices.data());
+
+    glColor4f(1.0f, 0.0f, 0.0f, 1.0f);
+    glDrawElements(GL_LINES, (GLsizei)renderer->hex_outline_indices.size(), GL_UNSIGNED_INT, outline);
+
+    renderer->draw_calls += 2;
+    renderer->vertex_count += renderer->hex_fill_indices.size() + renderer->hex_outline_indices.size();
+
+    // The origin's outline again, in green.
+    if (renderer->hex_visible_origin >= 0) {
+        glColor4f(0.0f, 1.0f, 0.0f, 1.0f);
+        glDrawElements(GL_LINES, 12, GL_UNSIGNED_INT, outline + renderer->hex_visible_origin * sizeof(uint32_t));
+
+        renderer->draw_calls++;
+        renderer->vertex_count += 12;
+    }
+
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    unbind(renderer);
+}
+
+// Draws the streamed vertices as one batch, and empties it.
+static void draw_vertices(Renderer* renderer, GLenum mode) {
+    std::vector<RenderVertex>& vertices = renderer->vertices;
+    if (vertices.empty()) return;
+
+    const char* base = upload(renderer, GL_ARRAY_BUFFER, renderer->vertex_buffer, vertices.data(), vertices.size() * sizeof(RenderVertex), GL_STREAM_DRAW);
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+
+    glVertexPointer(2, GL_FLOAT, sizeof(RenderVertex), base + offsetof(RenderVertex, x));
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(RenderVertex), base + offsetof(RenderVertex, r));
+
+    glDrawArrays(mode, 0, (GLsizei)vertices.size());
+
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    unbind(renderer);
+
+    renderer->draw_calls++;
+    renderer->vertex_count += vertices.size();
+
+    vertices.clear();
+}
+
+static void push_vertex(Renderer* renderer, float x, float y, RenderColour colour) {
+    renderer->vertices.push_back({ x, y, colour.r, colour.g, colour.b, colour.a });
+}
+
+// Two triangles, corners in order around the quad.
+static void push_quad(Renderer* renderer, const float* x, const float* y, RenderColour colour) {
+    push_vertex(renderer, x[0], y[0], colour);
+    push_vertex(renderer, x[1], y[1], colour);
+    push_vertex(renderer, x[2], y[2], colour);
+
+    push_vertex(renderer, x[0], y[0], colour);
+    push_vertex(renderer, x[2], y[2], colour);
+    push_vertex(renderer, x[3], y[3], colour);
+}
+
+static void push_rect(Renderer* renderer, float x0, float y0, float x1, float y1, RenderColour colour) {
+    float x[4] = { x0, x1, x1, x0 };
+    float y[4] = { y0, y0, y1, y1 };
+
+    push_quad(renderer, x, y, colour);
+}
+
+// The rover's frame: the same rotation as glRotatef(angle, 0, 0, -1), which the sandbox has always drawn it with.
+struct RoverFrame {
+    float x, y;
+    float cos_angle, sin_angle;
+};
+
+static RoverFrame rover_frame(float x, float y, float angle) {
+    float theta = angle * (float)M_PI / 180.0f;
+
+    return { x, y, cosf(theta), sinf(theta) };
+}
+
+static void to_world(const RoverFrame& frame, float local_x, float local_y, float* x, float* y) {
+    *x = frame.x + local_x * frame.cos_angle + local_y * frame.sin_angle;
+    *y = frame.y - local_x * frame.sin_angle + local_y * frame.cos_angle;
+}
+
+void render_hex_path(Renderer* renderer, const std::vector<HexCell>& path, float stroke_width) {
+    RenderColour colour = make_colour(1.0f, 0.5f, 0.0f, 1.0f);
+
+    for (HexCell cell : path) {
+        push_vertex(renderer, (3.0f/2.0f) * cell.q, (sqrtf(3.0f)/2.0f) * cell.q + sqrtf(3.0f) * cell.r, colour);
+    }
+
+    glLineWidth(stroke_width);
+
+    draw_vertices(renderer, GL_LINE_STRIP);
+}
+
+void render_rover(Renderer* renderer, float rover_x, float rover_y, float rover_width, float rover_height, float rover_angle) {
+    RoverFrame frame = rover_frame(rover_x, rover_y, rover_angle);
+
+    float body_x[4], body_y[4];
+    const float BODY_U[4] = { 0.5f, 0.5f, -0.5f, -0.5f };
+    const float BODY_V[4] = { 0.5f, -0.5f, -0.5f, 0.5f };
+
+    for (int i = 0; i < 4; i++) {
+        to_world(frame, BODY_U[i] * rover_width, BODY_V[i] * rover_height, &body_x[i], &body_y[i]);
+    }
+
+    push_quad(renderer, body_x, body_y, make_colour(0.0f, 0.0f, 1.0f, 1.0f));
+
+    // The "arrow".
+    const float ARROW_U[3] = { 0.0f, -0.25f, 0.25f };
+    const float ARROW_V[3] = { 0.25f, 0.0f, 0.0f };
+
+    for (int i = 0; i < 3; i++) {
+        float x, y;
+        to_world(frame, ARROW_U[i] * rover_width, ARROW_V[i] * rover_height, &x, &y);
+
+        push_vertex(renderer, x, y, make_colour(0.0f, 1.0f, 0.0f, 1.0f));
+    }
+
+    draw_vertices(renderer, GL_TRIANGLES);
+}
+
+void render_obstacles(Renderer* renderer, const Obstacle* obstacles, int count) {
+    RenderColour colour = make_colour(1.0f, 0.0f, 1.0f, 1.0f);
+
+    for (int i = 0; i < count; i++) {
+        const Obstacle& obstacle = obstacles[i];
+
+        push_rect(renderer, obstacle.x - 0.5f * obstacle.w, obstacle.y - 0.5f * obstacle.h, obstacle.x + 0.5f * obstacle.w, obstacle.y + 0.5f * obstacle.h, colour);
+    }
+
+    draw_vertices(renderer, GL_TRIANGLES);
+}
+
+// Brings the tile's texture up to date with its dirty rectangle, creating it the first time the tile is drawn.
+static GLuint update_occupancy_texture(Renderer* renderer, OccupancyTile* tile) {
+	auto found = renderer->occupancy_textures.find(tile);
+	GLuint texture;
+
+	if (found == renderer->occupancy_textures.end()) {
+		glGenTextures(1, &texture);
+		create_texture(texture, GL_ALPHA, OCCUPANCY_TILE_SIZE, NULL);
+
+		renderer->occupancy_textures[tile] = texture;
+
+		// The texture starts out undefined, so all of it needs filling whatever the tile says.
+		tile->dirty_x0 = 0;
+		tile->dirty_y0 = 0;
+		tile->dirty_x1 = OCCUPANCY_TILE_MASK;
+		tile->dirty_y1 = OCCUPANCY_TILE_MASK;
+	} else {
+		texture = found->second;
+		glBindTexture(GL_TEXTURE_2D, texture);
+	}
+
+	if (tile->dirty_x0 > tile->dirty_x1) return texture;
+
+	DirtyRect dirty = { tile->dirty_x0, tile->dirty_y0, tile->dirty_x1, tile->dirty_y1 };
+
+	for (int ly = dirty.y0; ly <= dirty.y1; ly++) {
+		for (int lx = dirty.x0; lx <= dirty.x1; lx++) {
+			int i = ly * OCCUPANCY_TILE_SIZE + lx;
+
+			renderer->occupancy_texels[i] = renderer->occupancy_palette[(uint8_t)tile->log_odds[i]];
+		}
+	}
+
+	upload_dirty_rect(renderer, GL_ALPHA, renderer->occupancy_texels, OCCUPANCY_TILE_SIZE, dirty);
+
+	reset_occupancy_tile_dirty(tile);
+
+	return texture;
+}
+
+void render_occupancy_map(Renderer* renderer, OccupancyMap* map, float view_min_x, float view_min_y, float view_max_x, float view_max_y) {
+	int x0 = (int)floorf(view_min_x / map->cell_size);
+	int y0 = (int)floorf(view_min_y / map->cell_size);
+	int x1 = (int)floorf(view_max_x / map->cell_size);
+	int y1 = (int)floorf(view_max_y / map->cell_size);
+
+	float tile_size = map->cell_size * OCCUPANCY_TILE_SIZE;
+
+	std::vector<TexturedVertex>& vertices = renderer->textured_vertices;
+	std::vector<GLuint> textures;
+
+	// Texture row ly is cell row ly, so v runs along y like the cells do.
+	for (int ty = y0 >> OCCUPANCY_TILE_SHIFT; ty <= y1 >> OCCUPANCY_TILE_SHIFT; ty++) {
+		for (int tx = x0 >> OCCUPANCY_TILE_SHIFT; tx <= x1 >> OCCUPANCY_TILE_SHIFT; tx++) {
+			OccupancyTile* tile = find_occupancy_tile(map, tx, ty);
+			if (!tile) continue;
+
+			textures.push_back(update_occupancy_texture(renderer, tile));
+
+			float left = tx * tile_size, top = ty * tile_size;
+
+			vertices.push_back({ left, top, 0.0f, 0.0f });
+			vertices.push_back({ left + tile_size, top, 1.0f, 0.0f });
+			vertices.push_back({ left + tile_size, top + tile_size, 1.0f, 1.0f });
+			vertices.push_back({ left, top + tile_size, 0.0f, 1.0f });
+		}
+	}
+
+	if (textures.empty()) {
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return;
+	}
+
+	// All the tiles' quads go up at once; only the texture changes between draws.
+	const char* base = upload(renderer, GL_ARRAY_BUFFER, renderer->vertex_buffer, vertices.data(), vertices.size() * sizeof(TexturedVertex), GL_STREAM_DRAW);
+
+	glEnable(GL_TEXTURE_2D);
+	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+
+	glVertexPointer(2, GL_FLOAT, sizeof(TexturedVertex), base + offsetof(TexturedVertex, x));
+	glTexCoordPointer(2, GL_FLOAT, sizeof(TexturedVertex), base + offsetof(TexturedVertex, u));
+
+	glColor4f(0.0f, 0.0f, 0.0f, 1.0f);
+
+	for (size_t i = 0; i < textures.size(); i++) {
+		glBindTexture(GL_TEXTURE_2D, textures[i]);
+		glDrawArrays(GL_QUADS, (GLint)(4 * i), 4);
+	}
+
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glDisable(GL_TEXTURE_2D);
+
+	unbind(renderer);
+
+	renderer->draw_calls += textures.size();
+	renderer->vertex_count += vertices.size();
+
+	vertices.clear();
+}
+
+void render_lidar_range(Renderer* renderer, LidarModel* model, float rover_x, float rover_y, float rover_angle) {
+    RoverFrame frame = rover_frame(rover_x, rover_y, rover_angle);
+    RenderColour colour = make_colour(1.0f, 0.564f, 0.141f, 0.75f);
+
+    push_vertex(renderer, rover_x, rover_y, colour);
+
+    for (int i = 0; i < model->beam_count; i++) {
+        float x, y;
+        to_world(frame, 10.0f * model->beam_cos[i], 10.0f * model->beam_sin[i], &x, &y);
+
+        push_vertex(renderer, x, y, colour);
+    }
+
+    draw_vertices(renderer, GL_TRIANGLE_FAN);
+}
+
+void render_lidar_points(Renderer* renderer, LidarModel* model, float rover_x, float rover_y, float rover_angle, const float* lidar_points, float max_distance, float pixels_per_meter) {
+    RoverFrame frame = rover_frame(rover_x, rover_y, rover_angle);
+    RenderColour colour = make_colour(0.0f, 1.0f, 0.0f, 1.0f);
+
+    // Squares are lined up with the rover, 4 pixels across at any zoom.
+    float hw = 2.0f / pixels_per_meter;
+
+    for (int i = 0; i < model->beam_count; i++) {
+        float distance = lidar_points[i];
+        if (distance > max_distance) continue;
+
+        float u = model->beam_cos[i] * distance, v = model->beam_sin[i] * distance;
+
+        float x[4], y[4];
+        to_world(frame, u + hw, v + hw, &x[0], &y[0]);
+        to_world(frame, u + hw, v - hw, &x[1], &y[1]);
+        to_world(frame, u - hw, v - hw, &x[2], &y[2]);
+        to_world(frame, u - hw, v + hw, &x[3], &y[3]);
+
+        push_quad(renderer, x, y, colour);
+    }
+
+    draw_vertices(renderer, GL_TRIANGLES);
+}
+
+#endif
@@ -0,0 +1,144 @@
+/*
+    Draws the sandbox from vertex buffers and textures instead of one glBegin/glEnd batch per hex, cell and point.
+
+    The hex grid's geometry (six corners per hex, with index lists for the fill triangles and the outlines) is built and
+    uploaded once, when the grid is first drawn. Each hex's corners sample one texel of a texture holding the grid's
+    shades, so when hexes change only the rectangle of texels around them is uploaded again. The occupancy map is drawn
+    the same way: every tile gets its own texture, and only the rectangle of cells the scans changed since the last
+    frame is converted (through a log-odds to alpha palette) and uploaded. The cost of a frame follows how much changed,
+    not how big the maps are.
+
+    Everything else (obstacles, LIDAR points, the rover and the path) is collected into one streamed vertex buffer per
+    draw, already in world coordinates, so each of them is a single draw call however many pieces it has.
+
+    Only needs OpenGL 1.5 (buffer objects) and the fixed-function pipeline, so it runs the same on Mesa's software
+    renderer (LIBGL_ALWAYS_SOFTWARE=1) as on a GPU. Without buffer objects it falls back to plain vertex arrays.
+    Drawing uses the current modelview matrix, like the rest of the sandbox's rendering.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include <GL/gl.h>
+
+#include "grid.hpp"
+#include "lidar_model.hpp"
+#include "obstacle.hpp"
+#include "occupancy.hpp"
+
+// Below this many pixels per hex side, the grid is drawn as a single image of its shades rather than as outlined
+// hexes, so zooming out over a big grid doesn't cost a triangle per hex.
+const float RENDER_HEX_DETAIL_PIXELS = 15.0f;
+
+struct RenderVertex {
+    float x, y;
+    uint8_t r, g, b, a;
+};
+
+struct RenderColour {
+    uint8_t r, g, b, a;
+};
+
+struct TexturedVertex {
+    float x, y;
+    float u, v;
+};
+
+// A rectangle of texels, inclusive. Empty when x0 > x1.
+struct DirtyRect {
+    int x0, y0, x1, y1;
+};
+
+struct Renderer {
+    // Whether buffer objects are available. If not, the arrays below are drawn straight from memory.
+    bool has_buffers;
+
+    // Hex grid geometry, in grid units, for a grid with this offset and size (size 0 until the first update).
+    int grid_offset;
+    int grid_size;
+
+    std::vector<float> hex_positions;
+    std::vector<float> hex_texcoords;
+
+    // Indices of the hexes in view, for the fill triangles and the outlines, and where the origin's outline starts
+    // among them (-1 when it's out of view). Only rebuilt when a different set of hexes comes into view.
+    std::vector<uint32_t> hex_fill_indices;
+    std::vector<uint32_t> hex_outline_indices;
+    int hex_visible_origin;
+
+    // The first q in view, then the first and last r in view for each q from there, as the index lists were built
+    // for. hex_culled_rows is where the current view's are worked out to compare.
+    std::vector<int> hex_visible_rows;
+    std::vector<int> hex_culled_rows;
+
+    GLuint hex_position_buffer;
+    GLuint hex_texcoord_buffer;
+    GLuint hex_fill_buffer;
+    GLuint hex_outline_buffer;
+
+    // One luminance texel per hex, grid_size by grid_size, row u = q + offset and column v = r + offset. The texture
+    // is rounded up to a power of two.
+    std::vector<uint8_t> hex_shades;
+    GLuint hex_texture;
+    int hex_texture_size;
+
+    // Hexes whose shade has changed since it was last uploaded.
+    DirtyRect hex_dirty;
+
+    // The texture for each occupancy tile that has been drawn. Tiles are pooled, so they keep their texture when the
+    // map is cleared; a tile handed out again is dirty all over.
+    std::unordered_map<const OccupancyTile*, GLuint> occupancy_textures;
+
+    // Alpha for every log-odds, indexed by the log-odds' byte.
+    uint8_t occupancy_palette[256];
+
+    // Where a tile's dirty cells are converted before they're uploaded.
+    uint8_t occupancy_texels[OCCUPANCY_TILE_SIZE * OCCUPANCY_TILE_SIZE];
+
+    // Streamed geometry, refilled for every draw.
+    std::vector<RenderVertex> vertices;
+    std::vector<TexturedVertex> textured_vertices;
+    GLuint vertex_buffer;
+
+    // Counted since the last reset_render_stats.
+    long draw_calls;
+    long vertex_count;
+    long texels_uploaded;
+};
+
+// Needs a current OpenGL context.
+Renderer* create_renderer();
+
+// Needs the same context to still be current.
+void destroy_renderer(Renderer* renderer);
+
+void reset_render_stats(Renderer* renderer);
+
+// Brings the hex shades up to date with the grid. If changed is NULL every hex is refreshed (always the case the first
+// time, or when the grid is a different size), otherwise only the changed ones are.
+void update_render_grid(Renderer* renderer, const Grid<float>* grid, const HexCell* changed, int changed_count);
+
+// Draws the hexes from the last update_render_grid that overlap the view (in grid units), shaded by value and outlined,
+// with the origin hex outlined in green. pixels_per_unit is the zoom, in pixels per hex side; zoomed out past
+// RENDER_HEX_DETAIL_PIXELS the whole grid is drawn as one image, without outlines.
+void render_grid(Renderer* renderer, float stroke_width, float view_min_x, float view_min_y, float view_max_x, float view_max_y, float pixels_per_unit);
+
+// Draws a line through the centers of the hexes on a path, in grid units.
+void render_hex_path(Renderer* renderer, const std::vector<HexCell>& path, float stroke_width);
+
+void render_rover(Renderer* renderer, float rover_x, float rover_y, float rover_width, float rover_height, float rover_angle);
+
+void render_obstacles(Renderer* renderer, const Obstacle* obstacles, int count);
+
+// Draws the cells of the map inside the given world-space rectangle that are more likely occupied than not. Resets the
+// dirty rectangles of the tiles it uploads, so it should be the only thing using them.
+void render_occupancy_map(Renderer* renderer, OccupancyMap* map, float view_min_x, float view_min_y, float view_max_x, float view_max_y);
+
+void render_lidar_range(Renderer* renderer, LidarModel* model, float rover_x, float rover_y, float rover_angle);
+
+// Draws a small square (4 pixels across) at every return closer than max_distance.
+void render_lidar_points(Renderer* renderer, LidarModel* model, float rover_x, float rover_y, float rover_angle, const float* lidar_points, float max_distance, float pixels_per_meter);
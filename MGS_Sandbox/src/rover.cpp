@@ -0,0 +1,55 @@
+#include <math.h>
+#include <string.h>
+
+#include "rover.hpp"
+
+void step_rover(RoverPose* pose, float speed, float dangle) {
+    pose->angle += dangle;
+    pose->x += speed * cosf((pose->angle + 90) * M_PI / 180.0f);
+    pose->y += speed * sinf((pose->angle + 90) * M_PI / 180.0f);
+}
+
+bool load_rover_path(FILE* in_file, RoverPose start, std::vector<RoverPose>& poses) {
+    RoverPose pose = start;
+
+    char line[1024];
+    int line_number = 0;
+
+    while (fgets(line, sizeof(line), in_file)) {
+        line_number++;
+
+        char command[32];
+        if (sscanf(line, "%31s", command) != 1 || command[0] == '#') continue;
+
+        if (strcmp(command, "pose") == 0) {
+            if (sscanf(line, "%*s %f %f %f", &pose.x, &pose.y, &pose.angle) != 3) {
+                printf("[!] Path line %d: expected 'pose <x> <y> <angle>'.\n", line_number);
+                return false;
+            }
+
+            poses.push_back(pose);
+        } else if (strcmp(command, "drive") == 0) {
+            int frames;
+            float speed, dangle;
+
+            if (sscanf(line, "%*s %d %f %f", &frames, &speed, &dangle) != 3) {
+                printf("[!] Path line %d: expected 'drive <frames> <speed> <dangle>'.\n", line_number);
+                return false;
+            }
+
+            for (int i = 0; i < frames; i++) {
+                step_rover(&pose, speed, dangle);
+                poses.push_back(pose);
+            }
+        } else {
+            printf("[!] Path line %d: unknown command '%s'.\n", line_number, command);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void record_rover_pose(FILE* out_file, RoverPose pose) {
+    fprintf(out_file, "pose %f %f %f\n", pose.x, pose.y, pose.angle);
+}
@@ -0,0 +1,27 @@
+/*
+    Rover motion, and scripted or recorded rover paths (.mgspath files).
+
+    A path file has one command per line:
+        pose <x> <y> <angle>              Puts the rover at the given pose.
+        drive <frames> <speed> <dangle>   Drives for the given number of frames, the same way the arrow keys do.
+*/
+
+#pragma once
+
+#include <stdio.h>
+
+#include <vector>
+
+struct RoverPose {
+    float x, y, angle;
+};
+
+// Advances the rover by one frame. dangle is in degrees per frame, speed in meters per frame.
+void step_rover(RoverPose* pose, float speed, float dangle);
+
+// Appends one pose per frame of the path to poses. Drive commands start from the last pose (or start, if there is none yet).
+// Returns false if the file has a line it doesn't understand.
+bool load_rover_path(FILE* in_file, RoverPose start, std::vector<RoverPose>& poses);
+
+// Writes a pose line, for recording a path that load_rover_path can play back.
+void record_rover_pose(FILE* out_file, RoverPose pose);
@@ -0,0 +1,150 @@
+#include <math.h>
+
+#include "scan_cache.hpp"
+
+ScanCache* create_scan_cache() {
+    ScanCache* cache = new ScanCache;
+
+    cache->valid = false;
+    cache->full_scans = 0;
+    cache->partial_scans = 0;
+    cache->reused_scans = 0;
+    cache->rescanned_beams = 0;
+
+    return cache;
+}
+
+void destroy_scan_cache(ScanCache* cache) {
+    delete cache;
+}
+
+void invalidate_scan_cache(ScanCache* cache) {
+    cache->valid = false;
+}
+
+// Marks every beam that could hit the obstacle from (x, y). Returns false if that can't be narrowed down (the rover is
+// inside the obstacle), in which case every beam needs rescanning.
+static bool mark_obstacle_beams(LidarModel* model, float x, float y, float angle, float max_scan_distance, Obstacle obs, std::vector<bool>& dirty) {
+    float x0 = obs.x - obs.w/2.0f, x1 = obs.x + obs.w/2.0f;
+    float y0 = obs.y - obs.h/2.0f, y1 = obs.y + obs.h/2.0f;
+
+    // Nothing to do if it's out of range.
+    float dx = fmaxf(fmaxf(x0 - x, x - x1), 0.0f);
+    float dy = fmaxf(fmaxf(y0 - y, y - y1), 0.0f);
+
+    if (dx * dx + dy * dy > max_scan_distance * max_scan_distance) return true;
+    if (dx == 0.0f && dy == 0.0f) return false;
+
+    // The rover is outside the rectangle, so its corners span less than 180 degrees as seen from the rover. Measure
+    // them relative to the direction of the center to get that span without worrying about wrapping around.
+    float center = atan2f(obs.y - y, obs.x - x) * 180.0f / M_PI;
+
+    float corners_x[4] = { x0, x1, x1, x0 };
+    float corners_y[4] = { y0, y0, y1, y1 };
+
+    float lo = 0, hi = 0;
+
+    for (int i = 0; i < 4; i++) {
+        float rel = atan2f(corners_y[i] - y, corners_x[i] - x) * 180.0f / M_PI - center;
+
+        if (rel > 180.0f) rel -= 360.0f;
+        if (rel < -180.0f) rel += 360.0f;
+
+        lo = fminf(lo, rel);
+        hi = fmaxf(hi, rel);
+    }
+
+    // Beam angles are relative to the rover's heading, and get an extra beam either side for rounding.
+    lo += center - angle - model->angle_step;
+    hi += center - angle + model->angle_step;
+
+    // Move the span so it starts within a turn after the first beam, then mark it, and whatever wraps past 360.
+    float turns = floorf((lo - model->min_angle) / 360.0f);
+    lo -= 360.0f * turns;
+    hi -= 360.0f * turns;
+
+    for (int wrap = 0; wrap < 2; wrap++) {
+        float span_lo = lo - 360.0f * wrap;
+        float span_hi = hi - 360.0f * wrap;
+
+        int first = (int)ceilf((span_lo - model->min_angle) / model->angle_step);
+        int last = (int)floorf((span_hi - model->min_angle) / model->angle_step);
+
+        if (first < 0) first = 0;
+        if (last > model->beam_count - 1) last = model->beam_count - 1;
+
+        for (int i = first; i <= last; i++) {
+            dirty[i] = true;
+        }
+    }
+
+    return true;
+}
+
+bool scan_world_cached(World* world, ScanCache* cache, WorkerPool* pool, LidarModel* model, LidarEngine engine, float x, float y, float angle, float max_scan_distance) {
+    bool same_scan = cache->valid && cache->x == x && cache->y == y && cache->angle == angle && cache->model == model && cache->engine == engine && cache->max_scan_distance == max_scan_distance;
+
+    if (same_scan && cache->world_version == world->version) {
+        cache->reused_scans++;
+        return false;
+    }
+
+    if (same_scan && cache->world_version >= world->changes_start_version) {
+        std::vector<bool> dirty(model->beam_count, false);
+        bool everything = false;
+
+        for (WorldChange& change : world->changes) {
+            if (change.version <= cache->world_version) continue;
+
+            if (!mark_obstacle_beams(model, x, y, angle, max_scan_distance, change.obstacle, dirty)) {
+                everything = true;
+                break;
+            }
+        }
+
+        if (!everything) {
+            // Rescan each run of dirty beams.
+            for (int begin = 0; begin < model->beam_count;) {
+                if (!dirty[begin]) {
+                    begin++;
+                    continue;
+                }
+
+                int end = begin;
+                while (end < model->beam_count && dirty[end]) end++;
+
+                scan_world_beams(world, model, engine, x, y, angle, cache->ranges.data(), max_scan_distance, begin, end);
+                cache->rescanned_beams += end - begin;
+
+                begin = end;
+            }
+
+            cache->world_version = world->version;
+            cache->partial_scans++;
+
+            return true;
+        }
+    }
+
+    cache->ranges.resize(model->beam_count);
+
+    if (pool) {
+        scan_world_parallel(world, pool, model, engine, x, y, angle, cache->ranges.data(), max_scan_distance);
+    } else {
+        scan_world(world, model, engine, x, y, angle, cache->ranges.data(), max_scan_distance);
+    }
+
+    cache->valid = true;
+    cache->x = x;
+    cache->y = y;
+    cache->angle = angle;
+    cache->max_scan_distance = max_scan_distance;
+    cache->model = model;
+    cache->engine = engine;
+    cache->world_version = world->version;
+
+    cache->full_scans++;
+    cache->rescanned_beams += model->beam_count;
+
+    return true;
+}
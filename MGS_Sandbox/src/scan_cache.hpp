@@ -0,0 +1,45 @@
+/*
+    Reuses the last LIDAR scan when nothing it depends on has changed.
+
+    If the rover hasn't moved, the last scan is handed back as is. If a few obstacles were added or removed since,
+    only the beams whose angular span covers those obstacles are rescanned. Anything else (the rover moving, a
+    different model or engine, the world being replaced, or too many edits at once) falls back to a full scan.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "lidar_model.hpp"
+#include "world.hpp"
+
+struct ScanCache {
+    bool valid;
+
+    // What the cached scan was taken with.
+    float x, y, angle;
+    float max_scan_distance;
+    LidarModel* model;
+    LidarEngine engine;
+    uint64_t world_version;
+
+    std::vector<float> ranges;
+
+    // Counters, for seeing how much the cache is saving.
+    long full_scans;
+    long partial_scans;
+    long reused_scans;
+    long rescanned_beams;
+};
+
+ScanCache* create_scan_cache();
+
+void destroy_scan_cache(ScanCache* cache);
+
+// Forgets the cached scan, so the next one is a full scan.
+void invalidate_scan_cache(ScanCache* cache);
+
+// Brings cache->ranges up to date for the given pose, rescanning as little as possible, and returns whether any
+// range might have changed. The ranges are exactly what scan_world would return. pool may be NULL; if it isn't, full
+// scans are split across it.
+bool scan_world_cached(World* world, ScanCache* cache, WorkerPool* pool, LidarModel* model, LidarEngine engine, float x, float y, float angle, float max_scan_distance);
@@ -0,0 +1,532 @@
+#include <math.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include "hex_dstar.hpp"
+#include "hex_lidar.hpp"
+#include "hex_pyramid.hpp"
+#include "scan_cache.hpp"
+#include "simulation.hpp"
+#include "triple_buffer.hpp"
+
+void clear_sim_changes(SimChanges* changes) {
+    changes->steps.clear();
+    changes->patches.clear();
+    changes->cells.clear();
+    changes->hexes.clear();
+}
+
+// Drops the steps up to and including up_to_step, which the reader already has.
+static void trim_sim_changes(SimChanges* changes, uint64_t up_to_step) {
+    size_t keep = 0;
+    while (keep < changes->steps.size() && changes->steps[keep].step <= up_to_step) keep++;
+
+    if (keep == 0) return;
+
+    if (keep == changes->steps.size()) {
+        clear_sim_changes(changes);
+        return;
+    }
+
+    const SimStepChanges& first = changes->steps[keep];
+
+    uint32_t first_patch = first.first_patch;
+    uint32_t first_hex = first.first_hex;
+
+    // The steps kept may not have any patches at all.
+    uint32_t first_cell = first_patch < changes->patches.size() ? changes->patches[first_patch].first_cell : (uint32_t)changes->cells.size();
+
+    changes->steps.erase(changes->steps.begin(), changes->steps.begin() + keep);
+    changes->patches.erase(changes->patches.begin(), changes->patches.begin() + first_patch);
+    changes->cells.erase(changes->cells.begin(), changes->cells.begin() + first_cell);
+    changes->hexes.erase(changes->hexes.begin(), changes->hexes.begin() + first_hex);
+
+    for (SimStepChanges& step : changes->steps) {
+        step.first_patch -= first_patch;
+        step.first_hex -= first_hex;
+    }
+
+    for (OccupancyPatch& patch : changes->patches) {
+        patch.first_cell -= first_cell;
+    }
+}
+
+void apply_sim_changes(const SimChanges& changes, uint64_t after_step, OccupancyMap* map, Grid<float>* grid, std::vector<HexCell>* changed_hexes) {
+    for (const SimStepChanges& step : changes.steps) {
+        if (step.step <= after_step) continue;
+
+        if (step.occupancy_cleared) clear_occupancy_map(map);
+
+        for (uint32_t i = step.first_patch; i < step.first_patch + step.patch_count; i++) {
+            const OccupancyPatch& patch = changes.patches[i];
+
+            write_occupancy_cells(map, patch.tx, patch.ty, patch.x0, patch.y0, patch.x1, patch.y1, &changes.cells[patch.first_cell]);
+        }
+
+        for (uint32_t i = step.first_hex; i < step.first_hex + step.hex_count; i++) {
+            const HexChange& change = changes.hexes[i];
+
+            grid->set(change.cell.q, change.cell.r, change.value);
+            if (changed_hexes) changed_hexes->push_back(change.cell);
+        }
+    }
+}
+
+struct Simulation {
+    SimConfig config;
+
+    std::thread thread;
+    std::atomic<bool> quit;
+    std::atomic<bool> finished;
+
+    std::mutex command_mutex;
+    std::vector<SimCommand> commands;
+
+    TripleBuffer<SimState> states;
+
+    // What the reader last took, so the simulation can stop sending what it already has. Read without ever waiting,
+    // and an out of date value only means sending a little more than needed.
+    std::atomic<uint64_t> taken_step;
+
+    // Everything below is only touched by the simulation thread.
+    uint64_t step;
+
+    RoverPose rover;
+    float rover_speed, rover_dangle;
+
+    // How far into the path (or recording) the rover is, in frames.
+    double frame;
+    uint64_t recorded_frames;
+    FILE* path_file;
+
+    LidarModel* lidar_model;
+    LidarEngine engine;
+    bool parallel_scan;
+
+    ScanCache* scan_cache;
+
+    // Time spent scanning with the current engine, for SIM_COMMAND_NEXT_ENGINE to report.
+    std::chrono::steady_clock::duration scan_time;
+    int scan_count;
+
+    OccupancyMap* occupancy_map;
+    bool occupancy_cleared;
+
+    HexPyramid* hex_pyramid;
+    HexDStar* planner;
+    bool has_goal;
+    std::vector<HexCell> path;
+    std::vector<HexCell> changed_hexes;
+
+    // Map changes the reader hasn't taken yet.
+    SimChanges changes;
+
+    // The obstacles as of world version obstacles_version, shared by the states published since.
+    std::shared_ptr<const std::vector<Obstacle>> obstacles;
+    uint64_t obstacles_version;
+};
+
+static void run_command(Simulation* sim, const SimCommand& command) {
+    World* world = sim->config.world;
+
+    switch (command.type) {
+        case SIM_COMMAND_DRIVE:
+            sim->rover_speed = command.speed;
+            sim->rover_dangle = command.dangle;
+            break;
+        case SIM_COMMAND_ADD_OBSTACLE:
+            if (sim->config.streamer) {
+                printf("[!] Streamed worlds can't be edited.\n");
+            } else {
+                add_obstacle(world, command.obstacle);
+            }
+            break;
+        case SIM_COMMAND_UNDO_OBSTACLE:
+            if (sim->config.streamer) {
+                printf("[!] Streamed worlds can't be edited.\n");
+            } else if (world->obstacles.size() != 0) {
+                printf("> Undoing last placed obstacle.\n");
+
+                remove_last_obstacle(world);
+            }
+            break;
+        case SIM_COMMAND_SAVE_LEVEL:
+            printf("> Saving current level (%s).\n", command.format == LEVEL_FORMAT_BINARY ? "binary" : "text");
+
+            save_level("level.mgslevel", world->obstacles, command.format);
+            break;
+        case SIM_COMMAND_CLEAR_OCCUPANCY:
+            printf("> Clearing the occupancy map.\n");
+
+            clear_occupancy_map(sim->occupancy_map);
+            sim->occupancy_cleared = true;
+            break;
+        case SIM_COMMAND_SET_GOAL:
+            sim->has_goal = hex_dstar_set_goal(sim->planner, &sim->hex_pyramid->levels[0], command.q, command.r);
+
+            if (sim->has_goal) {
+                printf("> Planning a path to hex (%d, %d).\n", command.q, command.r);
+            } else {
+                printf("[!] Hex (%d, %d) is off the grid.\n", command.q, command.r);
+                sim->path.clear();
+            }
+            break;
+        case SIM_COMMAND_NEXT_ENGINE:
+            if (sim->scan_count != 0) {
+                double ms = 1000.0 * std::chrono::duration<double>(sim->scan_time).count() / sim->scan_count;
+                printf("> LIDAR engine '%s' took %.3f ms per scan.\n", lidar_engine_name(sim->engine), ms);
+            }
+
+            sim->engine = (LidarEngine)((sim->engine + 1) % LIDAR_ENGINE_COUNT);
+            sim->scan_time = std::chrono::steady_clock::duration(0);
+            sim->scan_count = 0;
+
+            if (sim->engine == LIDAR_ENGINE_SIMD) {
+                printf("> Switched to the '%s' LIDAR engine (%s kernel).\n", lidar_engine_name(sim->engine), obstacle_set_kernel_name(obstacle_set_kernel()));
+            } else if (sim->engine == LIDAR_ENGINE_SDF && !world->distance_field) {
+                printf("> Switched to the '%s' LIDAR engine (no distance field for this world, so it scans with the grid).\n", lidar_engine_name(sim->engine));
+            } else {
+                printf("> Switched to the '%s' LIDAR engine.\n", lidar_engine_name(sim->engine));
+            }
+            break;
+        case SIM_COMMAND_TOGGLE_PARALLEL:
+            if (!sim->config.pool) break;
+
+            sim->parallel_scan = !sim->parallel_scan;
+
+            if (sim->parallel_scan) {
+                printf("> Scanning on %d threads.\n", worker_pool_thread_count(sim->config.pool));
+            } else {
+                printf("> Scanning on the simulation thread.\n");
+            }
+            break;
+        case SIM_COMMAND_SWITCH_LIDAR_MODEL:
+            if (!sim->config.alternate_lidar_model) break;
+
+            sim->lidar_model = sim->lidar_model == sim->config.lidar_model ? sim->config.alternate_lidar_model : sim->config.lidar_model;
+
+            printf("> Simulating a LIDAR with %d beams.\n", sim->lidar_model->beam_count);
+            break;
+        case SIM_COMMAND_TOGGLE_RECORDING:
+            if (sim->path_file) {
+                printf("> Stopped recording the rover path.\n");
+
+                fclose(sim->path_file);
+                sim->path_file = NULL;
+            } else {
+                printf("> Recording the rover path to path.mgspath.\n");
+
+                sim->path_file = fopen("path.mgspath", "w");
+            }
+            break;
+        case SIM_COMMAND_TOGGLE_DISTANCE_FIELD:
+            if (sim->config.streamer) {
+                printf("[!] Streamed worlds change too much as the rover drives to keep a distance field.\n");
+                break;
+            }
+
+            world->distance_field_cell_size = world->distance_field_cell_size > 0 ? 0 : DISTANCE_FIELD_CELL_SIZE;
+            update_world(world);
+
+            if (world->distance_field) {
+                printf("> Baked the level into a distance field of %d x %d cells.\n", world->distance_field->width, world->distance_field->height);
+            } else if (world->distance_field_cell_size > 0) {
+                printf("[!] The level needs more than %zu cells for a distance field, so it doesn't get one.\n", DISTANCE_FIELD_MAX_CELLS);
+            } else {
+                printf("> Dropped the distance field.\n");
+            }
+            break;
+    }
+}
+
+// Whether the distance field says moving the rover to next would run its footprint into an obstacle. Moves that get it
+// further from them are always allowed, so it can back out of one it was already in (say, one just placed on it).
+static bool rover_blocked(Simulation* sim, RoverPose next) {
+    World* world = sim->config.world;
+    if (world->distance_field_cell_size <= 0) return false;
+
+    // Obstacles placed since the last LIDAR step count too.
+    update_world(world);
+    if (!world->distance_field) return false;
+
+    float clearance = distance_field_clearance(world->distance_field, next.x, next.y);
+    if (clearance >= sim->config.rover_radius) return false;
+
+    return clearance < distance_field_clearance(world->distance_field, sim->rover.x, sim->rover.y);
+}
+
+// Moves the rover on by one physics step. Returns false once a path has been driven to its end.
+static bool step_physics(Simulation* sim) {
+    const double FRAMES_PER_STEP = (double)SIM_FRAME_HZ / SIM_PHYSICS_HZ;
+
+    sim->frame += FRAMES_PER_STEP;
+
+    if (sim->config.path) {
+        const std::vector<RoverPose>& path = *sim->config.path;
+
+        size_t frame = (size_t)sim->frame;
+        if (frame >= path.size()) return false;
+
+        sim->rover = path[frame];
+    } else {
+        RoverPose next = sim->rover;
+        step_rover(&next, sim->rover_speed * (float)FRAMES_PER_STEP, sim->rover_dangle * (float)FRAMES_PER_STEP);
+
+        if (!rover_blocked(sim, next)) sim->rover = next;
+    }
+
+    // Recordings are played back a pose per frame, so only write one when a frame has gone by.
+    if (sim->path_file) {
+        while (sim->recorded_frames < (uint64_t)sim->frame) {
+            record_rover_pose(sim->path_file, sim->rover);
+            sim->recorded_frames++;
+        }
+    } else {
+        sim->recorded_frames = (uint64_t)sim->frame;
+    }
+
+    return true;
+}
+
+// Adds what the occupancy map and hex grid changed this step to the changes the reader hasn't had yet.
+static void log_map_changes(Simulation* sim) {
+    SimChanges& changes = sim->changes;
+
+    SimStepChanges step;
+    step.step = sim->step;
+    step.occupancy_cleared = sim->occupancy_cleared;
+    step.first_patch = (uint32_t)changes.patches.size();
+    step.first_hex = (uint32_t)changes.hexes.size();
+
+    for (OccupancyTile* tile : sim->occupancy_map->tiles) {
+        if (tile->dirty_x0 > tile->dirty_x1) continue;
+
+        OccupancyPatch patch = { tile->tx, tile->ty, tile->dirty_x0, tile->dirty_y0, tile->dirty_x1, tile->dirty_y1, (uint32_t)changes.cells.size() };
+
+        for (int ly = patch.y0; ly <= patch.y1; ly++) {
+            const int8_t* row = &tile->log_odds[ly * OCCUPANCY_TILE_SIZE];
+            changes.cells.insert(changes.cells.end(), row + patch.x0, row + patch.x1 + 1);
+        }
+
+        changes.patches.push_back(patch);
+        reset_occupancy_tile_dirty(tile);
+    }
+
+    const Grid<float>& grid = sim->hex_pyramid->levels[0];
+
+    for (HexCell cell : sim->changed_hexes) {
+        changes.hexes.push_back({ cell, grid.get(cell.q, cell.r) });
+    }
+
+    step.patch_count = (uint32_t)changes.patches.size() - step.first_patch;
+    step.hex_count = (uint32_t)changes.hexes.size() - step.first_hex;
+
+    if (step.occupancy_cleared || step.patch_count != 0 || step.hex_count != 0) changes.steps.push_back(step);
+
+    sim->occupancy_cleared = false;
+}
+
+static void step_lidar(Simulation* sim) {
+    World* world = sim->config.world;
+
+    if (sim->config.streamer) {
+        // Ask for a bit more than the LIDAR range, so chunks are usually loaded before the rover can see them.
+        update_chunk_streamer(sim->config.streamer, sim->rover.x, sim->rover.y, 30.0f, false);
+
+        if (collect_resident_obstacles(sim->config.streamer, world->obstacles)) mark_world_changed(world);
+    }
+
+    RoverPose rover = sim->rover;
+
+    std::chrono::steady_clock::time_point scan_start = std::chrono::steady_clock::now();
+
+    bool scan_changed = scan_world_cached(world, sim->scan_cache, sim->parallel_scan ? sim->config.pool : NULL, sim->lidar_model, sim->engine, rover.x, rover.y, rover.angle, 20.0f);
+
+    if (scan_changed) {
+        sim->scan_time += std::chrono::steady_clock::now() - scan_start;
+        sim->scan_count++;
+    }
+
+    const float* ranges = sim->scan_cache->ranges.data();
+
+    // Fusing the same scan again would only make the maps more sure of themselves.
+    if (scan_changed) {
+        update_occupancy_map(sim->occupancy_map, sim->lidar_model, sim->config.occupancy_update, rover.x, rover.y, rover.angle, ranges, 10.0f);
+
+        // The hex grid darkens where the LIDAR keeps seeing something.
+        project_lidar_to_grid(sim->hex_pyramid, sim->lidar_model, sim->config.hex_size, rover.x, rover.y, rover.angle, ranges, 10.0f, HEX_FUSION_BLEND, 0.25f, &sim->changed_hexes);
+    }
+
+    if (sim->has_goal) {
+        int rover_q, rover_r;
+        world_to_axial(&rover.x, &rover.y, 1, sim->config.hex_size, &rover_q, &rover_r);
+
+        hex_dstar_plan(sim->planner, &sim->hex_pyramid->levels[0], rover_q, rover_r, sim->changed_hexes.data(), (int)sim->changed_hexes.size(), sim->path);
+    }
+
+    log_map_changes(sim);
+
+    sim->changed_hexes.clear();
+}
+
+static void publish_state(Simulation* sim, bool finished) {
+    SimState& state = sim->states.write_value();
+    World* world = sim->config.world;
+
+    trim_sim_changes(&sim->changes, sim->taken_step.load(std::memory_order_relaxed));
+
+    state.step = sim->step;
+    state.time = (double)sim->step / SIM_PHYSICS_HZ;
+    state.rover = sim->rover;
+
+    // Until the first scan with a newly switched model, the ranges are still the old model's.
+    state.lidar_model = sim->scan_cache->valid ? sim->scan_cache->model : sim->lidar_model;
+    state.ranges = sim->scan_cache->ranges;
+
+    state.has_goal = sim->has_goal;
+    state.path = sim->path;
+
+    if (world->version != sim->obstacles_version) {
+        sim->obstacles = std::make_shared<const std::vector<Obstacle>>(world->obstacles);
+        sim->obstacles_version = world->version;
+    }
+
+    state.world_version = sim->obstacles_version;
+    state.obstacles = sim->obstacles;
+
+    state.changes = sim->changes;
+    state.finished = finished;
+
+    sim->states.publish();
+}
+
+static void simulation_main(Simulation* sim) {
+    typedef std::chrono::steady_clock Clock;
+
+    const int PHYSICS_STEPS_PER_LIDAR_STEP = SIM_PHYSICS_HZ / SIM_LIDAR_HZ;
+
+    Clock::time_point start = Clock::now();
+
+    std::vector<SimCommand> commands;
+
+    while (!sim->quit.load(std::memory_order_relaxed)) {
+        {
+            std::lock_guard<std::mutex> lock(sim->command_mutex);
+            commands.swap(sim->commands);
+        }
+
+        for (const SimCommand& command : commands) run_command(sim, command);
+        commands.clear();
+
+        if (!step_physics(sim)) break;
+
+        sim->step++;
+
+        if (sim->step % PHYSICS_STEPS_PER_LIDAR_STEP == 0) step_lidar(sim);
+
+        publish_state(sim, false);
+
+        // Sleep until the real time this step is due at (which is now, when running flat out or behind).
+        if (sim->config.time_scale > 0) {
+            double due = (double)sim->step / SIM_PHYSICS_HZ / sim->config.time_scale;
+
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(due)));
+        }
+    }
+
+    publish_state(sim, true);
+
+    sim->finished.store(true);
+}
+
+Simulation* start_simulation(const SimConfig& config) {
+    Simulation* sim = new Simulation;
+
+    sim->config = config;
+    sim->quit = false;
+    sim->finished = false;
+
+    sim->taken_step = 0;
+
+    sim->step = 0;
+
+    sim->rover = config.path ? (*config.path)[0] : config.start;
+    sim->rover_speed = 0;
+    sim->rover_dangle = 0;
+
+    sim->frame = 0;
+    sim->recorded_frames = 0;
+    sim->path_file = NULL;
+
+    sim->lidar_model = config.lidar_model;
+    sim->engine = config.engine;
+    sim->parallel_scan = false;
+
+    sim->scan_cache = create_scan_cache();
+    sim->scan_time = std::chrono::steady_clock::duration(0);
+    sim->scan_count = 0;
+
+    sim->occupancy_map = create_occupancy_map(config.occupancy_cell_size);
+    sim->occupancy_cleared = false;
+
+    // Levels of 1, 2, 4 and 8 hexes, so whole regions can be ruled out at once.
+    sim->hex_pyramid = create_hex_pyramid(config.hex_radius, 4, HEX_AGGREGATE_MAX, 0.5f);
+
+    // The rover's path is repaired every LIDAR step for the hexes the scan changed.
+    sim->planner = create_hex_dstar(&sim->hex_pyramid->levels[0], 4.0f, 0.5f);
+    sim->has_goal = false;
+
+    sim->obstacles_version = UINT64_MAX;
+
+    // The first state is published before the thread starts, so there's always one to take. It has no scan yet.
+    update_world(config.world);
+    sim->scan_cache->ranges.assign(sim->lidar_model->beam_count, INFINITY);
+
+    publish_state(sim, false);
+
+    sim->thread = std::thread(simulation_main, sim);
+
+    return sim;
+}
+
+void stop_simulation(Simulation* sim) {
+    sim->quit.store(true);
+    if (sim->thread.joinable()) sim->thread.join();
+
+    if (sim->path_file) fclose(sim->path_file);
+
+    destroy_hex_dstar(sim->planner);
+    destroy_hex_pyramid(sim->hex_pyramid);
+    destroy_occupancy_map(sim->occupancy_map);
+    destroy_scan_cache(sim->scan_cache);
+
+    delete sim;
+}
+
+void wait_for_simulation(Simulation* sim) {
+    if (sim->thread.joinable()) sim->thread.join();
+}
+
+void send_sim_command(Simulation* sim, const SimCommand& command) {
+    std::lock_guard<std::mutex> lock(sim->command_mutex);
+
+    sim->commands.push_back(command);
+}
+
+const SimState* take_sim_state(Simulation* sim) {
+    if (!sim->states.take()) return NULL;
+
+    const SimState& state = sim->states.read_value();
+
+    sim->taken_step.store(state.step, std::memory_order_relaxed);
+
+    return &state;
+}
+
+OccupancyMap* simulation_occupancy_map(Simulation* sim) {
+    return sim->finished.load() ? sim->occupancy_map : NULL;
+}
@@ -0,0 +1,195 @@
+/*
+    Runs the rover, the LIDAR and the maps on their own thread at a fixed timestep, so how fast the world moves and
+    how often it's sensed don't depend on the display.
+
+    Physics (moving the rover) steps at SIM_PHYSICS_HZ, and every SIM_PHYSICS_HZ / SIM_LIDAR_HZ physics steps there's
+    a LIDAR step: a scan, the occupancy map and hex grid updates, and replanning. The sandbox sends commands (a lock
+    guards the queue, there are only ever a few a second) and reads the simulation's state back through a
+    TripleBuffer: a SimState is published after every physics step without waiting, and the render loop takes the
+    latest one, also without waiting. A slow frame can't stall sensing, and a slow scan can't stall drawing.
+
+    The maps are too big to copy every step, so a SimState carries their changes instead: the hexes that changed, and
+    the rectangles of occupancy cells the scans changed, for every step since the last state the reader took.
+    apply_sim_changes keeps copies of the maps up to date with them.
+
+    The clock can run faster than real time (time_scale), or as fast as the steps go, for headless runs.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memory>
+#include <vector>
+
+#include "chunked_world.hpp"
+#include "grid.hpp"
+#include "level.hpp"
+#include "lidar_model.hpp"
+#include "obstacle.hpp"
+#include "occupancy.hpp"
+#include "rover.hpp"
+#include "worker_pool.hpp"
+#include "world.hpp"
+
+const int SIM_PHYSICS_HZ = 200;
+const int SIM_LIDAR_HZ = 40;
+
+static_assert(SIM_PHYSICS_HZ % SIM_LIDAR_HZ == 0, "LIDAR steps have to land on physics steps.");
+
+// Rover speeds and rover paths are per frame at this rate, which is what the sandbox's render loop used to step them
+// at.
+const int SIM_FRAME_HZ = 60;
+
+// A rectangle of cells a step changed in one occupancy tile, inclusive, with the cells row by row from first_cell in
+// SimChanges::cells.
+struct OccupancyPatch {
+    int32_t tx, ty;
+    uint8_t x0, y0, x1, y1;
+    uint32_t first_cell;
+};
+
+struct HexChange {
+    HexCell cell;
+    float value;
+};
+
+// What one step changed in the maps.
+struct SimStepChanges {
+    uint64_t step;
+
+    // The occupancy map was cleared before the patches.
+    bool occupancy_cleared;
+
+    uint32_t first_patch, patch_count;
+    uint32_t first_hex, hex_count;
+};
+
+// The map changes of a run of steps, oldest first.
+struct SimChanges {
+    std::vector<SimStepChanges> steps;
+    std::vector<OccupancyPatch> patches;
+    std::vector<int8_t> cells;
+    std::vector<HexChange> hexes;
+};
+
+void clear_sim_changes(SimChanges* changes);
+
+// Applies the changes of the steps after after_step to copies of the occupancy map and hex grid, and appends the hexes
+// that changed to changed_hexes (if it isn't NULL).
+void apply_sim_changes(const SimChanges& changes, uint64_t after_step, OccupancyMap* map, Grid<float>* grid, std::vector<HexCell>* changed_hexes);
+
+struct SimState {
+    // Physics steps since the start, and the simulated time that makes.
+    uint64_t step;
+    double time;
+
+    RoverPose rover;
+
+    // The model the ranges were scanned with. Both models the simulation was given outlive it.
+    LidarModel* lidar_model;
+    std::vector<float> ranges;
+
+    bool has_goal;
+    std::vector<HexCell> path;
+
+    // The obstacles as of world_version. They're only copied once per change to the world, and every state published
+    // until the next change shares that copy.
+    uint64_t world_version;
+    std::shared_ptr<const std::vector<Obstacle>> obstacles;
+
+    // Every map change the reader hasn't taken yet. Some steps may be ones it already has; skip those.
+    SimChanges changes;
+
+    // Set once a scripted path has been driven to its end. Nothing changes after that.
+    bool finished;
+};
+
+struct SimConfig {
+    // Only used by the simulation thread while it runs.
+    World* world;
+    ChunkStreamer* streamer;
+    WorkerPool* pool;
+
+    // T switches between these. alternate_lidar_model may be NULL.
+    LidarModel* lidar_model;
+    LidarModel* alternate_lidar_model;
+
+    LidarEngine engine;
+    OccupancyUpdate occupancy_update;
+    float occupancy_cell_size;
+
+    // Hexes are hex_size meters on a side, in a grid of this radius.
+    float hex_size;
+    int hex_radius;
+
+    RoverPose start;
+
+    // The rover's footprint, as a circle around its pose. When the world keeps a distance field, a driven rover won't
+    // move anywhere this would overlap an obstacle.
+    float rover_radius;
+
+    // If not NULL, the rover drives along these poses (one per frame) instead of being driven by commands, and the
+    // simulation finishes at the end of them. Has to outlive the simulation.
+    const std::vector<RoverPose>* path;
+
+    // Simulated seconds per real second. 0 runs the steps back to back.
+    double time_scale;
+};
+
+enum SimCommandType {
+    // Set the rover's speed and turn rate (speed and dangle, per frame).
+    SIM_COMMAND_DRIVE,
+
+    SIM_COMMAND_ADD_OBSTACLE,
+    SIM_COMMAND_UNDO_OBSTACLE,
+    SIM_COMMAND_SAVE_LEVEL,
+
+    SIM_COMMAND_CLEAR_OCCUPANCY,
+
+    // Plan to the hex at (q, r).
+    SIM_COMMAND_SET_GOAL,
+
+    // Report the current engine's time per scan and switch to the next one.
+    SIM_COMMAND_NEXT_ENGINE,
+    SIM_COMMAND_TOGGLE_PARALLEL,
+    SIM_COMMAND_SWITCH_LIDAR_MODEL,
+
+    // Start or stop writing the rover's pose every frame to path.mgspath.
+    SIM_COMMAND_TOGGLE_RECORDING,
+
+    // Bake the level into a distance field (for the sdf engine and rover collisions), or drop it.
+    SIM_COMMAND_TOGGLE_DISTANCE_FIELD,
+};
+
+struct SimCommand {
+    SimCommandType type;
+
+    float speed, dangle;
+    Obstacle obstacle;
+    int q, r;
+    LevelFormat format;
+};
+
+struct Simulation;
+
+// Starts the simulation thread. It publishes a first state straight away.
+Simulation* start_simulation(const SimConfig& config);
+
+// Stops the thread (if it hasn't finished by itself) and frees everything the simulation made. What was in the config
+// is left to the caller.
+void stop_simulation(Simulation* sim);
+
+// Blocks until a simulation driving a path has finished it.
+void wait_for_simulation(Simulation* sim);
+
+// Queued for the next physics step.
+void send_sim_command(Simulation* sim, const SimCommand& command);
+
+// Takes the latest published state if there's a new one, and returns it, or NULL if there isn't. The state stays
+// valid (and unchanged) until the next call that returns one. Only one thread may take states.
+const SimState* take_sim_state(Simulation* sim);
+
+// Once finished, the simulation's own occupancy map, to compare copies against.
+OccupancyMap* simulation_occupancy_map(Simulation* sim);
@@ -0,0 +1,60 @@
+/*
+    Hands the latest value from one writer thread to one reader thread without either of them ever waiting.
+
+    There are three values: the writer fills its back one while the reader looks at its front one, and the third sits
+    in the middle as the latest published. Publishing swaps the back with the middle, and taking swaps the middle with
+    the front, each with a single atomic exchange. The reader always gets a whole value, never one the writer is halfway
+    through, and values the reader didn't get to in time are simply skipped.
+
+    Values are reused rather than reset, so a T holding vectors stops allocating once they've grown.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+template <typename T>
+struct TripleBuffer {
+    T values[3];
+
+    // The middle value's index, with FRESH set if it was published since the reader last took it.
+    std::atomic<uint8_t> middle;
+
+    // Only touched by the writer and the reader respectively.
+    uint8_t back;
+    uint8_t front;
+
+    static const uint8_t FRESH = 4;
+
+    TripleBuffer() : middle(1), back(0), front(2) {}
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // The value for the writer to fill in. It's whatever was published two or more publishes ago (or never read), not
+    // a blank one.
+    T& write_value() {
+        return values[back];
+    }
+
+    // Makes the written value the latest one, and hands the writer another to fill.
+    void publish() {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & 3;
+    }
+
+    // Takes the latest published value if there's one the reader hasn't taken yet, and returns whether there was.
+    bool take() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+
+        front = middle.exchange(front, std::memory_order_acq_rel) & 3;
+
+        return true;
+    }
+
+    // The last value taken. Stays the same until the next successful take.
+    const T& read_value() const {
+        return values[front];
+    }
+};
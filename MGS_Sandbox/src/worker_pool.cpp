@@ -0,0 +1,144 @@
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "worker_pool.hpp"
+
+struct WorkerPool {
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable work_ready;
+    std::condition_variable work_done;
+
+    // Bumped for every parallel_for call, which is how the workers tell a new job from a spurious wakeup.
+    unsigned generation;
+    bool quit;
+
+    // The current job.
+    ParallelForFn fn;
+    void* user;
+    int count;
+    int chunk_size;
+
+    std::atomic<int> next_chunk;
+
+    // Workers that haven't finished the current job yet.
+    int busy_workers;
+};
+
+// Grabs chunks of the current job until there are none left.
+static void run_chunks(WorkerPool* pool) {
+    int chunk_count = (pool->count + pool->chunk_size - 1) / pool->chunk_size;
+
+    for (;;) {
+        int chunk = pool->next_chunk.fetch_add(1);
+        if (chunk >= chunk_count) break;
+
+        int begin = chunk * pool->chunk_size;
+        int end = begin + pool->chunk_size;
+        if (end > pool->count) end = pool->count;
+
+        pool->fn(begin, end, pool->user);
+    }
+}
+
+static void worker_main(WorkerPool* pool) {
+    unsigned seen_generation = 0;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(pool->mutex);
+            pool->work_ready.wait(lock, [&] { return pool->quit || pool->generation != seen_generation; });
+
+            if (pool->quit) return;
+
+            seen_generation = pool->generation;
+        }
+
+        run_chunks(pool);
+
+        {
+            std::lock_guard<std::mutex> lock(pool->mutex);
+            pool->busy_workers--;
+        }
+
+        pool->work_done.notify_one();
+    }
+}
+
+WorkerPool* create_worker_pool(int thread_count) {
+    if (thread_count <= 0) {
+        thread_count = (int)std::thread::hardware_concurrency();
+        if (thread_count <= 0) thread_count = 1;
+    }
+
+    WorkerPool* pool = new WorkerPool;
+
+    pool->generation = 0;
+    pool->quit = false;
+    pool->fn = NULL;
+    pool->user = NULL;
+    pool->count = 0;
+    pool->chunk_size = 1;
+    pool->next_chunk = 0;
+    pool->busy_workers = 0;
+
+    // The thread calling parallel_for does its share of the work too.
+    for (int i = 0; i < thread_count - 1; i++) {
+        pool->threads.push_back(std::thread(worker_main, pool));
+    }
+
+    return pool;
+}
+
+void destroy_worker_pool(WorkerPool* pool) {
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->quit = true;
+    }
+
+    pool->work_ready.notify_all();
+
+    for (std::thread& thread : pool->threads) {
+        thread.join();
+    }
+
+    delete pool;
+}
+
+int worker_pool_thread_count(WorkerPool* pool) {
+    return (int)pool->threads.size() + 1;
+}
+
+void parallel_for(WorkerPool* pool, int count, int chunk_size, ParallelForFn fn, void* user) {
+    if (count <= 0) return;
+    if (chunk_size < 1) chunk_size = 1;
+
+    // Not worth waking anyone up for.
+    if (pool->threads.size() == 0 || count <= chunk_size) {
+        fn(0, count, user);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+
+        pool->fn = fn;
+        pool->user = user;
+        pool->count = count;
+        pool->chunk_size = chunk_size;
+        pool->next_chunk = 0;
+        pool->busy_workers = (int)pool->threads.size();
+        pool->generation++;
+    }
+
+    pool->work_ready.notify_all();
+
+    run_chunks(pool);
+
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    pool->work_done.wait(lock, [&] { return pool->busy_workers == 0; });
+}
@@ -0,0 +1,26 @@
+/*
+    A fixed set of worker threads for splitting loops across cores.
+
+    The threads are started once and sleep between jobs, so handing out work costs a couple of wakeups rather than
+    creating threads every time.
+*/
+
+#pragma once
+
+struct WorkerPool;
+
+// Called with a sub-range [begin, end) of the loop. user is passed through from parallel_for.
+typedef void (*ParallelForFn)(int begin, int end, void* user);
+
+// thread_count is the total number of threads working on a loop, including the one calling parallel_for.
+// Zero picks one per core.
+WorkerPool* create_worker_pool(int thread_count);
+
+void destroy_worker_pool(WorkerPool* pool);
+
+// Total number of threads working on a loop, including the caller.
+int worker_pool_thread_count(WorkerPool* pool);
+
+// Runs fn over [0, count) in chunks of at most chunk_size, on the workers and the calling thread, and returns once
+// every chunk is done. Only one thread may call this on a pool at a time.
+void parallel_for(WorkerPool* pool, int count, int chunk_size, ParallelForFn fn, void* user);
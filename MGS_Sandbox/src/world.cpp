@@ -0,0 +1,424 @@
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "memory.hpp"
+#include "polar_scan.hpp"
+#include "world.hpp"
+
+World* create_world() {
+    World* world = new World;
+
+    world->obstacles_changed = true;
+    world->version = 0;
+    world->changes_start_version = 0;
+    world->obstacle_grid = NULL;
+    world->obstacle_set = NULL;
+    world->distance_field_cell_size = 0;
+    world->distance_field = NULL;
+    world->distance_field_version = 0;
+    world->distance_field_updated_cell_size = 0;
+
+    return world;
+}
+
+void destroy_world(World* world) {
+    if (world->obstacle_grid) destroy_obstacle_grid(world->obstacle_grid);
+    if (world->obstacle_set) destroy_obstacle_set(world->obstacle_set);
+    if (world->distance_field) destroy_distance_field(world->distance_field);
+
+    delete world;
+}
+
+static void log_change(World* world, Obstacle obstacle) {
+    world->version++;
+    world->obstacles_changed = true;
+
+    world->changes.push_back({ world->version, obstacle });
+
+    if (world->changes.size() > WORLD_CHANGE_LOG_SIZE) {
+        world->changes.erase(world->changes.begin());
+        world->changes_start_version = world->changes.front().version - 1;
+    }
+}
+
+void add_obstacle(World* world, Obstacle obstacle) {
+    world->obstacles.push_back(obstacle);
+    log_change(world, obstacle);
+}
+
+void remove_last_obstacle(World* world) {
+    Obstacle obstacle = world->obstacles.back();
+
+    world->obstacles.pop_back();
+    log_change(world, obstacle);
+}
+
+void mark_world_changed(World* world) {
+    world->version++;
+    world->obstacles_changed = true;
+
+    world->changes.clear();
+    world->changes_start_version = world->version;
+}
+
+// Patches the edits since the distance field was last brought up to date into it, if they're all still in the change
+// log, and rebuilds it otherwise. Needs the obstacle grid up to date.
+static void update_world_distance_field(World* world) {
+    DistanceField* field = world->distance_field;
+    float cell_size = world->distance_field_cell_size;
+
+    world->distance_field_updated_cell_size = cell_size;
+
+    if (cell_size <= 0) {
+        if (field) destroy_distance_field(field);
+        world->distance_field = NULL;
+        return;
+    }
+
+    bool patched = false;
+
+    if (field && field->cell_size == cell_size && world->distance_field_version >= world->changes_start_version) {
+        std::vector<Obstacle> changed;
+
+        for (WorldChange& change : world->changes) {
+            if (change.version > world->distance_field_version) changed.push_back(change.obstacle);
+        }
+
+        patched = update_distance_field(field, world->obstacle_grid, changed.data(), (int)changed.size());
+    }
+
+    if (!patched) {
+        if (field) destroy_distance_field(field);
+        world->distance_field = NULL;
+
+        // Worlds too big for a field scan with the grid instead, and the rover doesn't collide.
+        if (distance_field_cell_count(world->obstacles, cell_size) <= DISTANCE_FIELD_MAX_CELLS) {
+            world->distance_field = create_distance_field(world->obstacles, cell_size);
+        }
+    }
+
+    world->distance_field_version = world->version;
+}
+
+void update_world(World* world) {
+    // Turning the distance field on or off, or changing its cell size, needs it rebuilt even if the obstacles didn't
+    // change.
+    if (world->distance_field_cell_size != world->distance_field_updated_cell_size) world->obstacles_changed = true;
+
+    if (!world->obstacles_changed) return;
+
+    if (world->obstacle_grid) destroy_obstacle_grid(world->obstacle_grid);
+    world->obstacle_grid = create_obstacle_grid(world->obstacles, OBSTACLE_GRID_CELL_SIZE);
+
+    if (world->obstacle_set) destroy_obstacle_set(world->obstacle_set);
+    world->obstacle_set = create_obstacle_set(world->obstacles);
+
+    update_world_distance_field(world);
+
+    world->obstacles_changed = false;
+}
+
+void scan_world_rays(World* world, LidarEngine engine, float x, float y, const float* dir_x, const float* dir_y, int count, float* out_ranges, float max_scan_distance) {
+    switch (engine) {
+        case LIDAR_ENGINE_GRID:
+            lidar_scan_grid(x, y, dir_x, dir_y, count, world->obstacle_grid, out_ranges, max_scan_distance);
+            break;
+        case LIDAR_ENGINE_SIMD:
+            lidar_scan_simd(x, y, dir_x, dir_y, count, world->obstacle_set, out_ranges, max_scan_distance);
+            break;
+        case LIDAR_ENGINE_SDF:
+            if (world->distance_field) {
+                lidar_scan_sdf(x, y, dir_x, dir_y, count, world->distance_field, world->obstacle_grid, out_ranges, max_scan_distance);
+            } else {
+                lidar_scan_grid(x, y, dir_x, dir_y, count, world->obstacle_grid, out_ranges, max_scan_distance);
+            }
+            break;
+        default:
+            lidar_scan(x, y, dir_x, dir_y, count, world->obstacles, out_ranges, max_scan_distance);
+            break;
+    }
+}
+
+// Beams are rotated into the world frame this many at a time, so the directions fit in a stack buffer. Enough for a
+// whole scan of either of the standard models in one call to the engine.
+const int SCAN_BLOCK_SIZE = 1088;
+
+static void scan_beam_range(World* world, LidarModel* model, LidarEngine engine, float x, float y, float angle, float* out_ranges, float max_scan_distance, int first_beam, int end_beam) {
+    alignas(CACHE_LINE_SIZE) float dir_x[SCAN_BLOCK_SIZE];
+    alignas(CACHE_LINE_SIZE) float dir_y[SCAN_BLOCK_SIZE];
+
+    for (int begin = first_beam; begin < end_beam; begin += SCAN_BLOCK_SIZE) {
+        int end = begin + SCAN_BLOCK_SIZE;
+        if (end > end_beam) end = end_beam;
+
+        rotate_lidar_beams(model, angle, begin, end, dir_x, dir_y);
+
+        if (engine == LIDAR_ENGINE_POLAR) {
+            // The beams' angles are the model's, turned by the heading.
+            float first_angle = (angle + lidar_beam_angle(model, begin)) * (float)M_PI / 180.0f;
+            float angle_step = model->angle_step * (float)M_PI / 180.0f;
+
+            lidar_scan_polar(x, y, first_angle, angle_step, dir_x, dir_y, end - begin, world->obstacles, out_ranges + begin, max_scan_distance);
+        } else {
+            scan_world_rays(world, engine, x, y, dir_x, dir_y, end - begin, out_ranges + begin, max_scan_distance);
+        }
+    }
+}
+
+void scan_world(World* world, LidarModel* model, LidarEngine engine, float x, float y, float angle, float* out_ranges, float max_scan_distance) {
+    update_world(world);
+
+    scan_beam_range(world, model, engine, x, y, angle, out_ranges, max_scan_distance, 0, model->beam_count);
+}
+
+void scan_world_beams(World* world, LidarModel* model, LidarEngine engine, float x, float y, float angle, float* out_ranges, float max_scan_distance, int first_beam, int end_beam) {
+    update_world(world);
+
+    scan_beam_range(world, model, engine, x, y, angle, out_ranges, max_scan_distance, first_beam, end_beam);
+}
+
+struct ParallelScan {
+    World* world;
+    LidarModel* model;
+    LidarEngine engine;
+    float x, y, angle;
+    float* out_ranges;
+    float max_scan_distance;
+};
+
+static void parallel_scan_beams(int begin, int end, void* user) {
+    ParallelScan* scan = (ParallelScan*)user;
+
+    scan_beam_range(scan->world, scan->model, scan->engine, scan->x, scan->y, scan->angle, scan->out_ranges, scan->max_scan_distance, begin, end);
+}
+
+void scan_world_parallel(World* world, WorkerPool* pool, LidarModel* model, LidarEngine engine, float x, float y, float angle, float* out_ranges, float max_scan_distance) {
+    // Has to happen before the threads start reading the acceleration structures.
+    update_world(world);
+
+    ParallelScan scan = { world, model, engine, x, y, angle, out_ranges, max_scan_distance };
+
+    // A few chunks per thread, so a thread that got the beams looking into clutter doesn't hold everyone up.
+    int chunk_size = model->beam_count / (4 * worker_pool_thread_count(pool)) + 1;
+
+    parallel_for(pool, model->beam_count, chunk_size, parallel_scan_beams, &scan);
+}
+
+// Interleaves the bits of x and y, so sorting by the result walks a grid in Z order and cells near each other in 2D
+// mostly end up near each other in the order too.
+static uint32_t morton_code(uint32_t x, uint32_t y) {
+    uint32_t code = 0;
+
+    for (int bit = 0; bit < 16; bit++) {
+        code |= ((x >> bit) & 1) << (2 * bit);
+        code |= ((y >> bit) & 1) << (2 * bit + 1);
+    }
+
+    return code;
+}
+
+// Keeps the obstacle grid cell coordinates of a pose in morton_code's 16 bits.
+static uint32_t batch_cell(float position, float min, float cell_size) {
+    float cell = floorf((position - min) / cell_size);
+
+    if (!(cell > 0)) return 0;
+    if (cell > 0xffff) return 0xffff;
+    return (uint32_t)cell;
+}
+
+// Poses are gathered into clusters no wider than this fraction of the scan distance, which share the obstacles
+// gathered for them.
+const float BATCH_CLUSTER_EXTENT = 0.25f;
+
+// At most this many poses share a gather, so a batch of poses all in one spot still splits across threads.
+const int BATCH_CLUSTER_MAX_POSES = 64;
+
+// The obstacles are gathered a little further out than the scan distance, so an obstacle just past it can't be left
+// out and still round to a hit right at it.
+const float BATCH_GATHER_MARGIN = 1.01f;
+
+// The gathered obstacles are sorted by how far they are from the middle of the cluster and tested in rings of this
+// many, nearest first, so a ray that already hit something closer than the next ring can stop there. A multiple of
+// OBSTACLE_SET_PADDING, so every ring starts where the kernels expect a set to.
+const int BATCH_RING_SIZE = 32;
+
+// How much further than a ray's hit (in meters, on top of BATCH_GATHER_MARGIN) the next ring has to be to be skipped,
+// so rounding in coordinates far from the origin can't skip an obstacle the full set would have hit first.
+const float BATCH_RING_SLACK = 0.01f;
+
+// Poses order[begin] up to (but not including) order[end], which all fit in the box from (min_x, min_y) to
+// (max_x, max_y).
+struct BatchCluster {
+    int begin, end;
+
+    float min_x, min_y, max_x, max_y;
+};
+
+struct BatchScan {
+    World* world;
+    LidarModel* model;
+    const RoverPose* poses;
+
+    // The pose indices in Z order of their obstacle grid cells.
+    const int* order;
+
+    const BatchCluster* clusters;
+
+    float* out_ranges;
+    float max_scan_distance;
+};
+
+// Distance from (x, y) to the nearest point of obs, 0 if it's inside.
+static float obstacle_distance(const Obstacle& obs, float x, float y) {
+    float dx = std::max(fabsf(obs.x - x) - obs.w/2.0f, 0.0f);
+    float dy = std::max(fabsf(obs.y - y) - obs.h/2.0f, 0.0f);
+
+    return sqrtf(dx*dx + dy*dy);
+}
+
+static void batch_scan_clusters(int begin, int end, void* user) {
+    BatchScan* scan = (BatchScan*)user;
+    LidarModel* model = scan->model;
+
+    alignas(CACHE_LINE_SIZE) float dir_x[SCAN_BLOCK_SIZE];
+    alignas(CACHE_LINE_SIZE) float dir_y[SCAN_BLOCK_SIZE];
+
+    float reach = scan->max_scan_distance * BATCH_GATHER_MARGIN;
+
+    std::vector<Obstacle> nearby;
+    std::vector<std::pair<float, int>> by_distance;
+    std::vector<Obstacle> sorted;
+    std::vector<float> ring_distance;
+
+    for (int c = begin; c < end; c++) {
+        const BatchCluster& cluster = scan->clusters[c];
+        float center_x = 0.5f * (cluster.min_x + cluster.max_x);
+        float center_y = 0.5f * (cluster.min_y + cluster.max_y);
+
+        // Everything any pose in the cluster can hit, in one small set that stays in cache while its poses are scanned.
+        nearby.clear();
+        query_obstacle_grid(scan->world->obstacle_grid, cluster.min_x - reach, cluster.min_y - reach, cluster.max_x + reach, cluster.max_y + reach, nearby);
+
+        by_distance.resize(nearby.size());
+        for (size_t i = 0; i < nearby.size(); i++) by_distance[i] = { obstacle_distance(nearby[i], center_x, center_y), (int)i };
+
+        std::sort(by_distance.begin(), by_distance.end());
+
+        sorted.resize(nearby.size());
+        for (size_t i = 0; i < nearby.size(); i++) sorted[i] = nearby[by_distance[i].second];
+
+        // The nearest any obstacle in each ring gets to the middle of the cluster.
+        int ring_count = ((int)sorted.size() + BATCH_RING_SIZE - 1) / BATCH_RING_SIZE;
+
+        ring_distance.resize(ring_count);
+        for (int r = 0; r < ring_count; r++) ring_distance[r] = by_distance[(size_t)r * BATCH_RING_SIZE].first;
+
+        ObstacleSet* set = create_obstacle_set(sorted);
+
+        for (int i = cluster.begin; i < cluster.end; i++) {
+            int pose_index = scan->order[i];
+            RoverPose pose = scan->poses[pose_index];
+            float* out_ranges = scan->out_ranges + (size_t)pose_index * model->beam_count;
+
+            // No obstacle is closer to the pose than it is to the middle of the cluster minus this.
+            float offset = sqrtf((pose.x - center_x) * (pose.x - center_x) + (pose.y - center_y) * (pose.y - center_y));
+
+            for (int block = 0; block < model->beam_count; block += SCAN_BLOCK_SIZE) {
+                int block_end = block + SCAN_BLOCK_SIZE;
+                if (block_end > model->beam_count) block_end = model->beam_count;
+
+                rotate_lidar_beams(model, pose.angle, block, block_end, dir_x, dir_y);
+
+                for (int beam = 0; beam < block_end - block; beam++) {
+                    float range = scan->max_scan_distance;
+
+                    for (int r = 0; r < ring_count; r++) {
+                        if (ring_distance[r] - offset > range * BATCH_GATHER_MARGIN + BATCH_RING_SLACK) break;
+
+                        // The ring, as a set of its own.
+                        ObstacleSet ring = *set;
+                        int first = r * BATCH_RING_SIZE;
+
+                        ring.x += first;
+                        ring.y += first;
+                        ring.w += first;
+                        ring.h += first;
+                        ring.count = std::min(BATCH_RING_SIZE, set->count - first);
+                        ring.padded_count = std::min(BATCH_RING_SIZE, set->padded_count - first);
+
+                        range = std::min(range, ray_obstacle_set_distance(&ring, pose.x, pose.y, dir_x[beam], dir_y[beam], scan->max_scan_distance));
+                    }
+
+                    out_ranges[block + beam] = range;
+                }
+            }
+        }
+
+        destroy_obstacle_set(set);
+    }
+}
+
+void scan_world_batch(World* world, WorkerPool* pool, LidarModel* model, const RoverPose* poses, int pose_count, float* out_ranges, float max_scan_distance) {
+    // Once for the whole batch, and before any threads start reading the acceleration structures.
+    update_world(world);
+
+    ObstacleGrid* grid = world->obstacle_grid;
+
+    std::vector<std::pair<uint32_t, int>> keyed(pose_count);
+
+    for (int i = 0; i < pose_count; i++) {
+        uint32_t cx = batch_cell(poses[i].x, grid->min_x, grid->cell_size);
+        uint32_t cy = batch_cell(poses[i].y, grid->min_y, grid->cell_size);
+
+        keyed[i] = { morton_code(cx, cy), i };
+    }
+
+    // Stable, so poses in the same cell keep their order and the batch always runs the same way.
+    std::stable_sort(keyed.begin(), keyed.end(), [](const std::pair<uint32_t, int>& a, const std::pair<uint32_t, int>& b) {
+        return a.first < b.first;
+    });
+
+    std::vector<int> order(pose_count);
+    for (int i = 0; i < pose_count; i++) order[i] = keyed[i].second;
+
+    // Runs of poses in Z order are close together, so each cluster takes poses for as long as they keep it small.
+    float extent = max_scan_distance * BATCH_CLUSTER_EXTENT;
+
+    std::vector<BatchCluster> clusters;
+
+    for (int i = 0; i < pose_count; i++) {
+        const RoverPose& pose = poses[order[i]];
+
+        if (!clusters.empty()) {
+            BatchCluster& cluster = clusters.back();
+
+            float min_x = std::min(cluster.min_x, pose.x), max_x = std::max(cluster.max_x, pose.x);
+            float min_y = std::min(cluster.min_y, pose.y), max_y = std::max(cluster.max_y, pose.y);
+
+            if (cluster.end - cluster.begin < BATCH_CLUSTER_MAX_POSES && max_x - min_x <= extent && max_y - min_y <= extent) {
+                cluster = { cluster.begin, i + 1, min_x, min_y, max_x, max_y };
+                continue;
+            }
+        }
+
+        clusters.push_back({ i, i + 1, pose.x, pose.y, pose.x, pose.y });
+    }
+
+    BatchScan scan = { world, model, poses, order.data(), clusters.data(), out_ranges, max_scan_distance };
+
+    int cluster_count = (int)clusters.size();
+
+    if (!pool) {
+        batch_scan_clusters(0, cluster_count, &scan);
+        return;
+    }
+
+    // A few chunks of clusters per thread, so one that got the cluttered area doesn't hold everyone up.
+    int chunk_size = cluster_count / (4 * worker_pool_thread_count(pool)) + 1;
+
+    parallel_for(pool, cluster_count, chunk_size, batch_scan_clusters, &scan);
+}
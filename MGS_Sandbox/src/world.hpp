@@ -0,0 +1,102 @@
+/*
+    The obstacles in the level, along with the acceleration structures the LIDAR engines build from them.
+
+    Shared between the windowed sandbox and the headless mode so both scan the exact same way.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "distance_field.hpp"
+#include "lidar_model.hpp"
+#include "obstacle.hpp"
+#include "obstacle_grid.hpp"
+#include "obstacle_set.hpp"
+#include "rover.hpp"
+#include "worker_pool.hpp"
+
+// Cell size of the obstacle grid used by LIDAR_ENGINE_GRID, in meters.
+const float OBSTACLE_GRID_CELL_SIZE = 2.0f;
+
+// Cell size of the distance field for LIDAR_ENGINE_SDF and rover collisions, in meters, when one is asked for.
+const float DISTANCE_FIELD_CELL_SIZE = 0.1f;
+
+// How many recent edits the world remembers. A ScanCache that is further behind than this rescans everything.
+const int WORLD_CHANGE_LOG_SIZE = 64;
+
+// An obstacle that was added or removed.
+struct WorldChange {
+    uint64_t version;
+
+    Obstacle obstacle;
+};
+
+struct World {
+    // Change these through add_obstacle, remove_last_obstacle or mark_world_changed, so scans can tell what changed.
+    std::vector<Obstacle> obstacles;
+
+    // Set when obstacles change, so the next scan rebuilds the structures below.
+    bool obstacles_changed;
+
+    // Goes up by one with every change.
+    uint64_t version;
+
+    // Every change after changes_start_version, oldest first.
+    std::vector<WorldChange> changes;
+    uint64_t changes_start_version;
+
+    ObstacleGrid* obstacle_grid;
+    ObstacleSet* obstacle_set;
+
+    // Set distance_field_cell_size to have update_world keep a distance field of the obstacles too (0, the default,
+    // doesn't). Edits in the change log are patched into it, anything else rebuilds it. distance_field stays NULL
+    // while the field would need more than DISTANCE_FIELD_MAX_CELLS cells.
+    float distance_field_cell_size;
+    DistanceField* distance_field;
+
+    // The version distance_field is up to date with, and the cell size that was asked for then.
+    uint64_t distance_field_version;
+    float distance_field_updated_cell_size;
+};
+
+World* create_world();
+
+void destroy_world(World* world);
+
+void add_obstacle(World* world, Obstacle obstacle);
+
+void remove_last_obstacle(World* world);
+
+// For when obstacles was changed wholesale (like loading a level or streaming in chunks). Anything cached from
+// before is thrown away.
+void mark_world_changed(World* world);
+
+// Rebuilds the acceleration structures if the obstacles changed since the last call.
+void update_world(World* world);
+
+// Scans count rays from (x, y) along (dir_x[i], dir_y[i]) with the given engine. See lidar_scan. LIDAR_ENGINE_SDF uses
+// the grid instead if the world has no distance field, and LIDAR_ENGINE_POLAR, which needs a LidarModel's evenly spaced
+// beams, uses brute force (which gives the same ranges).
+void scan_world_rays(World* world, LidarEngine engine, float x, float y, const float* dir_x, const float* dir_y, int count, float* out_ranges, float max_scan_distance);
+
+// Does a full scan with the given LIDAR model from a rover at (x, y) facing angle degrees.
+// out_ranges gets one range per beam.
+void scan_world(World* world, LidarModel* model, LidarEngine engine, float x, float y, float angle, float* out_ranges, float max_scan_distance);
+
+// Only scans beams [first_beam, end_beam), writing their ranges to out_ranges[first_beam] onwards. They come out
+// exactly the same as from a full scan.
+void scan_world_beams(World* world, LidarModel* model, LidarEngine engine, float x, float y, float angle, float* out_ranges, float max_scan_distance, int first_beam, int end_beam);
+
+// Same as scan_world, but splits the beams across the pool's threads. The ranges are bit-identical to scan_world's.
+void scan_world_parallel(World* world, WorkerPool* pool, LidarModel* model, LidarEngine engine, float x, float y, float angle, float* out_ranges, float max_scan_distance);
+
+// Scans from each of pose_count poses, writing pose i's ranges to out_ranges[i * model->beam_count] onwards (a pose by
+// beam matrix). For particle filters and the like, which need many scans of the same world. Poses near each other are
+// gathered into clusters, the obstacles any of a cluster's poses can reach are copied out of the obstacle grid into one
+// small ObstacleSet, nearest first, and every pose in the cluster is scanned against that with the vectorised slab test
+// (stopping once a ray's hit is closer than the rest of the set). With a pool, whole clusters are split across the
+// threads. Every row is bit-identical to scan_world's with LIDAR_ENGINE_SIMD. pool may be NULL.
+void scan_world_batch(World* world, WorkerPool* pool, LidarModel* model, const RoverPose* poses, int pose_count, float* out_ranges, float max_scan_distance);